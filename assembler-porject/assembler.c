@@ -1,3 +1,5 @@
+/* for fdopen, to write the outputs of the standard input to given file descriptors */
+#define _POSIX_C_SOURCE 200112L
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -7,104 +9,410 @@
 #include "utils.h"
 #include "second_pass.h"
 #include "write_output.h"
+#include "reader.h"
+#include "optimize.h"
+#include "gc.h"
+#include "listing.h"
+#include "debug_map.h"
+#include "diagnostics.h"
+#include "parallel.h"
+#include "incremental.h"
+#include "batch_io.h"
 
+/** The name of the standard input source in the messages and the listing */
+#define STDIN_SOURCE_NAME "stdin"
+
+
+/* A file checked by --check, together with the others */
+typedef struct check_task {
+	char* filename;
+	assembler_options* options;
+	FILE* output; /* the diagnostics, printed in the order of the files when all of them are checked */
+	bool succeeded;
+} check_task;
 
 /**
  * Processes a single assembly source file, and returns the result status.
  * @param filename The filename
+ * @param options The command line options
+ * @param output Where the diagnostics are printed (those of the standard input go to the standard error)
  * @return if succeeded
  */
-static bool process_file(char* filename);
+static bool process_file(char* filename, assembler_options* options, FILE* output);
+
+/**
+ * Checks whether a file name has the extension of a source file, or reads the standard input.
+ * Prints an error if not.
+ * @param filename The file name
+ * @return Whether it has
+ */
+static bool has_source_extension(char* filename);
+
+/**
+ * Checks the source files for --check, all of them in parallel, and prints their diagnostics in order
+ * @param filenames The file names
+ * @param count The files count
+ * @param options The command line options
+ * @return Whether all of them succeeded
+ */
+static bool check_files(char** filenames, int count, assembler_options* options);
+
+/**
+ * Checks a single file, in it's own thread
+ * @param arg The check task of the file
+ * @return NULL
+ */
+static void* check_file(void* arg);
+
+/**
+ * Assembles a source file again after each edit read from the standard input, and prints the diagnostics
+ * of the source after it. An edit is a line of "<first line> <removed count> <added count>", then the added lines.
+ * Each diagnostics print ends with a line of ".".
+ * @param filename The filename
+ * @param options The command line options
+ * @return Whether the last edit has no errors
+ */
+static bool edit_file(char* filename, assembler_options* options);
+
+/**
+ * Reads a line of the standard input, of the maximum line length - the rest of a longer line is skipped
+ * @param buffer The destination buffer, of MAX_LINE_LENGTH + 2 bytes
+ * @return Whether a line was read
+ */
+static bool read_edit_line(char* buffer);
+
+/**
+ * Reads the options (the arguments starting with '-') from the command line arguments,
+ * and moves the file names to the beginning of the arguments array.
+ * @param argc The arguments count
+ * @param argv The arguments, without the program name
+ * @param options The destination of the options
+ * @return The count of the file names, -1 if an option is invalid
+ */
+static int parse_options(int argc, char *argv[], assembler_options* options);
+
+/**
+ * Reads all the lines of a file, and processes them in the first pass in parallel chunks.
+ * @param reader The source reader of the file
+ * @param options The command line options
+ * @param keep_lines Whether the lines are added to the listing
+ * @param ic A pointer to the code counter
+ * @param dc A pointer to the data counter
+ * @param code_img The code image, NULL if the code words are only counted
+ * @param symbol_table The symbol table
+ * @param data The data image
+ * @param refs The label references, for the second pass
+ * @param lst The listing
+ * @param diag The diagnostics of the file
+ * @return Whether succeeded
+ */
+static bool process_lines_parallel(source_reader* reader, assembler_options* options, bool keep_lines, long* ic, long* dc, machine_word** code_img,
+		table* symbol_table, data_image* data, label_ref_list* refs, listing* lst, diagnostics* diag);
+
+/**
+ * Opens the streams for the outputs of the standard input, by the file descriptors of the options.
+ * @param options The command line options
+ * @param streams The destination streams
+ * @return Whether succeeded
+ */
+static bool open_output_streams(assembler_options* options, output_streams* streams);
+
+/**
+ * Closes the streams opened for the outputs of the standard input (but not the standard output).
+ * @param streams The streams
+ */
+static void close_output_streams(output_streams* streams);
 
 int main(int argc, char *argv[]){
-  	int i;
-		char* extension;
+  	int i, file_count;
+	assembler_options options;
 
 	/* to break line if needed */
 	bool succeeded = TRUE;
 
-	if(argc <= 1){
+	if ((file_count = parse_options(argc - 1, argv + 1, &options)) < 0) {
+		return 0;
+	}
+	if(file_count == 0){
 		printf("Missing input files. Please enter at least 1 assembler file.\n");
 		return 0;
 	}
-	if(argc > MAX_FILES_TO_PROCESS+1){
-		printf("The maximum files to process is %d.\n", MAX_FILES_TO_PROCESS);
+	if(options.max_files > 0 && file_count > options.max_files){
+		printf("The maximum files to process is %ld.\n", options.max_files);
 		return 0;
 	}
 
-		
+	/* the object of the standard input is written to the standard output, where the other files print their messages */
+	for (i = 1; i <= file_count && file_count > 1 && !options.check && options.ob_fd < 0; ++i) {
+		if (strcmp(argv[i], STDIN_FILE_NAME) == 0) {
+			printf("Error: the standard input writes it's object to the standard output - assemble it alone, or give --ob-fd.\n");
+			return 1;
+		}
+	}
+
+	/* each file is read while the ones before it are assembled */
+	start_source_reads(argv + 1, file_count);
+
+	/* only the diagnostics, for all the files at once */
+	if (options.check) {
+		for (i = 1; i <= file_count; ++i) {
+			if (!has_source_extension(argv[i])) {
+				return 1;
+			}
+		}
+		succeeded = check_files(argv + 1, file_count, &options);
+		free_include_cache();
+		end_batch_io();
+		return succeeded ? 0 : 1;
+	}
+
+	/* a single source, assembled again after each edit */
+	if (options.incremental) {
+		if (file_count != 1 || strcmp(argv[1], STDIN_FILE_NAME) == 0) {
+			printf("Error: --incremental requires a single source file, the edits are read from the standard input.\n");
+			return 1;
+		}
+		if (!has_source_extension(argv[1])) {
+			return 1;
+		}
+		succeeded = edit_file(argv[1], &options);
+		free_include_cache();
+		end_batch_io();
+		return succeeded ? 0 : 1;
+	}
+
   /* process each file by arguments */
-	for (i = 1; i < argc; ++i) {
+	for (i = 1; i <= file_count; ++i) {
 		/* if last process failed and there's another file, break line: */
 		if (!succeeded){
       puts(""); 
     }
-		extension = strstr(argv[i], ".");
-		if(extension == NULL || strcmp(extension, ".as") != 0){ /* the extension is not '.as' */
-			printf("Error: cannot open the file with the %s extension. please enter file with .as extension\n", extension);
+		if (!has_source_extension(argv[i])) {
 			return 0;
-	} 
+		}
 		/* foreach argument (file name), send it for full processing. */
-		succeeded = process_file(argv[i]);
+		succeeded = process_file(argv[i], &options, stdout);
 	
 	}
+	free_include_cache(); /* included files are shared by all the processed files */
+	end_batch_io();
 	return 0;
 }
 
-static bool process_file(char* filename){
+static bool has_source_extension(char* filename){
+	char* extension = strstr(filename, ".");
+	if(strcmp(filename, STDIN_FILE_NAME) != 0 && (extension == NULL || strcmp(extension, ".as") != 0)){ /* the extension is not '.as' */
+		printf("Error: cannot open the file with the %s extension. please enter file with .as extension\n", extension);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static bool check_files(char** filenames, int count, assembler_options* options){
+	check_task* tasks = (check_task *) malloc_with_check(count * sizeof(check_task));
+	char buffer[BUFSIZ];
+	size_t length;
+	bool succeeded = TRUE;
+	int i;
+
+	/* each file prints to a temporary file, or directly if there's none */
+	for (i = 0; i < count; i++) {
+		tasks[i].filename = filenames[i];
+		tasks[i].options = options;
+		tasks[i].output = tmpfile();
+	}
+	run_in_threads(tasks, count, sizeof(check_task), check_file);
+	for (i = 0; i < count; i++) {
+		if (tasks[i].output != NULL) {
+			rewind(tasks[i].output);
+			while ((length = fread(buffer, 1, sizeof(buffer), tasks[i].output)) > 0) {
+				fwrite(buffer, 1, length, stdout);
+			}
+			fclose(tasks[i].output);
+		}
+		succeeded = succeeded && tasks[i].succeeded;
+	}
+	free(tasks);
+	return succeeded;
+}
+
+static void* check_file(void* arg){
+	check_task* task = (check_task *) arg;
+	task->succeeded = process_file(task->filename, task->options, task->output != NULL ? task->output : stdout);
+	return NULL;
+}
+
+static int parse_options(int argc, char *argv[], assembler_options* options){
+	int i, file_count = 0;
+
+	options->optimize = FALSE;
+	options->listing = FALSE;
+	options->json_errors = FALSE;
+	options->max_errors = 0;
+	options->max_files = MAX_FILES_TO_PROCESS;
+	options->jobs = 1;
+	options->ob_fd = options->ent_fd = options->ext_fd = -1;
+	options->sections = FALSE;
+	options->align_data = FALSE;
+	options->merge_strings = FALSE;
+	options->gc = FALSE;
+	options->relocations = FALSE;
+	options->debug_map = FALSE;
+	options->ext_format = TABLE_LINES;
+	options->check = FALSE;
+	options->incremental = FALSE;
+
+	for (i = 0; i < argc; i++) {
+		if (argv[i][0] != '-' || strcmp(argv[i], STDIN_FILE_NAME) == 0) {
+			argv[file_count++] = argv[i]; /* a file name */
+		}
+		else if (strcmp(argv[i], "-O") == 0 || strcmp(argv[i], "--optimize") == 0) {
+			options->optimize = TRUE;
+		}
+		else if (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--listing") == 0) {
+			options->listing = TRUE;
+		}
+		else if (strcmp(argv[i], "--json-errors") == 0) {
+			options->json_errors = TRUE;
+		}
+		else if (strcmp(argv[i], "--max-errors") == 0 && i + 1 < argc && is_int(argv[i + 1])) {
+			options->max_errors = atol(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--max-files") == 0 && i + 1 < argc && is_int(argv[i + 1])) {
+			options->max_files = atol(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) && i + 1 < argc && is_int(argv[i + 1])) {
+			options->jobs = atoi(argv[++i]);
+			options->jobs = options->jobs <= 0 ? get_processor_count() : options->jobs; /* 0 for all the processors */
+		}
+		else if (strcmp(argv[i], "--ob-fd") == 0 && i + 1 < argc && is_int(argv[i + 1])) {
+			options->ob_fd = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--ent-fd") == 0 && i + 1 < argc && is_int(argv[i + 1])) {
+			options->ent_fd = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--ext-fd") == 0 && i + 1 < argc && is_int(argv[i + 1])) {
+			options->ext_fd = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--sections") == 0) {
+			options->sections = TRUE;
+		}
+		else if (strcmp(argv[i], "--align-data") == 0) {
+			options->align_data = TRUE;
+		}
+		else if (strcmp(argv[i], "--merge-strings") == 0) {
+			options->merge_strings = TRUE;
+		}
+		else if (strcmp(argv[i], "--gc") == 0) {
+			options->gc = TRUE;
+		}
+		else if (strcmp(argv[i], "--rel") == 0) {
+			options->relocations = TRUE;
+		}
+		else if (strcmp(argv[i], "--dbg") == 0) {
+			options->debug_map = TRUE;
+		}
+		else if (strcmp(argv[i], "--ext-grouped") == 0) {
+			options->ext_format = TABLE_GROUPED;
+		}
+		else if (strcmp(argv[i], "--ext-delta") == 0) {
+			options->ext_format = TABLE_GROUPED_DELTA;
+		}
+		else if (strcmp(argv[i], "--check") == 0) {
+			options->check = TRUE;
+		}
+		else if (strcmp(argv[i], "--incremental") == 0) {
+			options->incremental = TRUE;
+		}
+		else {
+			printf("Error: unknown option %s.\n", argv[i]);
+			return -1;
+		}
+	}
+	return file_count;
+}
+
+static bool process_file(char* filename, assembler_options* options, FILE* output){
 	/* memory address counters */
-	int temp_c;
 	long ic = IC_INIT_VALUE, dc = DC_INIT_VALUE, icf, dcf;
 
   bool is_success = TRUE; /* is succeeded so far */
   char* input_filename; 
-  char temp_line[MAX_LINE_LENGTH + 2]; /* temporary string for storing line, read from file */
 	FILE* file_des; /* current assembly file descriptor to process */
-	data_word* data[CODE_ARR_IMG_LENGTH]; 
-	machine_word* code_img[CODE_ARR_IMG_LENGTH];
+	source_reader reader; /* reads the lines of the file, expanding macros */
+	data_image data; /* the data image, as segments */
+	machine_word* code_img[CODE_ARR_IMG_LENGTH] = {NULL};
+	machine_word** words = options->check ? NULL : code_img; /* a checked source only counts it's code words */
 	table symbol_table = NULL; /* our symbol table */
+	label_ref_list refs = {NULL, 0, 0}; /* the labels used by the source, for the second pass */
+	listing lst = {NULL, 0, 0}; /* the lines metadata, for the .lst and the .dbg files */
+	bool keep_lines = !options->check && (options->listing || options->debug_map); /* whether the lines metadata is collected */
+	long ic_before, dc_before;
+	diagnostics diag; /* the errors of the file, printed when it's done */
 	line_info curr_line_info;
+	bool is_pipe = strcmp(filename, STDIN_FILE_NAME) == 0; /* the source is read from the standard input */
+	bool has_streams = is_pipe && !options->check; /* whether the outputs of the standard input are written */
+	output_streams streams; /* the outputs of the standard input */
 
-  /* remove the .as extension */
-	input_filename = malloc_with_check(strlen(filename)); 
-	strncpy(input_filename, filename, strlen(filename)-3);
-	 /* get the file name without the extension */
-	input_filename[strlen(filename)-3]='\0';
+	if (is_pipe) {
+		/* read once, as the lines are never read again - the outputs go to the standard output, or the given descriptors */
+		if (has_streams && !open_output_streams(options, &streams)) {
+			return FALSE;
+		}
+		input_filename = strconcat(STDIN_SOURCE_NAME, "");
+		file_des = stdin;
+	}
+	else {
+		/* remove the .as extension */
+		input_filename = malloc_with_check(strlen(filename));
+		strncpy(input_filename, filename, strlen(filename)-3);
+		/* get the file name without the extension */
+		input_filename[strlen(filename)-3]='\0';
 
-	/* open file, skip on failure */
-	file_des = fopen(filename, "r");
+		/* open file, skip on failure */
+		file_des = open_source_file(filename);
+	}
 	if (file_des == NULL) {
 		/* if file couldn't be opened, print error. */
-		printf("Error: cannot open the file: %s.\n", filename);
+		fprintf(output, "Error: cannot open the file: %s.\n", filename);
 		free(input_filename); /* the only allocated space is for the full file name */
 		return FALSE;
 	}
 
   
 	/* start first pass */
- 	curr_line_info.file_name = input_filename; 
-	curr_line_info.content = temp_line; /* use temp_line to read from the file, but it stays at same location. */
-
-	/* read line - stop if read failed (when NULL returned) - usually when EOF. increase line counter for error printing. */
-  for (curr_line_info.line_number = 1; fgets(temp_line, MAX_LINE_LENGTH + 2, file_des) != NULL; curr_line_info.line_number++){
-          if (strchr(temp_line, '\n') == NULL && !feof(file_des)) {
-            /* print message and prevent further line processing, as well as second pass.  */
-            print_error(curr_line_info, "Line too long to process. Maximum line length should be %d.",MAX_LINE_LENGTH);
-            is_success = FALSE;
-            /* skip leftovers */
-            do {
-              temp_c = fgetc(file_des);
-            } while (temp_c != '\n' && temp_c != EOF);
-          }
-          else {
-            if (!process_line_fp(curr_line_info, &ic, &dc, code_img, &symbol_table, data)) {
-              if (is_success) {
-                icf = -1;
-                is_success = FALSE;
-							}
-            }
-		      }
-       }
+	init_diagnostics(&diag, options->json_errors);
+	init_data_image(&data);
+	data.auto_align = options->align_data;
+	data.merge_strings = options->merge_strings;
+	data.count_only = options->check; /* and the sizes of it's data */
+	init_source_reader(&reader, file_des, input_filename, &diag);
+
+	if (options->jobs > 1) {
+		is_success = process_lines_parallel(&reader, options, keep_lines, &ic, &dc, words, &symbol_table, &data, &refs, &lst, &diag);
+	}
+	/* read line (after macro expansion) - stop when no more lines, usually when EOF. */
+  while (options->jobs <= 1 && read_source_line(&reader, &curr_line_info)){
+    ic_before = ic;
+    dc_before = dc;
+    if (!process_line_fp(curr_line_info, &ic, &dc, words, &symbol_table, &data, &refs)) {
+      is_success = FALSE;
+    }
+    /* only the addresses are kept, the bytes are taken from the images when the outputs are written */
+    if (keep_lines && is_success) {
+      add_listing_line(&lst, curr_line_info, ic_before, ic, dc_before, dc);
+    }
+    /* a broken file may have thousands of errors - stop at the limit, without the second pass */
+    if (options->max_errors > 0 && diag.error_count >= options->max_errors) {
+      add_note(&diag, curr_line_info, TOO_MANY_ERRORS_ERR, "Stopped after %ld errors.", diag.error_count);
+      is_success = FALSE;
+      break;
+    }
+  }
+  /* line too long or invalid macro definitions prevent the second pass */
+  if (reader.failed) {
+    is_success = FALSE;
+  }
 
   /* save ICF & DCF */
 	icf = ic;
@@ -112,32 +420,229 @@ static bool process_file(char* filename){
 
   /* if first pass success */
 	if (is_success){
-    ic = IC_INIT_VALUE;
+    /* optimize the code while the labels are still unresolved, so the second pass encodes the final addresses */
+    if (options->optimize && !options->check) {
+      optimize_code_image(code_img, &icf, symbol_table, &refs, keep_lines ? &lst : NULL);
+    }
+    /* then remove what the program never reaches, by the labels it uses */
+    if (options->gc && !options->check) {
+      collect_garbage(code_img, &icf, &dcf, symbol_table, &refs, &data, keep_lines ? &lst : NULL);
+    }
 
     /* add IC to each DC for each of the data symbols in table */
     add_value_to_type(symbol_table, icf, DATA_SYMBOL);
 
-    /*start second pass */
-	  rewind(file_des); /* start from the beginning of file again */
-    for (curr_line_info.line_number = 1; !feof(file_des); curr_line_info.line_number++) {
-      int i = 0;
-      fgets(temp_line, MAX_LINE_LENGTH, file_des); /* get line */
-      SKIP_TO_NOT_WHITE(temp_line, i)
-      if (code_img[ic - IC_INIT_VALUE] != NULL || temp_line[i] == '.'){
-        is_success &= process_line_sp(curr_line_info, &ic, code_img, &symbol_table);
-      }
-	  }
-    /* write output files if second pass succeeded */
-		if (is_success) {
-			is_success = write_output_files(code_img, icf, dcf, input_filename, symbol_table, data);
+    /*start second pass - resolve the labels used by the source, without reading it again. a checked source only
+     * checks that the labels are defined */
+    is_success = process_label_refs_sp(&refs, words, &symbol_table);
+
+    /* write output files if second pass succeeded, unless only checking */
+		if (is_success && !options->check) {
+			is_success = write_output_files(code_img, icf, dcf, input_filename, symbol_table, &data, &refs,
+					options->listing ? &lst : NULL, options->relocations, options->ext_format, is_pipe ? &streams : NULL);
+		}
+		/* the lines already have their final addresses, so the map is written from them */
+		if (is_success && keep_lines && options->debug_map) {
+			is_success = write_debug_map(&lst, icf, input_filename);
 		}
   }
+	/* the output files of the source are written together */
+	if (!options->check && !flush_output_files()) {
+		is_success = FALSE;
+	}
 
-	fclose(file_des);
+	/* the standard output may carry the object */
+	flush_diagnostics(&diag, is_pipe ? stderr : output);
+	if (has_streams) {
+		close_output_streams(&streams);
+	}
+	if (!is_pipe) {
+		close_source_file(file_des);
+	}
 	/* free all the pointers: */
+	free_source_reader(&reader); /* free the macros */
 	free(input_filename);  /* free current file name */
+	free_label_refs(&refs); /* free the label references */
+	free_listing(&lst); /* free the listed lines */
+	free_diagnostics(&diag); /* free the printed diagnostics */
 	free_table(symbol_table); /* free symbol table */
-	free_data_word(data, dcf); /* free data image */
-	free_code_image(code_img, icf); /* free code image */
+	free_data_image(&data); /* free data image */
+	free_code_image(code_img, icf - IC_INIT_VALUE); /* free code image */
   return is_success;
-}
\ No newline at end of file
+}
+
+static bool edit_file(char* filename, assembler_options* options){
+	char* input_filename;
+	FILE* file_des;
+	source_reader reader;
+	diagnostics diag;
+	line_info curr_line_info;
+	session ses;
+	char** lines = NULL;
+	char buffer[MAX_LINE_LENGTH + 2];
+	long i, line_count = 0, capacity = 0, first, removed_count, added_count;
+	bool is_success;
+
+	input_filename = malloc_with_check(strlen(filename));
+	strncpy(input_filename, filename, strlen(filename) - 3);
+	input_filename[strlen(filename) - 3] = '\0';
+	if ((file_des = fopen(filename, "r")) == NULL) {
+		printf("Error: cannot open the file: %s.\n", filename);
+		free(input_filename);
+		return FALSE;
+	}
+
+	/* the session is of the lines after the macro expansion, as the first pass sees them */
+	init_diagnostics(&diag, options->json_errors);
+	init_source_reader(&reader, file_des, input_filename, &diag);
+	while (read_source_line(&reader, &curr_line_info)) {
+		if (line_count == capacity) {
+			capacity = capacity == 0 ? 1024 : capacity * 2;
+			lines = (char **) realloc_with_check(lines, capacity * sizeof(char *));
+		}
+		lines[line_count] = (char *) malloc_with_check(strlen(curr_line_info.content) + 1);
+		strcpy(lines[line_count++], curr_line_info.content);
+	}
+	fclose(file_des);
+	is_success = !reader.failed;
+
+	init_session(&ses, input_filename, options->align_data, options->json_errors);
+	if (is_success) {
+		edit_session(&ses, 0, 0, lines, line_count);
+		is_success = get_session_diagnostics(&ses, &diag);
+	}
+	flush_diagnostics(&diag, stdout);
+	printf(".\n");
+	fflush(stdout);
+	for (i = 0; i < line_count; i++) {
+		free(lines[i]);
+	}
+
+	/* an invalid source is not edited */
+	while (!reader.failed && read_edit_line(buffer)) {
+		if (sscanf(buffer, "%ld %ld %ld", &first, &removed_count, &added_count) != 3 || first < 1 || removed_count < 0 ||
+				added_count < 0 || first - 1 + removed_count > ses.line_count) {
+			printf("Error: invalid edit: %s", buffer);
+			printf(".\n");
+			fflush(stdout);
+			continue;
+		}
+		if (added_count > capacity) {
+			capacity = added_count;
+			lines = (char **) realloc_with_check(lines, capacity * sizeof(char *));
+		}
+		for (line_count = 0; line_count < added_count && read_edit_line(buffer); line_count++) {
+			lines[line_count] = (char *) malloc_with_check(strlen(buffer) + 1);
+			strcpy(lines[line_count], buffer);
+		}
+		edit_session(&ses, first - 1, removed_count, lines, line_count);
+		for (i = 0; i < line_count; i++) {
+			free(lines[i]);
+		}
+		is_success = get_session_diagnostics(&ses, &diag);
+		flush_diagnostics(&diag, stdout);
+		printf(".\n");
+		fflush(stdout);
+	}
+
+	free(lines);
+	free_session(&ses);
+	free_source_reader(&reader);
+	free_diagnostics(&diag);
+	free(input_filename);
+	return is_success;
+}
+
+static bool read_edit_line(char* buffer){
+	int c;
+	if (fgets(buffer, MAX_LINE_LENGTH + 2, stdin) == NULL) {
+		return FALSE;
+	}
+	if (strchr(buffer, '\n') == NULL) {
+		while ((c = getchar()) != '\n' && c != EOF)
+			;
+	}
+	return TRUE;
+}
+
+static bool process_lines_parallel(source_reader* reader, assembler_options* options, bool keep_lines, long* ic, long* dc, machine_word** code_img,
+		table* symbol_table, data_image* data, label_ref_list* refs, listing* lst, diagnostics* diag){
+	fp_line* lines = NULL;
+	long i, line_count = 0, capacity = 0;
+	line_info curr_line_info;
+	bool is_success = TRUE;
+	diagnostic* last;
+
+	/* the lines are read in order, as the macros and the includes are expanded by order */
+	for (diag->order = 0; read_source_line(reader, &curr_line_info); diag->order = line_count) {
+		if (line_count == capacity) {
+			capacity = capacity == 0 ? 1024 : capacity * 2;
+			lines = (fp_line *) realloc_with_check(lines, capacity * sizeof(fp_line));
+		}
+		lines[line_count].line = curr_line_info;
+		lines[line_count].line.content = (char *) malloc_with_check(strlen(curr_line_info.content) + 1);
+		strcpy(lines[line_count].line.content, curr_line_info.content);
+		line_count++;
+	}
+	if (line_count > 0) {
+		is_success = process_lines_fp(lines, line_count, options->jobs, ic, dc, code_img, symbol_table, data, refs, diag);
+	}
+
+	for (i = 0; i < line_count; i++) {
+		if (keep_lines && is_success) {
+			add_listing_line(lst, lines[i].line, lines[i].ic, lines[i].ic_end, lines[i].dc, lines[i].dc_end);
+		}
+		free(lines[i].line.content);
+	}
+	free(lines);
+
+	/* the same errors as if the processing stopped at the limit */
+	if (options->max_errors > 0 && diag->error_count >= options->max_errors) {
+		limit_diagnostics(diag, options->max_errors);
+		last = &diag->items[diag->count - 1];
+		curr_line_info.file_name = last->file_name;
+		curr_line_info.line_number = last->line_number;
+		add_note(diag, curr_line_info, TOO_MANY_ERRORS_ERR, "Stopped after %ld errors.", diag->error_count);
+		is_success = FALSE;
+	}
+	return is_success;
+}
+
+static bool open_output_streams(assembler_options* options, output_streams* streams){
+	streams->ob = options->ob_fd < 0 ? stdout : fdopen(options->ob_fd, "w");
+	streams->ent = streams->ext = NULL;
+	streams->sections = options->sections;
+	if (streams->ob == NULL) {
+		printf("Error: cannot write to file descriptor %d.\n", options->ob_fd);
+		return FALSE;
+	}
+	/* the same descriptor is written by a single stream */
+	if (options->ent_fd >= 0) {
+		streams->ent = options->ent_fd == options->ob_fd ? streams->ob : fdopen(options->ent_fd, "w");
+	}
+	if (options->ext_fd >= 0) {
+		streams->ext = options->ext_fd == options->ob_fd ? streams->ob :
+				options->ext_fd == options->ent_fd ? streams->ent : fdopen(options->ext_fd, "w");
+	}
+	if ((options->ent_fd >= 0 && streams->ent == NULL) || (options->ext_fd >= 0 && streams->ext == NULL)) {
+		printf("Error: cannot write to file descriptor %d.\n", streams->ent == NULL && options->ent_fd >= 0 ? options->ent_fd : options->ext_fd);
+		close_output_streams(streams);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void close_output_streams(output_streams* streams){
+	if (streams->ext != NULL && streams->ext != streams->ob && streams->ext != streams->ent) {
+		fclose(streams->ext);
+	}
+	if (streams->ent != NULL && streams->ent != streams->ob) {
+		fclose(streams->ent);
+	}
+	if (streams->ob != stdout) {
+		fclose(streams->ob);
+	}
+	else {
+		fflush(stdout);
+	}
+}
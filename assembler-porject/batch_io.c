@@ -0,0 +1,505 @@
+/* Implements the batched I/O with the raw io_uring system calls, and the usual reads and writes where there's none */
+/* for syscall, fmemopen and open_memstream */
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAS_IO_URING
+#endif
+#endif
+#if defined(HAS_IO_URING) && !defined(__NR_io_uring_setup)
+#undef HAS_IO_URING
+#endif
+#include "batch_io.h"
+#include "utils.h"
+
+/* The states of a file of a batch */
+typedef enum io_state {
+	IO_WAITING = 0, /* not submitted yet */
+	IO_OPENING,
+	IO_READING,
+	IO_WRITING,
+	IO_DONE,
+	IO_FAILED
+} io_state;
+
+/* A source file read ahead, or an output file to write */
+typedef struct io_file {
+	char* name;
+	bool is_output;
+	io_state state;
+	int fd;
+	char* bytes; /* the bytes read, or the text to write */
+	size_t size; /* the file size of a source, the text length of an output */
+	size_t done; /* the bytes read or written so far */
+	FILE* stream; /* the memory stream of the file, while it's open */
+	bool is_taken; /* whether a source was opened already */
+} io_file;
+
+/* The files of a batch, in the order they're submitted */
+typedef struct io_batch {
+	io_file** files;
+	long count;
+	long capacity;
+	long next_open; /* the first file that wasn't submitted */
+	long window_end; /* the sources are read ahead up to here */
+} io_batch;
+
+#ifdef HAS_IO_URING
+/* The mapped rings of io_uring */
+typedef struct io_ring {
+	int fd;
+	unsigned *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe* sqes;
+	struct io_uring_cqe* cqes;
+	void *sq_map, *cq_map;
+	size_t sq_map_size, cq_map_size, sqes_size;
+	unsigned queued; /* prepared, and not submitted yet */
+	unsigned in_flight; /* submitted, and not completed yet */
+} io_ring;
+
+static io_ring ring;
+#endif
+
+/* Whether the ring is set up: 0 if not tried yet, 1 if it is, -1 if io_uring isn't available */
+static int ring_status = 0;
+static io_batch sources = {NULL, 0, 0, 0, 0};
+static io_batch outputs = {NULL, 0, 0, 0, 0};
+/* Guards the batches and the ring, for the files checked together */
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Sets up the ring once, and checks that the kernel supports the operations of the batches
+ * @return Whether the ring is available
+ */
+static bool setup_ring(void);
+
+/**
+ * Adds a new file to a batch
+ * @param batch The batch
+ * @param name The file name
+ * @param is_output Whether it's an output file
+ * @return The file
+ */
+static io_file* add_batch_file(io_batch* batch, char* name, bool is_output);
+
+/**
+ * Submits the waiting files that fit in the ring: the closed output files, and the sources in the read ahead window
+ */
+static void submit_waiting_files(void);
+
+/**
+ * Submits the prepared operations, and waits for at least one completion
+ * @return Whether anything completed - FALSE if nothing is in flight
+ */
+static bool wait_for_files(void);
+
+#ifdef HAS_IO_URING
+/**
+ * Prepares the next operation of a file in the ring, by it's state
+ * @param file The file
+ */
+static void queue_file_operation(io_file* file);
+
+/**
+ * Handles the completion of an operation of a file, and prepares it's next one
+ * @param file The file
+ * @param result The result of the operation
+ */
+static void complete_file_operation(io_file* file, int result);
+
+/**
+ * Marks a file as failed, and closes it
+ * @param file The file
+ */
+static void fail_file(io_file* file);
+#endif
+
+void start_source_reads(char** filenames, int count){
+	int i;
+
+	if (!setup_ring()) {
+		return;
+	}
+	pthread_mutex_lock(&batch_lock);
+	for (i = 0; i < count; i++) {
+		if (strcmp(filenames[i], STDIN_FILE_NAME) != 0) {
+			add_batch_file(&sources, filenames[i], FALSE);
+		}
+	}
+	sources.window_end = IO_RING_ENTRIES;
+	submit_waiting_files();
+	pthread_mutex_unlock(&batch_lock);
+}
+
+FILE* open_source_file(char* filename){
+	io_file* file = NULL;
+	FILE* stream = NULL;
+	long i;
+
+	pthread_mutex_lock(&batch_lock);
+	for (i = 0; i < sources.count && file == NULL; i++) {
+		if (!sources.files[i]->is_taken && strcmp(sources.files[i]->name, filename) == 0) {
+			file = sources.files[i];
+		}
+	}
+	if (file != NULL) {
+		file->is_taken = TRUE;
+		/* the files after it are read while it's assembled */
+		if (i + IO_RING_ENTRIES > sources.window_end) {
+			sources.window_end = i + IO_RING_ENTRIES;
+		}
+		submit_waiting_files();
+		while (file->state != IO_DONE && file->state != IO_FAILED && wait_for_files())
+			;
+		if (file->state == IO_DONE && file->size > 0) {
+			stream = file->stream = fmemopen(file->bytes, file->size, "r");
+		}
+	}
+	pthread_mutex_unlock(&batch_lock);
+	/* a file that wasn't read ahead, or failed to, is opened as usual - and reported as usual if it can't be */
+	return stream != NULL ? stream : fopen(filename, "r");
+}
+
+void close_source_file(FILE* file){
+	long i;
+
+	pthread_mutex_lock(&batch_lock);
+	for (i = 0; i < sources.count; i++) {
+		if (sources.files[i]->stream == file) {
+			sources.files[i]->stream = NULL;
+			free(sources.files[i]->bytes);
+			sources.files[i]->bytes = NULL;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&batch_lock);
+	fclose(file);
+}
+
+FILE* open_output_file(char* filename){
+	io_file* file;
+	FILE* stream;
+
+	if (!setup_ring()) {
+		return fopen(filename, "w");
+	}
+	pthread_mutex_lock(&batch_lock);
+	file = add_batch_file(&outputs, filename, TRUE);
+	stream = file->stream = open_memstream(&file->bytes, &file->size);
+	if (stream == NULL) {
+		/* written as usual */
+		free(file->name);
+		free(file);
+		outputs.count--;
+	}
+	pthread_mutex_unlock(&batch_lock);
+	return stream != NULL ? stream : fopen(filename, "w");
+}
+
+bool close_output_file(FILE* file){
+	long i;
+	bool is_success = TRUE, found = FALSE;
+
+	pthread_mutex_lock(&batch_lock);
+	for (i = 0; i < outputs.count && !found; i++) {
+		if (outputs.files[i]->stream == file) {
+			/* the text is complete once the stream is closed */
+			is_success = fclose(file) == 0;
+			outputs.files[i]->stream = NULL;
+			found = TRUE;
+		}
+	}
+	pthread_mutex_unlock(&batch_lock);
+	return found ? is_success : fclose(file) == 0;
+}
+
+bool flush_output_files(void){
+	io_file* file;
+	long i;
+	bool is_success = TRUE, is_pending = TRUE;
+
+	pthread_mutex_lock(&batch_lock);
+	for (i = 0; i < outputs.count; i++) {
+		if (outputs.files[i]->stream != NULL) {
+			fclose(outputs.files[i]->stream);
+			outputs.files[i]->stream = NULL;
+		}
+	}
+	submit_waiting_files();
+	while (is_pending && wait_for_files()) {
+		for (i = 0, is_pending = FALSE; i < outputs.count && !is_pending; i++) {
+			is_pending = outputs.files[i]->state != IO_DONE && outputs.files[i]->state != IO_FAILED;
+		}
+	}
+	for (i = 0; i < outputs.count; i++) {
+		file = outputs.files[i];
+		if (file->state != IO_DONE) {
+			printf("Can't create or rewrite to file %s.\n", file->name);
+			is_success = FALSE;
+		}
+		free(file->name);
+		free(file->bytes);
+		free(file);
+	}
+	outputs.count = outputs.next_open = 0;
+	pthread_mutex_unlock(&batch_lock);
+	return is_success;
+}
+
+void end_batch_io(void){
+	long i;
+	io_file* file;
+
+	pthread_mutex_lock(&batch_lock);
+	/* nothing more is submitted, and the reads in flight still write into their buffers */
+	sources.next_open = sources.count;
+	while (wait_for_files())
+		;
+	for (i = 0; i < sources.count; i++) {
+		file = sources.files[i];
+		if (file->stream != NULL) {
+			fclose(file->stream);
+		}
+		if (file->fd >= 0) {
+			close(file->fd);
+		}
+		free(file->name);
+		free(file->bytes);
+		free(file);
+	}
+	free(sources.files);
+	free(outputs.files);
+	sources.files = outputs.files = NULL;
+	sources.count = sources.capacity = outputs.count = outputs.capacity = 0;
+#ifdef HAS_IO_URING
+	if (ring_status == 1) {
+		munmap(ring.sqes, ring.sqes_size);
+		munmap(ring.cq_map, ring.cq_map_size);
+		munmap(ring.sq_map, ring.sq_map_size);
+		close(ring.fd);
+		ring_status = 0;
+	}
+#endif
+	pthread_mutex_unlock(&batch_lock);
+}
+
+static io_file* add_batch_file(io_batch* batch, char* name, bool is_output){
+	io_file* file = (io_file *) malloc_with_check(sizeof(io_file));
+	if (batch->count == batch->capacity) {
+		batch->capacity = batch->capacity == 0 ? 16 : batch->capacity * 2;
+		batch->files = (io_file **) realloc_with_check(batch->files, batch->capacity * sizeof(io_file *));
+	}
+	file->name = copy_string(name);
+	file->is_output = is_output;
+	file->state = IO_WAITING;
+	file->fd = -1;
+	file->bytes = NULL;
+	file->size = file->done = 0;
+	file->stream = NULL;
+	file->is_taken = FALSE;
+	batch->files[batch->count++] = file;
+	return file;
+}
+
+#ifdef HAS_IO_URING
+static void fail_file(io_file* file){
+	if (file->fd >= 0) {
+		close(file->fd);
+		file->fd = -1;
+	}
+	file->state = IO_FAILED;
+}
+
+static bool setup_ring(void){
+	struct io_uring_params params;
+	struct io_uring_probe* probe;
+	bool is_supported;
+
+	pthread_mutex_lock(&batch_lock);
+	if (ring_status != 0) {
+		pthread_mutex_unlock(&batch_lock);
+		return ring_status == 1;
+	}
+	ring_status = -1;
+	memset(&params, 0, sizeof(params));
+	if ((ring.fd = (int) syscall(__NR_io_uring_setup, IO_RING_ENTRIES, &params)) < 0) {
+		pthread_mutex_unlock(&batch_lock);
+		return FALSE;
+	}
+	/* the opens and the reads and writes by offset are newer than io_uring itself */
+	probe = (struct io_uring_probe *) malloc_with_check(sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op));
+	memset(probe, 0, sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op));
+	is_supported = syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+			probe->last_op >= IORING_OP_WRITE && (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED) &&
+			(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) && (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+	free(probe);
+
+	ring.sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring.cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	ring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring.sq_map = ring.cq_map = ring.sqes = MAP_FAILED;
+	if (is_supported) {
+		ring.sq_map = mmap(NULL, ring.sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+		ring.cq_map = mmap(NULL, ring.cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_CQ_RING);
+		ring.sqes = mmap(NULL, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+	}
+	if (ring.sq_map == MAP_FAILED || ring.cq_map == MAP_FAILED || ring.sqes == MAP_FAILED) {
+		if (ring.sq_map != MAP_FAILED) {
+			munmap(ring.sq_map, ring.sq_map_size);
+		}
+		if (ring.cq_map != MAP_FAILED) {
+			munmap(ring.cq_map, ring.cq_map_size);
+		}
+		if (ring.sqes != MAP_FAILED) {
+			munmap(ring.sqes, ring.sqes_size);
+		}
+		close(ring.fd);
+		pthread_mutex_unlock(&batch_lock);
+		return FALSE;
+	}
+	ring.sq_tail = (unsigned *) ((char *) ring.sq_map + params.sq_off.tail);
+	ring.sq_mask = (unsigned *) ((char *) ring.sq_map + params.sq_off.ring_mask);
+	ring.sq_array = (unsigned *) ((char *) ring.sq_map + params.sq_off.array);
+	ring.cq_head = (unsigned *) ((char *) ring.cq_map + params.cq_off.head);
+	ring.cq_tail = (unsigned *) ((char *) ring.cq_map + params.cq_off.tail);
+	ring.cq_mask = (unsigned *) ((char *) ring.cq_map + params.cq_off.ring_mask);
+	ring.cqes = (struct io_uring_cqe *) ((char *) ring.cq_map + params.cq_off.cqes);
+	ring.queued = ring.in_flight = 0;
+	ring_status = 1;
+	pthread_mutex_unlock(&batch_lock);
+	return TRUE;
+}
+
+static void submit_waiting_files(void){
+	io_file* file;
+
+	/* each file has a single operation in flight, so the completions never overflow */
+	while (ring.in_flight + ring.queued < IO_RING_ENTRIES && outputs.next_open < outputs.count &&
+			outputs.files[outputs.next_open]->stream == NULL) {
+		file = outputs.files[outputs.next_open++];
+		file->state = IO_OPENING;
+		queue_file_operation(file);
+	}
+	while (ring.in_flight + ring.queued < IO_RING_ENTRIES && sources.next_open < sources.count &&
+			sources.next_open < sources.window_end) {
+		file = sources.files[sources.next_open++];
+		file->state = IO_OPENING;
+		queue_file_operation(file);
+	}
+}
+
+static void queue_file_operation(io_file* file){
+	unsigned tail = *ring.sq_tail;
+	unsigned index = tail & *ring.sq_mask;
+	struct io_uring_sqe* sqe = &ring.sqes[index];
+
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	if (file->state == IO_OPENING) {
+		sqe->opcode = IORING_OP_OPENAT;
+		sqe->fd = AT_FDCWD;
+		sqe->addr = (unsigned long) file->name;
+		sqe->open_flags = file->is_output ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY;
+		sqe->len = 0666;
+	}
+	else {
+		sqe->opcode = file->state == IO_READING ? IORING_OP_READ : IORING_OP_WRITE;
+		sqe->fd = file->fd;
+		sqe->addr = (unsigned long) (file->bytes + file->done);
+		sqe->len = (unsigned) (file->size - file->done);
+		sqe->off = file->done;
+	}
+	sqe->user_data = (unsigned long) file;
+	ring.sq_array[index] = index;
+	__atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+	ring.queued++;
+}
+
+static void complete_file_operation(io_file* file, int result){
+	struct stat file_stat;
+
+	if (result < 0) {
+		fail_file(file);
+		return;
+	}
+	if (file->state == IO_OPENING) {
+		file->fd = result;
+		if (!file->is_output) {
+			if (fstat(file->fd, &file_stat) != 0) {
+				fail_file(file);
+				return;
+			}
+			file->size = (size_t) file_stat.st_size;
+			file->bytes = (char *) malloc_with_check(file->size + 1);
+		}
+		file->state = file->is_output ? IO_WRITING : IO_READING;
+	}
+	else if (result == 0 && file->state == IO_WRITING) {
+		fail_file(file);
+		return;
+	}
+	else {
+		/* a file that got shorter ends where it's read ended */
+		file->size = result == 0 ? file->done : file->size;
+		file->done += result;
+	}
+	if (file->done < file->size) {
+		queue_file_operation(file);
+		return;
+	}
+	close(file->fd);
+	file->fd = -1;
+	file->state = IO_DONE;
+}
+
+static bool wait_for_files(void){
+	unsigned head, tail;
+	int submitted;
+	struct io_uring_cqe* cqe;
+
+	if (ring_status != 1 || ring.in_flight + ring.queued == 0) {
+		return FALSE;
+	}
+	while ((submitted = (int) syscall(__NR_io_uring_enter, ring.fd, ring.queued, 1, IORING_ENTER_GETEVENTS, NULL, 0)) < 0 &&
+			errno == EINTR)
+		;
+	if (submitted < 0) {
+		return FALSE;
+	}
+	ring.queued -= submitted;
+	ring.in_flight += submitted;
+	head = *ring.cq_head;
+	tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+	for ( ; head != tail; head++) {
+		cqe = &ring.cqes[head & *ring.cq_mask];
+		ring.in_flight--;
+		complete_file_operation((io_file *) (unsigned long) cqe->user_data, cqe->res);
+	}
+	__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+	submit_waiting_files();
+	return TRUE;
+}
+#else
+static bool setup_ring(void){
+	ring_status = -1;
+	return FALSE;
+}
+
+static void submit_waiting_files(void){
+}
+
+static bool wait_for_files(void){
+	return FALSE;
+}
+#endif
@@ -0,0 +1,62 @@
+/* The batched I/O of the source files and of the output files: the opens, the full reads and the writes of many
+ * files are submitted together through io_uring, and the files are handed to the passes as their reads complete.
+ * Where the kernel has no io_uring, the files are read and written as usual. */
+#ifndef _BATCH_IO_H
+#define _BATCH_IO_H
+#include <stdio.h>
+#include "globals.h"
+
+/** The operations in flight at once, and the source files read ahead of the one being assembled */
+#define IO_RING_ENTRIES 64
+
+/**
+ * Starts reading the source files, in the order they're assembled: their opens and full reads are submitted in
+ * batches, and the files are read while the ones before them are assembled. Nothing is read ahead where io_uring
+ * isn't available.
+ * @param filenames The file names, the standard input ("-") is read as usual
+ * @param count The files count
+ */
+void start_source_reads(char** filenames, int count);
+
+/**
+ * Opens a source file for reading. A file that is read ahead is read from memory once it's read completes,
+ * and any other file - or one that failed to be read ahead - is opened as usual.
+ * @param filename The file name
+ * @return The stream, NULL if the file can't be opened
+ */
+FILE* open_source_file(char* filename);
+
+/**
+ * Closes a source file, and frees the memory it was read into
+ * @param file The stream of open_source_file
+ */
+void close_source_file(FILE* file);
+
+/**
+ * Opens an output file for writing. The text is kept in memory, and written with the other output files
+ * by flush_output_files.
+ * @param filename The file name
+ * @return The stream, NULL if the file can't be opened
+ */
+FILE* open_output_file(char* filename);
+
+/**
+ * Closes an output file: it's text is queued to be written by flush_output_files
+ * @param file The stream of open_output_file
+ * @return Whether succeeded
+ */
+bool close_output_file(FILE* file);
+
+/**
+ * Writes all the closed output files, their opens and writes submitted together. A file that can't be written
+ * is reported.
+ * @return Whether all of them were written
+ */
+bool flush_output_files(void);
+
+/**
+ * Deallocates the ring and the files that weren't opened, when no more files are processed
+ */
+void end_batch_io(void);
+
+#endif
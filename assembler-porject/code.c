@@ -1,92 +1,98 @@
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
-#include <stdarg.h>
 #include <stdlib.h>
 #include "code.h"
 #include "utils.h"
 
 /**
- * Validates the operands type, and prints error message if needed.
- * @param line The current line information
- * @param op1_type The current type of the first operand
- * @param op2_type The current type of the second operand
- * @param op3_type The current type of the third operand
- * @param op1_valid_type_count The count of valid types for the first operand
- * @param op2_valid_type_count The count of valid types for the second operand
- * @param op3_valid_type_count The count of valid types for the third operand
- * @param ... The valid types for operand
- * @return Whether the types are valid 
- */
-static bool validate_operand_type(line_info line, operand_type op1_type, operand_type op2_type, operand_type op3_type,
-		int op1_valid_type_count, int op2_valid_type_count,int op3_valid_type_count,...); 
-
-/**
- * Validates the operands count by the opcode of the command
+ * Validates the operands count, types and immediate values by the command descriptor, and prints error message if needed.
  * @param line The current source line info
- * @param op1_type The type of the first operand
- * @param op2_type The type of the second operand
- * @param op3_type The type of the third operand
- * @param curr_opcode The opcode of the current command
+ * @param command The descriptor of the command
+ * @param operands The operands
+ * @param types The types of the operands
  * @param op_count The operand count of the current commad
  * @return Whether the operands are valids
  */
-static bool validate_operand_by_opcode(line_info line, operand_type op1_type,operand_type op2_type, operand_type op3_type, opcode curr_opcode,
-   int op_count); 
+static bool validate_operands(line_info line, command_descriptor* command, char* operands[3], operand_type types[MAX_OPERANDS],
+		int op_count);
 
-
-/* A single lookup table element */
-struct cmd_lookup_element {
-	char *cmd;
-	opcode opc;
-	funct func;
+/* The commands, their encoding and their operands. adding a command is adding it's descriptor */
+static command_descriptor command_table[] = {
+		{"add", ADD_OP, ADD_FUNCT, 'r', 3, {REGISTER_OPERAND, REGISTER_OPERAND, REGISTER_OPERAND}, {RS_FIELD, RT_FIELD, RD_FIELD}},
+		{"sub", SUB_OP, SUB_FUNCT, 'r', 3, {REGISTER_OPERAND, REGISTER_OPERAND, REGISTER_OPERAND}, {RS_FIELD, RT_FIELD, RD_FIELD}},
+		{"and", AND_OP, AND_FUNCT, 'r', 3, {REGISTER_OPERAND, REGISTER_OPERAND, REGISTER_OPERAND}, {RS_FIELD, RT_FIELD, RD_FIELD}},
+		{"or", OR_OP, OR_FUNCT, 'r', 3, {REGISTER_OPERAND, REGISTER_OPERAND, REGISTER_OPERAND}, {RS_FIELD, RT_FIELD, RD_FIELD}},
+		{"nor", NOR_OP, NOR_FUNCT, 'r', 3, {REGISTER_OPERAND, REGISTER_OPERAND, REGISTER_OPERAND}, {RS_FIELD, RT_FIELD, RD_FIELD}},
+		{"move", MOVE_OP, MOVE_FUNCT, 'r', 2, {REGISTER_OPERAND, REGISTER_OPERAND, 0}, {RS_FIELD, RD_FIELD, NO_FIELD}},
+		{"mvhi", MVHI_OP, MVHI_FUNCT, 'r', 2, {REGISTER_OPERAND, REGISTER_OPERAND, 0}, {RS_FIELD, RD_FIELD, NO_FIELD}},
+		{"mvlo", MVLO_OP, MVLO_FUNCT, 'r', 2, {REGISTER_OPERAND, REGISTER_OPERAND, 0}, {RS_FIELD, RD_FIELD, NO_FIELD}},
+		{"addi", ADDI_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, IMMEDIATE_OPERAND, REGISTER_OPERAND}, {RS_FIELD, IMMED_FIELD, RT_FIELD}},
+		{"subi", SUBI_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, IMMEDIATE_OPERAND, REGISTER_OPERAND}, {RS_FIELD, IMMED_FIELD, RT_FIELD}},
+		{"andi", ANDI_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, IMMEDIATE_OPERAND, REGISTER_OPERAND}, {RS_FIELD, IMMED_FIELD, RT_FIELD}},
+		{"ori", ORI_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, IMMEDIATE_OPERAND, REGISTER_OPERAND}, {RS_FIELD, IMMED_FIELD, RT_FIELD}},
+		{"nori", NORI_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, IMMEDIATE_OPERAND, REGISTER_OPERAND}, {RS_FIELD, IMMED_FIELD, RT_FIELD}},
+		{"bne", BNE_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, REGISTER_OPERAND, LABEL_OPERAND}, {RS_FIELD, RT_FIELD, OFFSET_FIELD}},
+		{"beq", BEQ_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, REGISTER_OPERAND, LABEL_OPERAND}, {RS_FIELD, RT_FIELD, OFFSET_FIELD}},
+		{"blt", BLT_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, REGISTER_OPERAND, LABEL_OPERAND}, {RS_FIELD, RT_FIELD, OFFSET_FIELD}},
+		{"bgt", BGT_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, REGISTER_OPERAND, LABEL_OPERAND}, {RS_FIELD, RT_FIELD, OFFSET_FIELD}},
+		{"lb", LB_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, IMMEDIATE_OPERAND, REGISTER_OPERAND}, {RS_FIELD, IMMED_FIELD, RT_FIELD}},
+		{"sb", SB_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, IMMEDIATE_OPERAND, REGISTER_OPERAND}, {RS_FIELD, IMMED_FIELD, RT_FIELD}},
+		{"lw", LW_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, IMMEDIATE_OPERAND, REGISTER_OPERAND}, {RS_FIELD, IMMED_FIELD, RT_FIELD}},
+		{"sw", SW_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, IMMEDIATE_OPERAND, REGISTER_OPERAND}, {RS_FIELD, IMMED_FIELD, RT_FIELD}},
+		{"lh", LH_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, IMMEDIATE_OPERAND, REGISTER_OPERAND}, {RS_FIELD, IMMED_FIELD, RT_FIELD}},
+		{"sh", SH_OP, NONE_FUNCT, 'i', 3, {REGISTER_OPERAND, IMMEDIATE_OPERAND, REGISTER_OPERAND}, {RS_FIELD, IMMED_FIELD, RT_FIELD}},
+		{"jmp", JMP_OP, NONE_FUNCT, 'j', 1, {REGISTER_OPERAND | LABEL_OPERAND, 0, 0}, {ADDRESS_FIELD, NO_FIELD, NO_FIELD}},
+		{"la", LA_OP, NONE_FUNCT, 'j', 1, {LABEL_OPERAND, 0, 0}, {ADDRESS_FIELD, NO_FIELD, NO_FIELD}},
+		{"call", CALL_OP, NONE_FUNCT, 'j', 1, {LABEL_OPERAND, 0, 0}, {ADDRESS_FIELD, NO_FIELD, NO_FIELD}},
+		{"stop", STOP_OP, NONE_FUNCT, 'j', 0, {0, 0, 0}, {NO_FIELD, NO_FIELD, NO_FIELD}},
+		{NULL, NONE_OP, NONE_FUNCT, 0, 0, {0, 0, 0}, {NO_FIELD, NO_FIELD, NO_FIELD}}
 };
 
-/* A lookup table for opcode & funct by command name */
-static struct cmd_lookup_element lookup_table[] = {
-		{"add", ADD_OP, ADD_FUNCT},
-		{"sub",SUB_OP, SUB_FUNCT},
-		{"and",AND_OP, AND_FUNCT},
-		{"or",OR_OP, OR_FUNCT},
-		{"nor",NOR_OP, NOR_FUNCT},
-		{"move",MOVE_OP, MOVE_FUNCT},
-		{"mvhi",MVHI_OP, MVHI_FUNCT},
-		{"mvlo",MVLO_OP, MVLO_FUNCT},
-		{"addi",ADDI_OP, NONE_FUNCT},
-		{"subi",SUBI_OP, NONE_FUNCT},
-    {"andi",ANDI_OP, NONE_FUNCT},
-		{"ori",ORI_OP, NONE_FUNCT},
-		{"nori",NORI_OP, NONE_FUNCT},
-		{"bne",BNE_OP, NONE_FUNCT},
-		{"beq",BEQ_OP, NONE_FUNCT},
-		{"blt",BLT_OP, NONE_FUNCT},
-    {"bgt",BGT_OP, NONE_FUNCT},
-		{"lb",LB_OP, NONE_FUNCT},
-		{"sb",SB_OP, NONE_FUNCT},
-		{"lw",LW_OP, NONE_FUNCT},
-		{"sw",SW_OP, NONE_FUNCT},
-		{"lh",LH_OP, NONE_FUNCT},
-		{"sh",SH_OP, NONE_FUNCT},
-		{"jmp",JMP_OP, NONE_FUNCT},
-		{"la",LA_OP, NONE_FUNCT},
-		{"call",CALL_OP, NONE_FUNCT},
-		{"stop",STOP_OP, NONE_FUNCT},
-		{NULL, NONE_OP, NONE_FUNCT}
-};
+command_descriptor* get_command_descriptor(char* name) {
+	command_descriptor *e;
+	for (e = command_table; e->name != NULL; e++) {
+		if (strcmp(e->name, name) == 0) {
+			return e;
+		}
+	}
+	return NULL;
+}
 
-void get_opcode_and_funct(char* cmd, opcode* opcode_des, funct* funct_des) {
-	struct cmd_lookup_element *e;
-	*opcode_des = NONE_OP;
-	*funct_des = NONE_FUNCT;
+command_descriptor* get_command_by_code(opcode opc, funct func) {
+	command_descriptor *e;
+	for (e = command_table; e->name != NULL; e++) {
+		if (e->opc == opc && e->func == func) {
+			return e;
+		}
+	}
+	return NULL;
+}
 
-	/* iterate through the lookup table, if commands are same return the opcode of found. */
-	for (e = lookup_table; e->cmd != NULL; e++) {
-		if (strcmp(e->cmd, cmd) == 0) {
-			*opcode_des = e->opc;
-			*funct_des = e->func;
-			return;
+operand_field get_label_field(code_word* word) {
+	int i;
+	command_descriptor* command;
+	/* only the R commands have funct, and they have no labels */
+	if (word->command == 'r' || (command = get_command_by_code(word->opcode, NONE_FUNCT)) == NULL) {
+		return NO_FIELD;
+	}
+	for (i = 0; i < command->operand_count; i++) {
+		if (command->operand_kinds[i] & LABEL_OPERAND) {
+			return command->fields[i];
 		}
 	}
+	return NO_FIELD;
+}
+
+void get_opcode_and_funct(char* cmd, opcode* opcode_des, funct* funct_des) {
+	command_descriptor* command = get_command_descriptor(cmd);
+	*opcode_des = command != NULL ? command->opc : NONE_OP;
+	*funct_des = command != NULL ? command->func : NONE_FUNCT;
+}
+
+char* get_command_name(opcode opc, funct func) {
+	command_descriptor* command = get_command_by_code(opc, func);
+	return command != NULL ? command->name : NULL;
 }
 
 int get_register_by_name(char *name) {
@@ -115,12 +121,12 @@ bool get_operands(line_info line, int i, char** destination, int* operand_count,
 	destination[0] = destination[1] = destination[2] = NULL;
 	SKIP_TO_NOT_WHITE(line.content, i)
   if (line.content[i] == ',') {
-		print_error(line, "Unexpected comma after command.");
+		print_error_at(line, i, OPERAND_SYNTAX_ERR, "Unexpected comma after command.");
 		return FALSE; /* an error occurred */
 	}
   for (*operand_count = 0; line.content[i] != EOF && line.content[i] != '\n' && line.content[i]; ) {
     if(*operand_count == 3){
-      print_error(line, "Too many operands for operation", *operand_count);
+      print_error_at(line, i, OPERAND_COUNT_ERR, "Too many operands for operation", *operand_count);
 			free(destination[0]);
 			free(destination[1]);
       free(destination[2]); 
@@ -143,7 +149,7 @@ bool get_operands(line_info line, int i, char** destination, int* operand_count,
     }
     else if(line.content[i] != ','){
       /* after operand and after white chars there's something that isn't ',' or end of line.. */
-			print_error(line, "Expecting ',' between operands");
+			print_error_at(line, i, OPERAND_SYNTAX_ERR, "Expecting ',' between operands");
 
       /* release operands dynamically allocated memory */
       while(*operand_count > 0){
@@ -157,10 +163,10 @@ bool get_operands(line_info line, int i, char** destination, int* operand_count,
 		SKIP_TO_NOT_WHITE(line.content, i)
     /* if there was just a comma, then (optionally) white char(s) and then end of line */
 		if (line.content[i] == '\n' || line.content[i] == EOF || !line.content[i]){
-      print_error(line, "Missing operand after comma.");
+      print_error_at(line, i, OPERAND_SYNTAX_ERR, "Missing operand after comma.");
     }
     else if (line.content[i] == ','){
-      print_error(line, "Multiple consecutive commas.");
+      print_error_at(line, i, OPERAND_SYNTAX_ERR, "Multiple consecutive commas.");
     }
     else{
       continue; /* no errors, continue */
@@ -176,82 +182,92 @@ bool get_operands(line_info line, int i, char** destination, int* operand_count,
   return TRUE;
 }
 
-code_word* build_code_word(line_info line, opcode curr_opcode, funct curr_funct, int op_count, char* operands[3], table* tab){
-  code_word* codeword;
-  long value;
-  i_command* i_cmd;
-  r_command* r_cmd;
-  j_command* j_cmd;
+bool check_code_operands(line_info line, command_descriptor* command, int op_count, char* operands[3]){
+  int i;
+  operand_type types[MAX_OPERANDS];
   /* get operands types and validate them */
-	operand_type op1_type = op_count >= 1 ? get_operand_type(operands[0]) : NONE_TYPE;
-	operand_type op2_type = op_count >= 2 ? get_operand_type(operands[1]) : NONE_TYPE;
-  operand_type op3_type = op_count == 3 ? get_operand_type(operands[2]) : NONE_TYPE;
+  for (i = 0; i < MAX_OPERANDS; i++) {
+    types[i] = i < op_count ? get_operand_type(operands[i]) : NONE_TYPE;
+  }
+  return validate_operands(line, command, operands, types, op_count);
+}
 
-  /* validate operands by opcode */
-	if (!validate_operand_by_opcode(line, op1_type, op2_type, op3_type, curr_opcode, op_count)) {
+code_word* build_code_word(line_info line, command_descriptor* command, int op_count, char* operands[3], table* tab){
+  code_word* codeword;
+  int i;
+  long value;
+  operand_type type;
+  i_command* i_cmd = NULL;
+  r_command* r_cmd = NULL;
+  j_command* j_cmd = NULL;
+	if (!check_code_operands(line, command, op_count, operands)) {
 		return NULL;
 	}
   /* create the code word by the data */
 	codeword = (code_word *) malloc_with_check(sizeof(code_word));
-  codeword->opcode = curr_opcode;
-  /* check if need to set the registers bits */
-  if (curr_opcode >= ADD_OP && curr_opcode <= MVLO_OP) { /* R COMMAND */
-    codeword->command = 'r';
+  codeword->opcode = command->opc;
+  codeword->command = command->format;
+  /* the fields without operands are 0 */
+  if (command->format == 'r') {
     r_cmd = (r_command *) malloc_with_check(sizeof(r_command));
-    r_cmd->funct = curr_funct; /*if no funct, curr_funct = NONE_FUNCT = 0 */
-    r_cmd->NONE = 0;
-    /* default values of register bits are 0 */
-    r_cmd->rt = r_cmd->rd = r_cmd->rs = 0;
-    r_cmd->rs = get_register_by_name(operands[0]);
-    if(op_count == 2){
-      r_cmd->rd = get_register_by_name(operands[1]);
-    }
-    else if(op_count == 3){
-      r_cmd->rt = get_register_by_name(operands[1]);
-      r_cmd->rd = get_register_by_name(operands[2]);
-    }
+    r_cmd->funct = command->func;
+    r_cmd->NONE = r_cmd->rt = r_cmd->rd = r_cmd->rs = 0;
     (codeword->commad_type).r = r_cmd;
   }
-  else if( (curr_opcode >= ADDI_OP && curr_opcode <= NORI_OP) || (curr_opcode >= LB_OP && curr_opcode <= SH_OP)){ /* I COMMAND */
-    codeword->command = 'i';
-    i_cmd = (i_command *) malloc_with_check (sizeof(i_command));
-    i_cmd->rs = get_register_by_name(operands[0]);
-    i_cmd->immed = atoi(operands[1]);
-    i_cmd->rt = get_register_by_name(operands[2]);
-    (codeword->commad_type).i = i_cmd;
-  }
-  else if(curr_opcode >= BNE_OP && curr_opcode <= BGT_OP){ /* I COMMAND */
-    codeword->command = 'i';
-    i_cmd = (i_command *) malloc_with_check (sizeof(i_command));
-    i_cmd->rs = get_register_by_name(operands[0]);
-    i_cmd->rt = get_register_by_name(operands[1]);
-    
-    i_cmd->immed = atoi(operands[2]); 
+  else if (command->format == 'i') {
+    i_cmd = (i_command *) malloc_with_check(sizeof(i_command));
+    i_cmd->immed = i_cmd->rt = i_cmd->rs = 0;
     (codeword->commad_type).i = i_cmd;
   }
-  else if(curr_opcode >= JMP_OP && curr_opcode <= STOP_OP){ /* J COMMAND */
-    codeword->command = 'j';
+  else {
     j_cmd = (j_command *) malloc_with_check(sizeof(j_command));
-    if(op1_type == LABEL_TYPE){
-      j_cmd->reg = 0;
-      value = find_by_name(*tab, operands[0]);
-      j_cmd->address = value;
-    }
-    else if(op1_type == REGISTER_TYPE){
-      j_cmd->reg = 1;
-      j_cmd->address = get_register_by_name(operands[0]);
-    }
-    else if(curr_opcode == STOP_OP){
-      j_cmd->reg = 0;
-      j_cmd->address = 0;
-    }
+    j_cmd->reg = j_cmd->address = 0;
     (codeword->commad_type).j = j_cmd;
   }
+
+  /* each operand into it's field. bit fields have no address, so each is assigned by it's own */
+  for (i = 0; i < op_count; i++) {
+    switch (command->fields[i]) {
+      case RS_FIELD:
+        if (r_cmd != NULL) {
+          r_cmd->rs = get_register_by_name(operands[i]);
+        }
+        else {
+          i_cmd->rs = get_register_by_name(operands[i]);
+        }
+        break;
+      case RT_FIELD:
+        if (r_cmd != NULL) {
+          r_cmd->rt = get_register_by_name(operands[i]);
+        }
+        else {
+          i_cmd->rt = get_register_by_name(operands[i]);
+        }
+        break;
+      case RD_FIELD:
+        r_cmd->rd = get_register_by_name(operands[i]);
+        break;
+      case IMMED_FIELD:
+        parse_number(operands[i], 2, &value);
+        i_cmd->immed = value;
+        break;
+      case ADDRESS_FIELD:
+        /* a register, or the address of a label - which is encoded again in the second pass */
+        type = get_operand_type(operands[i]);
+        j_cmd->reg = type == REGISTER_TYPE;
+        j_cmd->address = type == REGISTER_TYPE ? get_register_by_name(operands[i]) : find_by_name(*tab, operands[i]);
+        break;
+      default:
+        /* the distance to a label is encoded in the second pass */
+        break;
+    }
+  }
   return codeword;
 }
 
 operand_type get_operand_type(char* operand){
   int num;
+  long value;
   /* if nothing, just return none */
 	if (operand[0] == '\0'){
     return NONE_TYPE;
@@ -267,7 +283,7 @@ operand_type get_operand_type(char* operand){
     }
   }
   /* if operand starts with +/- and a number right after that, it's immediately type */
-	else if (is_int(operand) || ((operand[0] == '+' || operand[0] == '-')  && is_int(operand+1)) ){
+	else if (parse_number(operand, 4, &value) != NUMBER_SYNTAX_ERROR){
     return IMMEDIATE_TYPE;
   }
   	/* if operand is a valid label name, it's label type */
@@ -277,116 +293,46 @@ operand_type get_operand_type(char* operand){
   return NONE_TYPE;
 }
 
-static bool validate_operand_by_opcode(line_info line, operand_type op1_type,operand_type op2_type,operand_type op3_type, opcode curr_opcode, int op_count){
-  
-  if( (curr_opcode >= ADD_OP && curr_opcode <= NOR_OP) || (curr_opcode >= ADDI_OP && curr_opcode <= SH_OP) ){
-    /* 3 operands required */
-		if (op_count != 3) {
-			print_error(line, "Operation requires 3 operands, got %d", op_count);
-			return FALSE;
-		}
-    if(curr_opcode >= ADD_OP && curr_opcode <= NOR_OP){
-      return validate_operand_type(line, op1_type, op2_type,op3_type,1,1,1,REGISTER_TYPE,REGISTER_TYPE,REGISTER_TYPE);
-    }
-    if( (curr_opcode >= ADDI_OP && curr_opcode <= NORI_OP) || (curr_opcode >= LB_OP && curr_opcode <=SH_OP) ){
-      return validate_operand_type(line, op1_type, op2_type,op3_type,1,1,1,REGISTER_TYPE,IMMEDIATE_TYPE,REGISTER_TYPE);
-    }
-    if(curr_opcode >= BNE_OP && curr_opcode <= BGT_OP){
-      return validate_operand_type(line, op1_type, op2_type,op3_type,1,1,1,REGISTER_TYPE,REGISTER_TYPE,LABEL_TYPE);
-    }
-    
+unsigned long encode_code_word(code_word* word){
+  unsigned long opc = word->opcode;
+  if (word->command == 'r') {
+    return opc << OPCODE_SHIFT | (unsigned long) word->commad_type.r->rs << RS_SHIFT | (unsigned long) word->commad_type.r->rt << RT_SHIFT |
+        (unsigned long) word->commad_type.r->rd << RD_SHIFT | (unsigned long) word->commad_type.r->funct << FUNCT_SHIFT | word->commad_type.r->NONE;
   }
-  else if(curr_opcode >= MOVE_OP && curr_opcode <= MVLO_OP){
-    /* 2 operands required */
-		if (op_count != 2) {
-			print_error(line, "Operation requires 2 operands, got %d", op_count);
-			return FALSE;
-		}
-    return validate_operand_type(line, op1_type, op2_type,NONE_TYPE,1,1,0,REGISTER_TYPE,REGISTER_TYPE);
+  if (word->command == 'i') {
+    return opc << OPCODE_SHIFT | (unsigned long) word->commad_type.i->rs << RS_SHIFT | (unsigned long) word->commad_type.i->rt << RT_SHIFT |
+        word->commad_type.i->immed;
   }
-  else if (curr_opcode >= JMP_OP && curr_opcode <= CALL_OP) {
-		/* 1 operand required */
-		if (op_count != 1) {
-			print_error(line, "Operation requires 1 operand, got %d", op_count);
-			return FALSE;
-		}
-    if(curr_opcode == JMP_OP){
-      return validate_operand_type(line, op1_type, NONE_TYPE,NONE_TYPE,2,0,0,REGISTER_TYPE,LABEL_TYPE);
+  return opc << OPCODE_SHIFT | (unsigned long) word->commad_type.j->reg << REG_SHIFT | word->commad_type.j->address;
+}
+
+static bool validate_operands(line_info line, command_descriptor* command, char* operands[3], operand_type types[MAX_OPERANDS],
+		int op_count){
+  int i;
+  long value;
+  static char* operand_names[MAX_OPERANDS] = {"first", "second", "third"};
+
+  if (op_count != command->operand_count) {
+    if (command->operand_count == 0) {
+      print_error(line, OPERAND_COUNT_ERR, "Operation requires no operands, got %d", op_count);
     }
-    if(curr_opcode == LA_OP || curr_opcode == CALL_OP){
-      return validate_operand_type(line, op1_type, NONE_TYPE,NONE_TYPE,1,0,0,LABEL_TYPE);
+    else {
+      print_error(line, OPERAND_COUNT_ERR, "Operation requires %d operand%s, got %d", command->operand_count,
+          command->operand_count == 1 ? "" : "s", op_count);
     }
+    return FALSE;
   }
-  else if (curr_opcode == STOP_OP) {
-		/* no operands required */
-		if (op_count != 0) {
-			print_error(line, "Operation requires no operands, got %d", op_count);
-			return FALSE;
+  /* a single mask test for each operand */
+  for (i = 0; i < op_count; i++) {
+    if (types[i] == NONE_TYPE || !(command->operand_kinds[i] & (1 << types[i]))) {
+      print_error(line, OPERAND_TYPE_ERR, "Invalid operand type for %s operand.", operand_names[i]);
+      return FALSE;
     }
-	}
+    /* the immed field has 16 bits */
+    if (command->fields[i] == IMMED_FIELD && parse_number(operands[i], 2, &value) != NUMBER_OK) {
+      print_error(line, OPERAND_RANGE_ERR, "The immediate value %s is out of range.", operands[i]);
+      return FALSE;
+    }
+  }
   return TRUE;
 }
-
-
-static bool validate_operand_type(line_info line, operand_type op1_type, operand_type op2_type, operand_type op3_type,
-		int op1_valid_type_count, int op2_valid_type_count,int op3_valid_type_count,...){
-    
-  int i;
-	bool is_valid;
-	va_list list;
-  operand_type op1_valids[4], op2_valids[4], op3_valids[4];
-	memset(op1_valids, NONE_TYPE, sizeof(op1_valids));
-	memset(op2_valids, NONE_TYPE, sizeof(op2_valids));
-	memset(op3_valids, NONE_TYPE, sizeof(op3_valids));
-
-  va_start(list, op3_valid_type_count);
-  /* get the variable args and put them in three arrays (op1_valids & op2_valids & op3_valids) */
-	for (i = 0; i < op1_valid_type_count && i <= 3 ;i++)
-		op1_valids[i] = va_arg(list, int);
-	for (; op1_valid_type_count > 5; va_arg(list,int), op1_valid_type_count--); /* Go on with stack until got all (even above limitation of 4) */
-	/* again for second operand by the count */
-	for (i = 0; i < op2_valid_type_count && i <= 3 ;i++)
-		op2_valids[i] = va_arg(list, int);
-  	/* again for third operand by the count */
-	for (i = 0; i < op3_valid_type_count && i <= 3 ;i++)
-		op3_valids[i] = va_arg(list, int);
-
-  va_end(list); /* got all the arguments */
-
-  	/* make the validation itself: check if any of the operand types has match to any of the valid ones */
-	is_valid = op1_valid_type_count == 0 && op1_type == NONE_TYPE;
-	for (i = 0; i < op1_valid_type_count && !is_valid; i++) {
-		if (op1_valids[i] == op1_type) {
-			is_valid = TRUE;
-		}
-	}
-	if (!is_valid) {
-		print_error(line, "Invalid operand type for first operand.");
-		return FALSE;
-	}
-	/* same for second operand*/
-	is_valid = op2_valid_type_count == 0 && op2_type == NONE_TYPE;
-	for (i = 0; i < op2_valid_type_count && !is_valid; i++) {
-		if (op2_valids[i] == op2_type) {
-			is_valid = TRUE;
-		}
-	}
-	if (!is_valid) {
-		print_error(line, "Invalid operand type for second operand.");
-		return FALSE;
-	}
-
-  	/* same for thirs operand */
-	is_valid = op3_valid_type_count == 0 && op3_type == NONE_TYPE;
-	for (i = 0; i < op3_valid_type_count && !is_valid; i++) {
-		if (op3_valids[i] == op3_type) {
-			is_valid = TRUE;
-		}
-	}
-	if (!is_valid) {
-		print_error(line, "Invalid operand type for third operand.");
-		return FALSE;
-	}
-	return TRUE;
-
-}
\ No newline at end of file
@@ -4,7 +4,65 @@
 #include "table.h"
 #include "globals.h"
 
+/* The positions of the fields in an encoded code word */
+#define OPCODE_SHIFT 26
+#define RS_SHIFT 21
+#define RT_SHIFT 16
+#define RD_SHIFT 11
+#define FUNCT_SHIFT 6
+#define REG_SHIFT 25
 
+/* The operand kinds, as bits of a mask of the valid kinds of an operand */
+#define IMMEDIATE_OPERAND (1 << IMMEDIATE_TYPE)
+#define REGISTER_OPERAND (1 << REGISTER_TYPE)
+#define LABEL_OPERAND (1 << LABEL_TYPE)
+
+/** Maximum operands of a command */
+#define MAX_OPERANDS 3
+
+/* The field of the code word that an operand is encoded into */
+typedef enum operand_field {
+	NO_FIELD = 0,
+	RS_FIELD,
+	RT_FIELD,
+	RD_FIELD,
+	IMMED_FIELD,
+	OFFSET_FIELD, /* the distance to a label, in the immed field */
+	ADDRESS_FIELD /* a label address, or a register with the reg bit */
+} operand_field;
+
+/* Describes a single command: it's encoding and the operands it takes */
+typedef struct command_descriptor {
+	char* name;
+	opcode opc;
+	funct func;
+	char format; /* 'r', 'i' or 'j', as the command of the code word */
+	int operand_count;
+	int operand_kinds[MAX_OPERANDS]; /* the mask of the valid kinds of each operand */
+	operand_field fields[MAX_OPERANDS]; /* where each operand is encoded */
+} command_descriptor;
+
+/**
+ * Get's the descriptor of a command by it's name
+ * @param name The command name
+ * @return The command descriptor, NULL if there's no such command
+ */
+command_descriptor* get_command_descriptor(char* name);
+
+/**
+ * Get's the descriptor of a command by it's opcode and funct
+ * @param opc The opcode
+ * @param func The funct, NONE_FUNCT for commands without funct
+ * @return The command descriptor, NULL if there's no such command
+ */
+command_descriptor* get_command_by_code(opcode opc, funct func);
+
+/**
+ * Returns the field that the label operand of a code word is encoded into
+ * @param word The code word
+ * @return OFFSET_FIELD or ADDRESS_FIELD, NO_FIELD if the command has no label operand
+ */
+operand_field get_label_field(code_word* word);
 
 /**
  * Get's the opcode and the funct of a command by it's name
@@ -14,6 +72,14 @@
  */
 void get_opcode_and_funct(char* cmd, opcode* opcode_des, funct* funct_des);
 
+/**
+ * Get's the name of a command by it's opcode and funct
+ * @param opc The opcode
+ * @param func The funct, NONE_FUNCT for commands without funct
+ * @return The command name, NULL if there's no such command
+ */
+char* get_command_name(opcode opc, funct func);
+
 /**
  * Returns the register value by it's name
  * @param name The name of the register
@@ -34,16 +100,25 @@ int get_register_by_name(char* name);
 bool get_operands(line_info line, int i, char** destination, int* operand_count, char* command);
 
 /**
- * Validates and Builds a code word by the opcode, funct, operand count and operand strings
+ * Validates the operands of a command, without building it's code word - for a source that is only checked
+ * @param line The current source line info
+ * @param command The descriptor of the command
+ * @param op_count The operands count
+ * @param operands a 3-cell array of pointers to the operands.
+ * @return Whether the operands are valid
+ */
+bool check_code_operands(line_info line, command_descriptor* command, int op_count, char* operands[3]);
+
+/**
+ * Validates and Builds a code word by the command descriptor, operand count and operand strings
  * @param line The current source line info
- * @param curr_opcode The current opcode
- * @param curr_funct The current funct
+ * @param command The descriptor of the command
  * @param op_count The operands count
  * @param operands a 3-cell array of pointers to the operands.
  * @param tab The symbol table
  * @return A pointer to code word struct, which represents the code. if validation fails, returns NULL.
  */
-code_word* build_code_word(line_info line, opcode curr_opcode, funct curr_funct, int op_count, char* operands[3], table* tab);
+code_word* build_code_word(line_info line, command_descriptor* command, int op_count, char* operands[3], table* tab);
 
 /**
  * Returns the type of an operand
@@ -52,5 +127,12 @@ code_word* build_code_word(line_info line, opcode curr_opcode, funct curr_funct,
  */
 operand_type get_operand_type(char* operand);
 
+/**
+ * Encodes a code word into it's 32 bits, by it's format (R, I or J)
+ * @param word The code word
+ * @return The encoded word
+ */
+unsigned long encode_code_word(code_word* word);
+
 
 #endif
\ No newline at end of file
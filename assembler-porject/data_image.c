@@ -0,0 +1,451 @@
+/* Implements the data image: the stored bytes are kept in growable segments, the repeated values once each,
+ * and the included files as their mappings */
+/* for mmap, to splice the included binary files by reference */
+#define _POSIX_C_SOURCE 200112L
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "data_image.h"
+#include "utils.h"
+
+/**
+ * Adds an empty segment to the end of the data image
+ * @param image The data image
+ * @param kind The kind of the segment
+ * @return The new segment
+ */
+static data_segment* add_segment(data_image* image, segment_kind kind);
+
+/**
+ * Appends bytes to the end of the data image, to it's last segment of stored bytes
+ * @param image The data image
+ * @param bytes The bytes
+ * @param length The bytes count
+ */
+static void add_data_bytes(data_image* image, unsigned char* bytes, long length);
+
+/**
+ * Computes the hashes of a string and of all it's ends at once, from it's last character:
+ * the hash of each end is computed from the hash of the end after it.
+ * @param string The string
+ * @param length The length of the string
+ * @param hashes The destination hash of each end, by it's first character, and of the empty end at length
+ */
+static void hash_string_ends(char* string, long length, unsigned long* hashes);
+
+/**
+ * Finds a string in the strings hash table
+ * @param image The data image
+ * @param string The characters
+ * @param length The characters count
+ * @param hash The hash of the string
+ * @return The index of the string, or of the empty place for it
+ */
+static long find_data_string(data_image* image, char* string, long length, unsigned long hash);
+
+/**
+ * Finds the segment that contains a byte, by binary search
+ * @param image The data image
+ * @param dc The byte
+ * @return The index of the segment, count if not found
+ */
+static long find_segment(data_image* image, long dc);
+
+void init_data_image(data_image* image){
+	image->segments = NULL;
+	image->count = image->capacity = 0;
+	image->size = 0;
+	image->alignment = 1;
+	image->auto_align = FALSE;
+	image->merge_strings = FALSE;
+	image->count_only = FALSE;
+	image->strings = NULL;
+	image->string_count = image->string_capacity = 0;
+}
+
+void add_data_value(data_image* image, unsigned long value, int size){
+	data_segment* segment = image->count > 0 ? &image->segments[image->count - 1] : NULL;
+	int i;
+
+	if (image->count_only) {
+		image->size += size;
+		return;
+	}
+	if (segment == NULL || segment->kind != BYTES_SEGMENT) {
+		segment = add_segment(image, BYTES_SEGMENT);
+	}
+	if (segment->size + size > segment->capacity) {
+		segment->capacity = segment->capacity == 0 ? 64 : segment->capacity * 2;
+		segment->bytes = (unsigned char *) realloc_with_check(segment->bytes, segment->capacity);
+	}
+	/* little endian, as in the .ob file */
+	for (i = 0; i < size; i++) {
+		segment->bytes[segment->size++] = (value >> (i * 8)) & 0xFF;
+	}
+	image->size += size;
+}
+
+void add_data_fill(data_image* image, long count, int size, unsigned long value){
+	data_segment* segment;
+	if (count <= 0) {
+		return;
+	}
+	if (image->count_only) {
+		image->size += count * size;
+		return;
+	}
+	segment = add_segment(image, FILL_SEGMENT);
+	segment->value = value;
+	segment->value_size = size;
+	segment->size = count * size;
+	image->size += segment->size;
+}
+
+long add_data_string(data_image* image, char* string, long dc){
+	long i, j, index, length = (long) strlen(string);
+	unsigned long hashes[MAX_LINE_LENGTH + 1];
+	data_string* old_strings;
+	char* copy;
+
+	/* the addresses of the strings are only written, so a counted string is never merged */
+	if (image->count_only) {
+		image->size += length + 1;
+		return dc;
+	}
+	if (image->merge_strings) {
+		hash_string_ends(string, length, hashes);
+		if (image->string_count > 0 && image->strings[index = find_data_string(image, string, length, hashes[0])].bytes != NULL) {
+			return image->strings[index].dc;
+		}
+	}
+	for (i = 0; i <= length; i++) {
+		add_data_value(image, (unsigned char) string[i], 1);
+	}
+	if (!image->merge_strings) {
+		return dc;
+	}
+
+	/* the table is at most half full, so there's always an empty place */
+	if (2 * (image->string_count + length + 1) > image->string_capacity) {
+		old_strings = image->strings;
+		j = image->string_capacity;
+		image->string_capacity = image->string_capacity == 0 ? 64 : image->string_capacity * 2;
+		while (2 * (image->string_count + length + 1) > image->string_capacity) {
+			image->string_capacity *= 2;
+		}
+		image->strings = (data_string *) malloc_with_check(image->string_capacity * sizeof(data_string));
+		for (i = 0; i < image->string_capacity; i++) {
+			image->strings[i].bytes = NULL;
+		}
+		for (i = 0; i < j; i++) {
+			if (old_strings[i].bytes != NULL) {
+				image->strings[find_data_string(image, old_strings[i].bytes, old_strings[i].length, old_strings[i].hash)] = old_strings[i];
+			}
+		}
+		free(old_strings);
+	}
+	/* every end of the string can be shared by a later string. an end that's already known keeps it's first address */
+	copy = copy_string(string);
+	for (i = 0; i <= length; i++) {
+		index = find_data_string(image, copy + i, length - i, hashes[i]);
+		if (image->strings[index].bytes == NULL) {
+			image->strings[index].hash = hashes[i];
+			image->strings[index].bytes = copy + i;
+			image->strings[index].length = length - i;
+			image->strings[index].dc = dc + i;
+			image->strings[index].is_copy = i == 0; /* the whole string is always new */
+			image->string_count++;
+		}
+	}
+	return dc;
+}
+
+void add_data_padding(data_image* image, long count, int alignment){
+	if (alignment > image->alignment) {
+		image->alignment = alignment;
+	}
+	if (count <= 0) {
+		return;
+	}
+	/* a few bytes join the stored bytes before them, instead of a segment of their own */
+	if (count < 4 && image->count > 0 && image->segments[image->count - 1].kind == BYTES_SEGMENT) {
+		add_data_value(image, 0, (int) count);
+	}
+	else {
+		add_data_fill(image, count, 1, 0);
+	}
+}
+
+bool open_data_file(char* name, data_file* file){
+	struct stat file_stat;
+	void* mapping;
+	int file_des = open(name, O_RDONLY);
+
+	if (file_des < 0) {
+		return FALSE;
+	}
+	if (fstat(file_des, &file_stat) != 0) {
+		close(file_des);
+		return FALSE;
+	}
+	file->size = (long) file_stat.st_size;
+	file->bytes = NULL;
+	/* an empty file can't be mapped, and has nothing to map */
+	if (file->size > 0) {
+		mapping = mmap(NULL, (size_t) file->size, PROT_READ, MAP_PRIVATE, file_des, 0);
+		if (mapping == MAP_FAILED) {
+			close(file_des);
+			return FALSE;
+		}
+		file->bytes = (unsigned char *) mapping;
+	}
+	/* the mapping stays valid after the file is closed */
+	close(file_des);
+	return TRUE;
+}
+
+bool stat_data_file(char* name, data_file* file){
+	struct stat file_stat;
+	int file_des = open(name, O_RDONLY);
+
+	/* opened as if it was mapped, so an unreadable file is reported the same */
+	if (file_des < 0) {
+		return FALSE;
+	}
+	if (fstat(file_des, &file_stat) != 0) {
+		close(file_des);
+		return FALSE;
+	}
+	file->size = (long) file_stat.st_size;
+	file->bytes = NULL;
+	close(file_des);
+	return TRUE;
+}
+
+void close_data_file(data_file* file){
+	if (file->bytes != NULL) {
+		munmap(file->bytes, (size_t) file->size);
+	}
+	file->bytes = NULL;
+	file->size = 0;
+}
+
+void add_data_file(data_image* image, data_file* file, long offset, long length){
+	data_segment* segment;
+	if (length <= 0 || image->count_only) {
+		image->size += image->count_only ? length : 0;
+		close_data_file(file);
+		return;
+	}
+	segment = add_segment(image, FILE_SEGMENT);
+	segment->file = *file;
+	segment->bytes = file->bytes + offset;
+	segment->size = length;
+	image->size += length;
+}
+
+void append_data_image(data_image* dest, data_image* src){
+	long i;
+	data_segment* segment;
+	if (src->alignment > dest->alignment) {
+		dest->alignment = src->alignment;
+	}
+	for (i = 0; i < src->count; i++) {
+		segment = add_segment(dest, src->segments[i].kind);
+		*segment = src->segments[i];
+		segment->dc = dest->size;
+		dest->size += segment->size;
+	}
+	/* a counted image has only it's size */
+	if (src->count_only) {
+		dest->size += src->size;
+	}
+	/* the bytes are owned by the destination now, and the strings are not needed anymore */
+	free(src->segments);
+	for (i = 0; i < src->string_capacity; i++) {
+		if (src->strings[i].bytes != NULL && src->strings[i].is_copy) {
+			free(src->strings[i].bytes);
+		}
+	}
+	free(src->strings);
+	init_data_image(src);
+}
+
+void remove_data_ranges(data_image* image, long* ranges, long count){
+	data_segment *segments = image->segments, *segment, *piece;
+	long i, k = 0, segment_count = image->count, position, end, piece_end, phase;
+	bool is_mapped;
+
+	/* the kept parts are added again to the emptied image, in order */
+	image->segments = NULL;
+	image->count = image->capacity = 0;
+	image->size = 0;
+	for (i = 0; i < segment_count; i++) {
+		segment = &segments[i];
+		is_mapped = FALSE;
+		for (position = segment->dc, end = segment->dc + segment->size; position < end; position = piece_end) {
+			while (k < count && ranges[2 * k + 1] <= position) {
+				k++;
+			}
+			if (k < count && ranges[2 * k] <= position) {
+				piece_end = ranges[2 * k + 1] < end ? ranges[2 * k + 1] : end; /* removed */
+				continue;
+			}
+			piece_end = k < count && ranges[2 * k] < end ? ranges[2 * k] : end;
+			/* stored bytes that are kept whole are moved, and the other ones are joined to the bytes before them */
+			if (segment->kind == BYTES_SEGMENT && (position > segment->dc || piece_end < end ||
+					(image->count > 0 && image->segments[image->count - 1].kind == BYTES_SEGMENT))) {
+				add_data_bytes(image, segment->bytes + (position - segment->dc), piece_end - position);
+				continue;
+			}
+			piece = add_segment(image, segment->kind);
+			piece->size = piece_end - position;
+			if (segment->kind == BYTES_SEGMENT) {
+				piece->bytes = segment->bytes;
+				piece->capacity = segment->capacity;
+				segment->bytes = NULL;
+			}
+			else if (segment->kind == FILL_SEGMENT) {
+				/* the value starts from another byte of it */
+				phase = ((position - segment->dc) % segment->value_size) * 8;
+				piece->value_size = segment->value_size;
+				piece->value = phase == 0 ? segment->value : ((segment->value >> phase) |
+						(segment->value << (segment->value_size * 8 - phase))) & (0xFFFFFFFFUL >> (32 - segment->value_size * 8));
+			}
+			else {
+				/* the first kept part of the file owns it's mapping */
+				piece->bytes = segment->bytes + (position - segment->dc);
+				if (!is_mapped) {
+					piece->file = segment->file;
+					is_mapped = TRUE;
+				}
+			}
+			image->size += piece->size;
+		}
+		if (segment->kind == BYTES_SEGMENT) {
+			free(segment->bytes);
+		}
+		else if (segment->kind == FILE_SEGMENT && !is_mapped) {
+			close_data_file(&segment->file);
+		}
+	}
+	free(segments);
+}
+
+void get_data_bytes(data_image* image, long dc, long dc_end, unsigned char* dest){
+	long i, offset, length;
+	data_segment* segment;
+
+	for (i = find_segment(image, dc); i < image->count && dc < dc_end; i++) {
+		segment = &image->segments[i];
+		offset = dc - segment->dc;
+		length = segment->dc + segment->size < dc_end ? segment->size - offset : dc_end - dc;
+		if (segment->kind != FILL_SEGMENT) {
+			memcpy(dest, segment->bytes + offset, length);
+			dest += length;
+			dc += length;
+		}
+		else {
+			for ( ; length > 0; length--, offset++, dc++) {
+				*dest++ = (segment->value >> ((offset % segment->value_size) * 8)) & 0xFF;
+			}
+		}
+	}
+}
+
+void free_data_image(data_image* image){
+	long i;
+	for (i = 0; i < image->count; i++) {
+		if (image->segments[i].kind == FILE_SEGMENT) {
+			close_data_file(&image->segments[i].file);
+		}
+		else {
+			free(image->segments[i].bytes);
+		}
+	}
+	free(image->segments);
+	for (i = 0; i < image->string_capacity; i++) {
+		if (image->strings[i].bytes != NULL && image->strings[i].is_copy) {
+			free(image->strings[i].bytes);
+		}
+	}
+	free(image->strings);
+	init_data_image(image);
+}
+
+static data_segment* add_segment(data_image* image, segment_kind kind){
+	data_segment* segment;
+	if (image->count == image->capacity) {
+		image->capacity = image->capacity == 0 ? 16 : image->capacity * 2;
+		image->segments = (data_segment *) realloc_with_check(image->segments, image->capacity * sizeof(data_segment));
+	}
+	segment = &image->segments[image->count++];
+	segment->kind = kind;
+	segment->dc = image->size;
+	segment->size = segment->capacity = 0;
+	segment->bytes = NULL;
+	segment->value = 0;
+	segment->value_size = 1;
+	segment->file.bytes = NULL;
+	segment->file.size = 0;
+	return segment;
+}
+
+static long find_segment(data_image* image, long dc){
+	long low = 0, high = image->count, middle;
+	/* the last segment that starts at or before the byte */
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (image->segments[middle].dc <= dc) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low > 0 && dc < image->segments[low - 1].dc + image->segments[low - 1].size ? low - 1 : image->count;
+}
+
+static void add_data_bytes(data_image* image, unsigned char* bytes, long length){
+	data_segment* segment = image->count > 0 ? &image->segments[image->count - 1] : NULL;
+
+	if (length <= 0) {
+		return;
+	}
+	if (segment == NULL || segment->kind != BYTES_SEGMENT) {
+		segment = add_segment(image, BYTES_SEGMENT);
+	}
+	if (segment->size + length > segment->capacity) {
+		while (segment->size + length > segment->capacity) {
+			segment->capacity = segment->capacity == 0 ? 64 : segment->capacity * 2;
+		}
+		segment->bytes = (unsigned char *) realloc_with_check(segment->bytes, segment->capacity);
+	}
+	memcpy(segment->bytes + segment->size, bytes, length);
+	segment->size += length;
+	image->size += length;
+}
+
+static void hash_string_ends(char* string, long length, unsigned long* hashes){
+	long i;
+	/* over the characters from the last one */
+	hashes[length] = EMPTY_STRING_HASH;
+	for (i = length - 1; i >= 0; i--) {
+		hashes[i] = hash_char(hashes[i + 1], string[i]);
+	}
+}
+
+static long find_data_string(data_image* image, char* string, long length, unsigned long hash){
+	long index = (long) (hash & (image->string_capacity - 1));
+	data_string* entry;
+	/* linear probing, up to an empty place */
+	for ( ; (entry = &image->strings[index])->bytes != NULL; index = (index + 1) & (image->string_capacity - 1)) {
+		if (entry->hash == hash && entry->length == length && memcmp(entry->bytes, string, length) == 0) {
+			break;
+		}
+	}
+	return index;
+}
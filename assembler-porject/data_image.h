@@ -0,0 +1,161 @@
+/* The data image, as segments of stored bytes, of repeated values and of mapped files, expanded only when written */
+#ifndef _DATA_IMAGE_H
+#define _DATA_IMAGE_H
+#include "globals.h"
+
+/* The kinds of the data image segments */
+typedef enum segment_kind {
+	BYTES_SEGMENT, /* stored bytes */
+	FILL_SEGMENT, /* a value repeated, stored once */
+	FILE_SEGMENT /* bytes of a file mapped into memory */
+} segment_kind;
+
+/* A file mapped into memory, for splicing into the data image by reference */
+typedef struct data_file {
+	unsigned char* bytes; /* the mapped file, NULL if it's empty */
+	long size;
+} data_file;
+
+/* A string of the data image, or the end of one, for merging the same strings */
+typedef struct data_string {
+	unsigned long hash;
+	char* bytes; /* the characters without the terminator, inside the copy of the whole string */
+	long length;
+	long dc; /* the address of the string */
+	bool is_copy; /* whether bytes is the allocated copy of the whole string, and not the end of one */
+} data_string;
+
+/* A contiguous part of the data image */
+typedef struct data_segment {
+	segment_kind kind;
+	long dc; /* the first byte of the segment, relative to the data image */
+	long size; /* the bytes count */
+	unsigned char* bytes; /* the stored bytes of a BYTES_SEGMENT, the mapped bytes of a FILE_SEGMENT */
+	long capacity;
+	unsigned long value; /* the repeated value of a FILL_SEGMENT */
+	int value_size; /* the bytes of the repeated value */
+	data_file file; /* the mapped file of a FILE_SEGMENT, unmapped with the image */
+} data_segment;
+
+/* The data image, as it's segments in the order of their addresses */
+typedef struct data_image {
+	data_segment* segments;
+	long count;
+	long capacity;
+	long size; /* the bytes count of the image */
+	int alignment; /* the largest alignment of the data counter, 1 if it wasn't aligned */
+	bool auto_align; /* whether .dh and .dw are aligned to their size */
+	bool merge_strings; /* whether a string already in the image is stored once */
+	bool count_only; /* whether only the size is counted, without storing the bytes or mapping the files - for --check */
+	data_string* strings; /* the hash table of the strings and their ends, when the strings are merged */
+	long string_count;
+	long string_capacity;
+} data_image;
+
+/**
+ * Initializes an empty data image
+ * @param image The data image
+ */
+void init_data_image(data_image* image);
+
+/**
+ * Appends a value to the end of the data image, little endian
+ * @param image The data image
+ * @param value The value
+ * @param size The bytes of the value - 1, 2 or 4
+ */
+void add_data_value(data_image* image, unsigned long value, int size);
+
+/**
+ * Appends a value repeated many times to the end of the data image, without storing each of it's copies
+ * @param image The data image
+ * @param count The times to repeat the value
+ * @param size The bytes of the value - 1, 2 or 4
+ * @param value The value
+ */
+void add_data_fill(data_image* image, long count, int size, unsigned long value);
+
+/**
+ * Appends a string and it's terminator to the end of the data image. When the strings are merged, and the string
+ * is already in the image - as a whole string or as the end of another one - nothing is appended.
+ * @param image The data image
+ * @param string The string
+ * @param dc The data counter of the end of the image
+ * @return The address of the string: dc, or the address of the same characters in the image
+ */
+long add_data_string(data_image* image, char* string, long dc);
+
+/**
+ * Appends zero bytes that align the data counter. Short paddings are stored with the bytes before them,
+ * and long ones as a repeated value, so there's no allocation per padding.
+ * @param image The data image
+ * @param count The padding bytes count
+ * @param alignment The alignment of the counter after the padding
+ */
+void add_data_padding(data_image* image, long count, int alignment);
+
+/**
+ * Maps a file into memory, read only
+ * @param name The file name
+ * @param file The destination mapped file
+ * @return Whether succeeded
+ */
+bool open_data_file(char* name, data_file* file);
+
+/**
+ * Gets the size of a file without mapping it, for a data image that only counts it's size
+ * @param name The file name
+ * @param file The destination file, with no bytes
+ * @return Whether succeeded - the file can be opened for reading
+ */
+bool stat_data_file(char* name, data_file* file);
+
+/**
+ * Unmaps a file that wasn't added to a data image
+ * @param file The mapped file
+ */
+void close_data_file(data_file* file);
+
+/**
+ * Appends a part of a mapped file to the end of the data image. The bytes aren't copied - they're read
+ * from the mapping when they're written, and the data image owns the mapping from now on.
+ * @param image The data image
+ * @param file The mapped file
+ * @param offset The first byte of the part
+ * @param length The bytes count of the part, up to the end of the file
+ */
+void add_data_file(data_image* image, data_file* file, long offset, long length);
+
+/**
+ * Moves all the segments of a data image to the end of another one. The source image is left empty,
+ * and it's strings are not merged with the strings of the destination.
+ * @param dest The destination data image
+ * @param src The source data image
+ */
+void append_data_image(data_image* dest, data_image* src);
+
+/**
+ * Removes ranges of bytes from the data image, and moves the bytes after them back. The stored bytes that are kept
+ * are joined, a repeated value keeps it's order of bytes, and a mapped file is unmapped when none of it is kept.
+ * @param image The data image
+ * @param ranges The ranges, as pairs of the first byte and the byte after the last one, sorted and not overlapping
+ * @param count The ranges count
+ */
+void remove_data_ranges(data_image* image, long* ranges, long count);
+
+/**
+ * Copies bytes of the data image, in the order of the .ob file
+ * @param image The data image
+ * @param dc The first byte
+ * @param dc_end The byte after the last one
+ * @param dest The destination bytes
+ */
+void get_data_bytes(data_image* image, long dc, long dc_end, unsigned char* dest);
+
+/**
+ * Deallocates all the memory required by the data image
+ * @param image The data image
+ */
+void free_data_image(data_image* image);
+
+#endif
@@ -0,0 +1,297 @@
+/* Implements the address to source line map */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "debug_map.h"
+#include "utils.h"
+#include "batch_io.h"
+
+/** Size of the header of a .dbg file */
+#define DEBUG_MAP_HEADER_SIZE 20
+
+/* The rows of the map while they're encoded */
+typedef struct debug_rows {
+	unsigned char* bytes;
+	long size;
+	long capacity;
+	long count;
+	long address, file, line; /* the last row */
+	char** files; /* the file names, not copies */
+	long file_count, file_capacity;
+	debug_index_entry* index;
+	long index_count, index_capacity;
+} debug_rows;
+
+/**
+ * Adds a row to the map, if it starts a new range
+ * @param rows The rows
+ * @param address The address of the range
+ * @param file_name The file name of the range
+ * @param line The line number of the range
+ */
+static void add_debug_row(debug_rows* rows, long address, char* file_name, long line);
+
+/**
+ * Appends a varint: 7 bits in each byte, from the lowest ones, with the high bit set in all the bytes but the last
+ * @param rows The rows
+ * @param value The value
+ */
+static void add_varint(debug_rows* rows, unsigned long value);
+
+/**
+ * Reads a varint
+ * @param bytes The bytes, advanced past the varint
+ * @param end The end of the bytes
+ * @param value The destination value
+ * @return Whether there was a whole varint
+ */
+static bool read_varint(unsigned char** bytes, unsigned char* end, unsigned long* value);
+
+/**
+ * Writes a 4-byte little endian number
+ * @param file_desc The stream
+ * @param value The number
+ */
+static void write_number(FILE* file_desc, unsigned long value);
+
+/**
+ * Reads a 4-byte little endian number
+ * @param bytes The bytes
+ * @return The number
+ */
+static long read_number(unsigned char* bytes);
+
+bool write_debug_map(listing* lst, long icf, char* filename){
+	FILE* file_desc;
+	debug_rows rows;
+	long i, end = icf;
+	char* output_filename;
+
+	memset(&rows, 0, sizeof(debug_rows));
+	rows.line = 0;
+	/* the code words, then the data after them, each in the order of it's addresses */
+	for (i = 0; i < lst->count; i++) {
+		if (lst->lines[i].ic >= 0) {
+			add_debug_row(&rows, lst->lines[i].ic, lst->lines[i].file_name, lst->lines[i].line_number);
+		}
+	}
+	for (i = 0; i < lst->count; i++) {
+		if (lst->lines[i].dc_end > lst->lines[i].dc) {
+			add_debug_row(&rows, icf + lst->lines[i].dc, lst->lines[i].file_name, lst->lines[i].line_number);
+			end = icf + lst->lines[i].dc_end;
+		}
+	}
+
+	output_filename = strconcat(filename, ".dbg");
+	file_desc = open_output_file(output_filename);
+	if (file_desc == NULL) {
+		printf("Can't create or rewrite to file %s.\n", output_filename);
+		free(output_filename);
+		free(rows.bytes);
+		free(rows.files);
+		free(rows.index);
+		return FALSE;
+	}
+	free(output_filename);
+
+	fwrite(DEBUG_MAP_MAGIC, 1, 4, file_desc);
+	write_number(file_desc, end);
+	write_number(file_desc, rows.file_count);
+	write_number(file_desc, rows.index_count);
+	write_number(file_desc, rows.size);
+	for (i = 0; i < rows.file_count; i++) {
+		fwrite(rows.files[i], 1, strlen(rows.files[i]) + 1, file_desc);
+	}
+	for (i = 0; i < rows.index_count; i++) {
+		write_number(file_desc, rows.index[i].address);
+		write_number(file_desc, rows.index[i].file);
+		write_number(file_desc, rows.index[i].line);
+		write_number(file_desc, rows.index[i].offset);
+	}
+	fwrite(rows.bytes, 1, rows.size, file_desc);
+
+	free(rows.bytes);
+	free(rows.files);
+	free(rows.index);
+	return close_output_file(file_desc);
+}
+
+bool load_debug_map(char* filename, debug_map* map){
+	unsigned char *bytes, *end;
+	long i;
+
+	memset(map, 0, sizeof(debug_map));
+	if (!open_data_file(filename, &map->file)) {
+		return FALSE;
+	}
+	bytes = map->file.bytes;
+	end = bytes + map->file.size;
+	if (map->file.size < DEBUG_MAP_HEADER_SIZE || memcmp(bytes, DEBUG_MAP_MAGIC, 4) != 0) {
+		free_debug_map(map);
+		return FALSE;
+	}
+	map->end = read_number(bytes + 4);
+	map->file_count = read_number(bytes + 8);
+	map->index_count = read_number(bytes + 12);
+	map->rows_size = read_number(bytes + 16);
+	bytes += DEBUG_MAP_HEADER_SIZE;
+
+	/* the names are used from the mapping */
+	map->files = (char **) malloc_with_check((map->file_count + 1) * sizeof(char *));
+	for (i = 0; i < map->file_count; i++) {
+		map->files[i] = (char *) bytes;
+		while (bytes < end && *bytes != '\0') {
+			bytes++;
+		}
+		if (bytes == end) {
+			free_debug_map(map);
+			return FALSE;
+		}
+		bytes++;
+	}
+	if (end - bytes < map->index_count * 16 + map->rows_size) {
+		free_debug_map(map);
+		return FALSE;
+	}
+	map->index = (debug_index_entry *) malloc_with_check((map->index_count + 1) * sizeof(debug_index_entry));
+	for (i = 0; i < map->index_count; i++, bytes += 16) {
+		map->index[i].address = read_number(bytes);
+		map->index[i].file = read_number(bytes + 4);
+		map->index[i].line = read_number(bytes + 8);
+		map->index[i].offset = read_number(bytes + 12);
+	}
+	map->rows = bytes;
+	return TRUE;
+}
+
+bool find_source_line(debug_map* map, long address, char** file_name, long* line_number){
+	long low = 0, high = map->index_count, middle, row_address, file, line;
+	unsigned long value, row_file, line_distance;
+	unsigned char *row, *end = map->rows + map->rows_size;
+	debug_index_entry* entry;
+
+	/* the last entry that starts at or before the address */
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (map->index[middle].address <= address) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	if (low == 0 || address >= map->end) {
+		return FALSE;
+	}
+	entry = &map->index[low - 1];
+	row_address = entry->address;
+	file = entry->file;
+	line = entry->line;
+	/* the rows after the entry, up to the one after the address */
+	for (row = map->rows + entry->offset; read_varint(&row, end, &value); ) {
+		row_address += (long) (value >> 1);
+		if (row_address > address) {
+			break;
+		}
+		row_file = (unsigned long) file;
+		if (((value & 1) && !read_varint(&row, end, &row_file)) || !read_varint(&row, end, &line_distance)) {
+			break;
+		}
+		file = (long) row_file;
+		line += line_distance & 1 ? -(long) ((line_distance + 1) / 2) : (long) (line_distance / 2);
+	}
+	if (file < 0 || file >= map->file_count) {
+		return FALSE;
+	}
+	*file_name = map->files[file];
+	*line_number = line;
+	return TRUE;
+}
+
+void free_debug_map(debug_map* map){
+	close_data_file(&map->file);
+	free(map->files);
+	free(map->index);
+	memset(map, 0, sizeof(debug_map));
+}
+
+static void add_debug_row(debug_rows* rows, long address, char* file_name, long line){
+	long file;
+	bool is_new_file;
+
+	for (file = rows->file_count - 1; file >= 0 && rows->files[file] != file_name && strcmp(rows->files[file], file_name) != 0; file--)
+		;
+	if (file < 0) {
+		if (rows->file_count == rows->file_capacity) {
+			rows->file_capacity = rows->file_capacity == 0 ? 16 : rows->file_capacity * 2;
+			rows->files = (char **) realloc_with_check(rows->files, rows->file_capacity * sizeof(char *));
+		}
+		file = rows->file_count;
+		rows->files[rows->file_count++] = file_name;
+	}
+	/* a range of the same line goes on */
+	if (rows->count > 0 && file == rows->file && line == rows->line) {
+		return;
+	}
+	is_new_file = rows->count == 0 || file != rows->file;
+	add_varint(rows, ((unsigned long) (address - rows->address) << 1) | (is_new_file ? 1 : 0));
+	if (is_new_file) {
+		add_varint(rows, (unsigned long) file);
+	}
+	add_varint(rows, line >= rows->line ? (unsigned long) (line - rows->line) * 2 : (unsigned long) (rows->line - line) * 2 - 1);
+	rows->address = address;
+	rows->file = file;
+	rows->line = line;
+
+	/* each few rows are indexed, with where the row after them starts */
+	if (rows->count % DEBUG_MAP_INDEX_STEP == 0) {
+		if (rows->index_count == rows->index_capacity) {
+			rows->index_capacity = rows->index_capacity == 0 ? 16 : rows->index_capacity * 2;
+			rows->index = (debug_index_entry *) realloc_with_check(rows->index, rows->index_capacity * sizeof(debug_index_entry));
+		}
+		rows->index[rows->index_count].address = address;
+		rows->index[rows->index_count].file = file;
+		rows->index[rows->index_count].line = line;
+		rows->index[rows->index_count].offset = rows->size;
+		rows->index_count++;
+	}
+	rows->count++;
+}
+
+static void add_varint(debug_rows* rows, unsigned long value){
+	do {
+		if (rows->size == rows->capacity) {
+			rows->capacity = rows->capacity == 0 ? 64 : rows->capacity * 2;
+			rows->bytes = (unsigned char *) realloc_with_check(rows->bytes, rows->capacity);
+		}
+		rows->bytes[rows->size++] = (unsigned char) ((value & 0x7F) | (value > 0x7F ? 0x80 : 0));
+		value >>= 7;
+	} while (value > 0);
+}
+
+static bool read_varint(unsigned char** bytes, unsigned char* end, unsigned long* value){
+	int shift = 0;
+	*value = 0;
+	while (*bytes < end && shift < 32) {
+		*value |= (unsigned long) (**bytes & 0x7F) << shift;
+		if ((*(*bytes)++ & 0x80) == 0) {
+			return TRUE;
+		}
+		shift += 7;
+	}
+	return FALSE;
+}
+
+static void write_number(FILE* file_desc, unsigned long value){
+	unsigned char bytes[4];
+	bytes[0] = value & 0xFF;
+	bytes[1] = (value >> 8) & 0xFF;
+	bytes[2] = (value >> 16) & 0xFF;
+	bytes[3] = (value >> 24) & 0xFF;
+	fwrite(bytes, 1, 4, file_desc);
+}
+
+static long read_number(unsigned char* bytes){
+	return (long) ((unsigned long) bytes[0] | ((unsigned long) bytes[1] << 8) | ((unsigned long) bytes[2] << 16) |
+			((unsigned long) bytes[3] << 24));
+}
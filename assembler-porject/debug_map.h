@@ -0,0 +1,78 @@
+/* The address to source line map (.dbg): written by the assembler from the listed lines, and read by the tools */
+#ifndef _DEBUG_MAP_H
+#define _DEBUG_MAP_H
+
+#include "globals.h"
+#include "listing.h"
+#include "data_image.h"
+
+/** The first bytes of a .dbg file */
+#define DEBUG_MAP_MAGIC "DBG1"
+
+/** Rows between two entries of the index - the most rows decoded by a lookup */
+#define DEBUG_MAP_INDEX_STEP 64
+
+/* An entry of the index: a decoded row, and where the row after it starts */
+typedef struct debug_index_entry {
+	long address;
+	long file; /* the index of the file name */
+	long line;
+	long offset; /* of the next row */
+} debug_index_entry;
+
+/*
+ * A loaded .dbg file. The file is:
+ * - a header of 4-byte little endian numbers: the magic, the end address, the files count, the index entries count
+ *   and the rows size
+ * - the file names, each ends with '\0'
+ * - the index, of 4-byte little endian numbers - the address, file, line and offset of each entry
+ * - the rows, sorted by address, each one starts an address range that ends at the next one. A row is a varint of
+ *   the address distance from the row before, doubled, plus 1 if the file changes, then the varint file index if it
+ *   changes, then the zigzag varint line distance. a code word usually takes 2 bytes.
+ */
+typedef struct debug_map {
+	data_file file; /* the mapped file */
+	char** files;
+	long file_count;
+	debug_index_entry* index;
+	long index_count;
+	unsigned char* rows;
+	long rows_size;
+	long end; /* the address after the last range */
+} debug_map;
+
+/**
+ * Writes the .dbg file: the address ranges of the code words and the data of the listed lines,
+ * and their file and line
+ * @param lst The listing, with the final addresses
+ * @param icf The final code counter
+ * @param filename The filename, without the extension
+ * @return Whether succeeded
+ */
+bool write_debug_map(listing* lst, long icf, char* filename);
+
+/**
+ * Loads a .dbg file
+ * @param filename The file name
+ * @param map The destination map
+ * @return Whether succeeded - a missing or an invalid file fails quietly
+ */
+bool load_debug_map(char* filename, debug_map* map);
+
+/**
+ * Finds the source line of an address, by a binary search of the index and decoding the rows after the entry
+ * @param map The map
+ * @param address The address
+ * @param file_name The destination file name, owned by the map
+ * @param line_number The destination line number
+ * @return Whether found
+ */
+bool find_source_line(debug_map* map, long address, char** file_name, long* line_number);
+
+/**
+ * Deallocates all the memory required by a loaded map
+ * @param map The map
+ */
+void free_debug_map(debug_map* map);
+
+#endif
@@ -0,0 +1,308 @@
+/* Implements the diagnostics buffer */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "diagnostics.h"
+#include "utils.h"
+
+/* The text of the diagnostics, built before the single write */
+typedef struct output_text {
+	char* text;
+	long length;
+	long capacity;
+} output_text;
+
+/**
+ * Appends formatted text to an output text
+ * @param out The output text
+ * @param format The format string
+ * @param ... The arguments to format
+ */
+static void append_text(output_text* out, char* format, ...);
+
+/**
+ * Appends formatted text to an output text, growing it by the arguments - so a long string argument fits.
+ * Supports %s and %.*s, %c, %d, %u and %x with the l modifier, a 0 flag and a width of up to 2 digits, and %%.
+ * @param out The output text
+ * @param format The format string
+ * @param args The arguments to format
+ */
+static void append_format(output_text* out, char* format, va_list args);
+
+/**
+ * Appends a string to an output text, as is
+ * @param out The output text
+ * @param string The string
+ * @param length The string length
+ */
+static void append_string(output_text* out, char* string, long length);
+
+/**
+ * Appends a string as a quoted JSON string
+ * @param out The output text
+ * @param string The string
+ */
+static void append_json_string(output_text* out, char* string);
+
+/* Compares two diagnostics by the source order, then by the reporting order, for qsort */
+static int compare_diagnostics(const void* first, const void* second);
+
+/* The names of the severities, by their value */
+static char* severity_names[] = {"Error", "Warning", "Note"};
+static char* json_severity_names[] = {"error", "warning", "note"};
+
+void init_diagnostics(diagnostics* diag, bool json){
+	diag->items = NULL;
+	diag->count = diag->capacity = 0;
+	diag->error_count = 0;
+	diag->order = 0;
+	diag->json = json;
+}
+
+void add_diagnostic(diagnostics* diag, diag_severity severity, error_code code, line_info line, int column, char* message, va_list args){
+	output_text text = {NULL, 0, 0};
+	diagnostic* item;
+
+	append_format(&text, message, args);
+	append_string(&text, "", 1);
+	if (diag->count == diag->capacity) {
+		diag->capacity = diag->capacity == 0 ? 16 : diag->capacity * 2;
+		diag->items = (diagnostic *) realloc_with_check(diag->items, diag->capacity * sizeof(diagnostic));
+	}
+	item = &diag->items[diag->count++];
+	item->severity = severity;
+	item->code = code;
+	item->file_name = line.file_name;
+	item->line_number = line.line_number;
+	item->column = column + 1;
+	item->message = text.text;
+	item->order = diag->order;
+	if (severity == ERROR_SEVERITY) {
+		diag->error_count++;
+	}
+}
+
+void add_note(diagnostics* diag, line_info line, error_code code, char* message, ...){
+	va_list args;
+	va_start(args, message);
+	add_diagnostic(diag, NOTE_SEVERITY, code, line, 0, message, args);
+	va_end(args);
+}
+
+void append_diagnostics(diagnostics* dest, diagnostics* src){
+	long i;
+	for (i = 0; i < src->count; i++) {
+		if (dest->count == dest->capacity) {
+			dest->capacity = dest->capacity == 0 ? 16 : dest->capacity * 2;
+			dest->items = (diagnostic *) realloc_with_check(dest->items, dest->capacity * sizeof(diagnostic));
+		}
+		dest->items[dest->count++] = src->items[i];
+	}
+	dest->error_count += src->error_count;
+	src->count = src->error_count = 0;
+}
+
+void copy_diagnostics(diagnostics* dest, diagnostics* src, long line_number){
+	long i;
+	for (i = 0; i < src->count; i++) {
+		if (dest->count == dest->capacity) {
+			dest->capacity = dest->capacity == 0 ? 16 : dest->capacity * 2;
+			dest->items = (diagnostic *) realloc_with_check(dest->items, dest->capacity * sizeof(diagnostic));
+		}
+		dest->items[dest->count] = src->items[i];
+		dest->items[dest->count].message = (char *) malloc_with_check(strlen(src->items[i].message) + 1);
+		strcpy(dest->items[dest->count].message, src->items[i].message);
+		dest->items[dest->count].line_number = line_number;
+		dest->items[dest->count].order = dest->order;
+		dest->count++;
+	}
+	dest->error_count += src->error_count;
+}
+
+void drop_line_diagnostics(diagnostics* diag, long order){
+	long i, j;
+	for (i = 0, j = 0; i < diag->count; i++) {
+		if (diag->items[i].order == order) {
+			diag->error_count -= diag->items[i].severity == ERROR_SEVERITY;
+			free(diag->items[i].message);
+			continue;
+		}
+		diag->items[j++] = diag->items[i];
+	}
+	diag->count = j;
+}
+
+void sort_diagnostics(diagnostics* diag){
+	long i;
+	for (i = 0; i < diag->count; i++) {
+		diag->items[i].sequence = i;
+	}
+	qsort(diag->items, diag->count, sizeof(diagnostic), compare_diagnostics);
+}
+
+void limit_diagnostics(diagnostics* diag, long max_errors){
+	long i, kept, errors = 0;
+	for (kept = 0; kept < diag->count && errors < max_errors; kept++) {
+		errors += diag->items[kept].severity == ERROR_SEVERITY;
+	}
+	for (i = kept; i < diag->count; i++) {
+		free(diag->items[i].message);
+	}
+	diag->count = kept;
+	diag->error_count = errors;
+}
+
+void flush_diagnostics(diagnostics* diag, FILE* output){
+	output_text out = {NULL, 0, 0};
+	diagnostic* item;
+	long i;
+
+	if (diag->count == 0) {
+		return;
+	}
+	for (i = 0; i < diag->count; i++) {
+		item = &diag->items[i];
+		if (diag->json) {
+			append_text(&out, "{\"severity\":\"%s\",\"code\":\"E%03d\",\"file\":", json_severity_names[item->severity], (int) item->code);
+			append_json_string(&out, item->file_name);
+			append_text(&out, ",\"line\":%ld,\"column\":%d,\"message\":", item->line_number, item->column);
+			append_json_string(&out, item->message);
+			append_text(&out, "}\n");
+		}
+		else {
+			append_text(&out, "%s In ", severity_names[item->severity]);
+			append_string(&out, item->file_name, strlen(item->file_name));
+			append_text(&out, ":%ld: ", item->line_number);
+			append_string(&out, item->message, strlen(item->message));
+			append_string(&out, "\n", 1);
+		}
+		free(item->message);
+	}
+	fwrite(out.text, 1, out.length, output);
+	fflush(output);
+	free(out.text);
+	diag->count = 0;
+}
+
+void free_diagnostics(diagnostics* diag){
+	long i;
+	for (i = 0; i < diag->count; i++) {
+		free(diag->items[i].message);
+	}
+	free(diag->items);
+	init_diagnostics(diag, diag->json);
+}
+
+static void append_text(output_text* out, char* format, ...){
+	va_list args;
+	va_start(args, format);
+	append_format(out, format, args);
+	va_end(args);
+}
+
+static void append_format(output_text* out, char* format, va_list args){
+	char spec[8], number[32]; /* a number of up to 2 digits width, in a long */
+	char* string;
+	int precision, length;
+
+	while (*format) {
+		/* the plain parts are appended at once */
+		for (length = 0; format[length] && format[length] != '%'; length++)
+			;
+		append_string(out, format, length);
+		format += length;
+		if (!*format) {
+			break;
+		}
+		format++;
+		if (*format == '%') {
+			append_string(out, "%", 1);
+			format++;
+			continue;
+		}
+		if (*format == 's' || (format[0] == '.' && format[1] == '*' && format[2] == 's')) {
+			/* a string is appended as is, up to it's precision */
+			precision = *format == '.' ? va_arg(args, int) : -1;
+			string = va_arg(args, char *);
+			for (length = 0; string[length] && (precision < 0 || length < precision); length++)
+				;
+			append_string(out, string, length);
+			format += *format == '.' ? 3 : 1;
+			continue;
+		}
+		/* a number or a character, formatted by the same spec */
+		spec[0] = '%';
+		for (length = 1; length < 4 && (*format == '0' || (*format >= '1' && *format <= '9')); length++) {
+			spec[length] = *format++;
+		}
+		if (*format == 'l') {
+			spec[length++] = *format++;
+		}
+		spec[length++] = *format;
+		spec[length] = '\0';
+		switch (*format) {
+			case 'd':
+			case 'u':
+			case 'x':
+				if (spec[length - 2] == 'l') {
+					sprintf(number, spec, va_arg(args, long));
+				}
+				else {
+					sprintf(number, spec, va_arg(args, int));
+				}
+				break;
+			case 'c':
+				sprintf(number, spec, va_arg(args, int));
+				break;
+			default:
+				return; /* not supported */
+		}
+		append_string(out, number, strlen(number));
+		format++;
+	}
+}
+
+static void append_string(output_text* out, char* string, long length){
+	while (out->length + length > out->capacity) {
+		out->capacity = out->capacity == 0 ? 1024 : out->capacity * 2;
+		out->text = (char *) realloc_with_check(out->text, out->capacity);
+	}
+	memcpy(out->text + out->length, string, length);
+	out->length += length;
+}
+
+static void append_json_string(output_text* out, char* string){
+	char escaped[8];
+	long start;
+
+	append_string(out, "\"", 1);
+	/* the plain parts are appended at once, only the special chars are escaped */
+	for (start = 0; string[start]; ) {
+		long end = start;
+		while (string[end] && string[end] != '"' && string[end] != '\\' && (unsigned char) string[end] >= 0x20) {
+			end++;
+		}
+		append_string(out, string + start, end - start);
+		if (!string[end]) {
+			break;
+		}
+		if (string[end] == '"' || string[end] == '\\') {
+			sprintf(escaped, "\\%c", string[end]);
+		}
+		else {
+			sprintf(escaped, "\\u%04x", (unsigned char) string[end]);
+		}
+		append_string(out, escaped, strlen(escaped));
+		start = end + 1;
+	}
+	append_string(out, "\"", 1);
+}
+
+static int compare_diagnostics(const void* first, const void* second){
+	diagnostic* item1 = (diagnostic *) first;
+	diagnostic* item2 = (diagnostic *) second;
+	if (item1->order != item2->order) {
+		return item1->order < item2->order ? -1 : 1;
+	}
+	return item1->sequence < item2->sequence ? -1 : item1->sequence > item2->sequence;
+}
@@ -0,0 +1,114 @@
+/* Buffered diagnostics of a single processed file, printed at once when the file is done */
+#ifndef _DIAGNOSTICS_H
+#define _DIAGNOSTICS_H
+#include <stdio.h>
+#include <stdarg.h>
+#include "globals.h"
+
+/* Severity of a diagnostic */
+typedef enum diag_severity {
+	ERROR_SEVERITY,
+	WARNING_SEVERITY,
+	NOTE_SEVERITY
+} diag_severity;
+
+/* A single diagnostic */
+typedef struct diagnostic {
+	diag_severity severity;
+	error_code code;
+	char* file_name; /* not a copy - the file names are kept until the diagnostics are flushed */
+	long line_number;
+	int column; /* 1 based */
+	char* message;
+	long order; /* the index of the source line, for keeping the source order */
+	long sequence; /* the order of reporting, for sorting the diagnostics of the same line */
+} diagnostic;
+
+/* The diagnostics of a processed file, in the order they were reported */
+typedef struct diagnostics {
+	diagnostic* items;
+	long count;
+	long capacity;
+	long error_count;
+	long order; /* the index of the source line being processed, given to the added diagnostics */
+	bool json; /* whether to print as JSON lines */
+} diagnostics;
+
+/**
+ * Initializes an empty diagnostics buffer
+ * @param diag The diagnostics buffer
+ * @param json Whether to print the diagnostics as JSON lines
+ */
+void init_diagnostics(diagnostics* diag, bool json);
+
+/**
+ * Adds a diagnostic of a source line
+ * @param diag The diagnostics buffer
+ * @param severity The severity
+ * @param code The error code
+ * @param line The source line
+ * @param column The column, 0 based index in the line content
+ * @param message The message format
+ * @param args The arguments to format into the message
+ */
+void add_diagnostic(diagnostics* diag, diag_severity severity, error_code code, line_info line, int column, char* message, va_list args);
+
+/**
+ * Adds a note about a source line, that isn't counted as an error
+ * @param diag The diagnostics buffer
+ * @param line The source line
+ * @param code The code of the note
+ * @param message The message format
+ * @param ... The arguments to format into the message
+ */
+void add_note(diagnostics* diag, line_info line, error_code code, char* message, ...);
+
+/**
+ * Moves all the diagnostics of a buffer to the end of another buffer
+ * @param dest The destination buffer
+ * @param src The source buffer, that is empty afterwards
+ */
+void append_diagnostics(diagnostics* dest, diagnostics* src);
+
+/**
+ * Copies all the diagnostics of a buffer to the end of another buffer, as they were reported at another line
+ * @param dest The destination buffer, whose current order is given to the copies
+ * @param src The source buffer, that is kept
+ * @param line_number The line number of the copies
+ */
+void copy_diagnostics(diagnostics* dest, diagnostics* src, long line_number);
+
+/**
+ * Removes the diagnostics of a single source line
+ * @param diag The diagnostics buffer
+ * @param order The index of the source line
+ */
+void drop_line_diagnostics(diagnostics* diag, long order);
+
+/**
+ * Sorts the diagnostics by the source order. The diagnostics of the same line keep their order.
+ * @param diag The diagnostics buffer
+ */
+void sort_diagnostics(diagnostics* diag);
+
+/**
+ * Keeps only the diagnostics up to a maximum count of errors
+ * @param diag The diagnostics buffer
+ * @param max_errors The maximum errors count
+ */
+void limit_diagnostics(diagnostics* diag, long max_errors);
+
+/**
+ * Prints all the buffered diagnostics with a single write, and empties the buffer
+ * @param diag The diagnostics buffer
+ * @param output The output file
+ */
+void flush_diagnostics(diagnostics* diag, FILE* output);
+
+/**
+ * Deallocates all the memory required by a diagnostics buffer
+ * @param diag The diagnostics buffer
+ */
+void free_diagnostics(diagnostics* diag);
+
+#endif
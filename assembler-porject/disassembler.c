@@ -0,0 +1,446 @@
+/* Disassembles an .ob file back into assembly source, naming the symbols by the .ent and .ext files */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "globals.h"
+#include "code.h"
+#include "utils.h"
+#include "object_file.h"
+#include "parallel.h"
+
+/** Minimum code words in the chunk of a thread - smaller images are disassembled by a single thread */
+#define MIN_CHUNK_WORDS 16384
+
+/** Data bytes in a single .db line */
+#define DATA_BYTES_PER_LINE 8
+
+/** Maximum length of a single disassembled line */
+#define MAX_OUTPUT_LINE 160
+
+/* A symbol name by it's address */
+typedef struct address_symbol {
+	long address;
+	char* name;
+} address_symbol;
+
+/* Symbols sorted by address, for binary search */
+typedef struct symbol_index {
+	address_symbol* symbols;
+	long count;
+} symbol_index;
+
+/* A chunk of code words, disassembled by a single thread */
+typedef struct disasm_chunk {
+	object_file* obj;
+	long first_word; /* index of the first code word */
+	long end_word; /* index right after the last code word */
+	symbol_index* externals; /* the external references, by the address of the code word */
+	symbol_index* labels; /* the labels, by their address */
+	bool with_hex; /* whether to print the address and the hex bytes of each word */
+	long* targets; /* label addresses used by the chunk's code */
+	long target_count, target_capacity;
+	char* text; /* the disassembled text of the chunk */
+	long text_length, text_capacity;
+} disasm_chunk;
+
+/**
+ * Returns a code word of the code image
+ * @param obj The object file
+ * @param index The index of the word
+ * @return The code word
+ */
+static unsigned long get_code_word(object_file* obj, long index);
+
+/**
+ * Returns the label address that a code word uses, if any
+ * @param word The code word
+ * @param address The address of the code word
+ * @param externals The external references index
+ * @return The address of the used label, -1 if the word doesn't use a label, or uses an external one
+ */
+static long get_label_target(unsigned long word, long address, symbol_index* externals);
+
+/**
+ * Thread function: collects the label addresses used by the code words of a chunk
+ * @param arg The chunk
+ * @return NULL
+ */
+static void* collect_chunk_targets(void* arg);
+
+/**
+ * Thread function: disassembles the code words of a chunk into it's text
+ * @param arg The chunk
+ * @return NULL
+ */
+static void* format_chunk(void* arg);
+
+/**
+ * Appends formatted text to the text of a chunk
+ * @param chunk The chunk
+ * @param format The format string
+ * @param ... The arguments to format
+ */
+static void append_text(disasm_chunk* chunk, char* format, ...);
+
+/**
+ * Finds a symbol by it's address
+ * @param index The symbols index
+ * @param address The address
+ * @return The symbol name, NULL if not found
+ */
+static char* find_symbol(symbol_index* index, long address);
+
+/**
+ * Builds the labels index: the entries by their names, and generated names for the other used addresses.
+ * @param obj The object file
+ * @param chunks The chunks, after their targets were collected
+ * @param chunk_count The chunks count
+ * @param labels The destination index
+ */
+static void build_label_index(object_file* obj, disasm_chunk* chunks, int chunk_count, symbol_index* labels);
+
+/**
+ * Writes the data image as .db lines, starting a new line at each label
+ * @param obj The object file
+ * @param labels The labels index
+ * @param with_hex Whether to print the address of each line
+ * @param out The output file
+ */
+static void write_data(object_file* obj, symbol_index* labels, bool with_hex, FILE* out);
+
+/**
+ * Prints an .extern line for each external name, once - by their names, as a name may be referenced from anywhere
+ * @param externals The external references
+ * @param out The output file
+ */
+static void write_externals(symbol_index* externals, FILE* out);
+
+/* Compares two address symbols by address, for qsort */
+static int compare_symbols(const void* first, const void* second);
+
+/* Compares two addresses, for qsort */
+static int compare_addresses(const void* first, const void* second);
+
+/* Compares two names, for qsort */
+static int compare_names(const void* first, const void* second);
+
+int main(int argc, char *argv[]){
+	int i, thread_count = 0, chunk_count;
+	long word_count, words_per_chunk;
+	char* filename = NULL;
+	bool with_hex = TRUE;
+	object_file obj;
+	symbol_index externals, labels;
+	disasm_chunk* chunks;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			thread_count = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--source") == 0) {
+			with_hex = FALSE; /* only the source, that can be assembled again */
+		}
+		else if (argv[i][0] != '-' && filename == NULL) {
+			filename = argv[i];
+		}
+		else {
+			printf("Usage: %s [-j threads] [--source] file.ob\n", argv[0]);
+			return 1;
+		}
+	}
+	if (filename == NULL) {
+		printf("Missing input file. Please enter an .ob file.\n");
+		return 1;
+	}
+	if (!load_object_file(filename, &obj, TRUE)) {
+		return 1;
+	}
+
+	/* external references by address, shared read-only by the threads */
+	externals.count = obj.external_count;
+	externals.symbols = (address_symbol *) malloc_with_check((externals.count + 1) * sizeof(address_symbol));
+	for (i = 0; i < externals.count; i++) {
+		externals.symbols[i].address = obj.externals[i].address;
+		externals.symbols[i].name = obj.externals[i].name;
+	}
+	qsort(externals.symbols, externals.count, sizeof(address_symbol), compare_symbols);
+
+	/* every word is 4 bytes, so the code image splits into independent chunks */
+	if (thread_count <= 0) {
+		thread_count = get_processor_count();
+	}
+	thread_count = thread_count < 1 ? 1 : thread_count > MAX_THREADS ? MAX_THREADS : thread_count;
+	word_count = obj.code_size / 4;
+	chunk_count = (int) (word_count / MIN_CHUNK_WORDS);
+	chunk_count = chunk_count < 1 ? 1 : chunk_count > thread_count ? thread_count : chunk_count;
+	words_per_chunk = (word_count + chunk_count - 1) / chunk_count;
+
+	chunks = (disasm_chunk *) malloc_with_check(chunk_count * sizeof(disasm_chunk));
+	for (i = 0; i < chunk_count; i++) {
+		memset(&chunks[i], 0, sizeof(disasm_chunk));
+		chunks[i].obj = &obj;
+		chunks[i].first_word = i * words_per_chunk;
+		chunks[i].end_word = (i + 1) * words_per_chunk < word_count ? (i + 1) * words_per_chunk : word_count;
+		chunks[i].externals = &externals;
+		chunks[i].labels = &labels;
+		chunks[i].with_hex = with_hex;
+	}
+
+	/* first the used labels, then the text that names them */
+	run_in_threads(chunks, chunk_count, sizeof(disasm_chunk), collect_chunk_targets);
+	build_label_index(&obj, chunks, chunk_count, &labels);
+	run_in_threads(chunks, chunk_count, sizeof(disasm_chunk), format_chunk);
+
+	for (i = 0; i < obj.entry_count; i++) {
+		printf(".entry %s\n", obj.entries[i].name);
+	}
+	write_externals(&externals, stdout);
+	for (i = 0; i < chunk_count; i++) {
+		fwrite(chunks[i].text, 1, chunks[i].text_length, stdout);
+		free(chunks[i].text);
+		free(chunks[i].targets);
+	}
+	write_data(&obj, &labels, with_hex, stdout);
+
+	for (i = 0; i < labels.count; i++) {
+		free(labels.symbols[i].name);
+	}
+	free(labels.symbols);
+	free(externals.symbols);
+	free(chunks);
+	free_object_file(&obj);
+	return 0;
+}
+
+static unsigned long get_code_word(object_file* obj, long index){
+	unsigned char* bytes = obj->code + index * 4;
+	return bytes[0] | ((unsigned long) bytes[1] << 8) | ((unsigned long) bytes[2] << 16) | ((unsigned long) bytes[3] << 24);
+}
+
+static long get_label_target(unsigned long word, long address, symbol_index* externals){
+	int opcode = (word >> 26) & 0x3F;
+	if (opcode >= BNE_OP && opcode <= BGT_OP) {
+		return address + (long) (word & 0xFFFF) - ((word & 0x8000) ? 0x10000L : 0);
+	}
+	if (opcode >= JMP_OP && opcode <= CALL_OP && !((word >> 25) & 1) && find_symbol(externals, address) == NULL) {
+		return word & 0x1FFFFFF;
+	}
+	return -1;
+}
+
+static void* collect_chunk_targets(void* arg){
+	disasm_chunk* chunk = (disasm_chunk *) arg;
+	long i, address, target;
+
+	for (i = chunk->first_word; i < chunk->end_word; i++) {
+		address = IC_INIT_VALUE + i * 4;
+		if ((target = get_label_target(get_code_word(chunk->obj, i), address, chunk->externals)) < 0) {
+			continue;
+		}
+		if (chunk->target_count == chunk->target_capacity) {
+			chunk->target_capacity = chunk->target_capacity == 0 ? 64 : chunk->target_capacity * 2;
+			chunk->targets = (long *) realloc_with_check(chunk->targets, chunk->target_capacity * sizeof(long));
+		}
+		chunk->targets[chunk->target_count++] = target;
+	}
+	return NULL;
+}
+
+static void* format_chunk(void* arg){
+	disasm_chunk* chunk = (disasm_chunk *) arg;
+	long i, address;
+	unsigned long word;
+	int opcode, funct, rs, rt, rd;
+	char *name, *label, *operand;
+	char operand_buffer[16];
+
+	for (i = chunk->first_word; i < chunk->end_word; i++) {
+		address = IC_INIT_VALUE + i * 4;
+		word = get_code_word(chunk->obj, i);
+		opcode = (word >> 26) & 0x3F;
+		funct = (word >> 6) & 0x1F;
+		rs = (word >> 21) & 0x1F;
+		rt = (word >> 16) & 0x1F;
+		rd = (word >> 11) & 0x1F;
+
+		if (chunk->with_hex) {
+			append_text(chunk, "%.4ld  %02lX %02lX %02lX %02lX  ", address, word & 0xFF, (word >> 8) & 0xFF, (word >> 16) & 0xFF, word >> 24);
+		}
+		label = find_symbol(chunk->labels, address);
+		append_text(chunk, "%s%s\t", label != NULL ? label : "", label != NULL ? ":" : "");
+
+		/* the same opcode & funct table of the assembler. only R commands have funct */
+		name = get_command_name(opcode, opcode <= MVLO_OP ? funct : NONE_FUNCT);
+		if (name == NULL) {
+			append_text(chunk, "; invalid word\n");
+			continue;
+		}
+		if (opcode == ADD_OP) {
+			append_text(chunk, "%s $%d, $%d, $%d\n", name, rs, rt, rd);
+		}
+		else if (opcode == MOVE_OP) {
+			append_text(chunk, "%s $%d, $%d\n", name, rs, rd);
+		}
+		else if (opcode >= BNE_OP && opcode <= BGT_OP) {
+			label = find_symbol(chunk->labels, get_label_target(word, address, chunk->externals));
+			if (label == NULL) {
+				label = find_symbol(chunk->externals, address); /* a branch to an external */
+			}
+			append_text(chunk, "%s $%d, $%d, %s\n", name, rs, rt, label != NULL ? label : "?");
+		}
+		else if (opcode >= ADDI_OP && opcode <= SH_OP) {
+			append_text(chunk, "%s $%d, %ld, $%d\n", name, rs, (long) (word & 0xFFFF) - ((word & 0x8000) ? 0x10000L : 0), rt);
+		}
+		else if (opcode == STOP_OP) {
+			append_text(chunk, "%s\n", name);
+		}
+		else { /* J commands - a register, an external or a label */
+			if ((word >> 25) & 1) {
+				sprintf(operand_buffer, "$%lu", word & 0x1FFFFFF);
+				operand = operand_buffer;
+			}
+			else if ((operand = find_symbol(chunk->externals, address)) == NULL) {
+				operand = find_symbol(chunk->labels, word & 0x1FFFFFF);
+			}
+			append_text(chunk, "%s %s\n", name, operand != NULL ? operand : "?");
+		}
+	}
+	return NULL;
+}
+
+static void append_text(disasm_chunk* chunk, char* format, ...){
+	char line[MAX_OUTPUT_LINE];
+	int length;
+	va_list args;
+
+	va_start(args, format);
+	length = vsprintf(line, format, args);
+	va_end(args);
+
+	if (chunk->text_length + length > chunk->text_capacity) {
+		chunk->text_capacity = chunk->text_capacity == 0 ? 4096 : chunk->text_capacity * 2;
+		chunk->text = (char *) realloc_with_check(chunk->text, chunk->text_capacity);
+	}
+	memcpy(chunk->text + chunk->text_length, line, length);
+	chunk->text_length += length;
+}
+
+static char* find_symbol(symbol_index* index, long address){
+	long low = 0, high = index->count - 1, middle;
+	while (low <= high) {
+		middle = (low + high) / 2;
+		if (index->symbols[middle].address == address) {
+			return index->symbols[middle].name;
+		}
+		if (index->symbols[middle].address < address) {
+			low = middle + 1;
+		}
+		else {
+			high = middle - 1;
+		}
+	}
+	return NULL;
+}
+
+static void build_label_index(object_file* obj, disasm_chunk* chunks, int chunk_count, symbol_index* labels){
+	long i, j, count = obj->entry_count, unique;
+	long* addresses;
+	char name[MAX_LABEL_LENGTH + 2];
+
+	for (i = 0; i < chunk_count; i++) {
+		count += chunks[i].target_count;
+	}
+	/* all the used addresses and the entries, sorted and unique */
+	addresses = (long *) malloc_with_check((count + 1) * sizeof(long));
+	for (i = 0, j = 0; i < chunk_count; i++) {
+		memcpy(addresses + j, chunks[i].targets, chunks[i].target_count * sizeof(long));
+		j += chunks[i].target_count;
+	}
+	for (i = 0; i < obj->entry_count; i++) {
+		addresses[j++] = obj->entries[i].address;
+	}
+	qsort(addresses, count, sizeof(long), compare_addresses);
+	for (i = 0, unique = 0; i < count; i++) {
+		if (unique == 0 || addresses[unique - 1] != addresses[i]) {
+			addresses[unique++] = addresses[i];
+		}
+	}
+
+	labels->count = unique;
+	labels->symbols = (address_symbol *) malloc_with_check((unique + 1) * sizeof(address_symbol));
+	for (i = 0; i < unique; i++) {
+		labels->symbols[i].address = addresses[i];
+		labels->symbols[i].name = NULL;
+		/* an entry keeps it's name */
+		for (j = 0; j < obj->entry_count; j++) {
+			if (obj->entries[j].address == addresses[i]) {
+				labels->symbols[i].name = (char *) malloc_with_check(strlen(obj->entries[j].name) + 1);
+				strcpy(labels->symbols[i].name, obj->entries[j].name);
+				break;
+			}
+		}
+		if (labels->symbols[i].name == NULL) {
+			sprintf(name, "%c%.4ld", addresses[i] < IC_INIT_VALUE + obj->code_size ? 'L' : 'D', addresses[i]);
+			labels->symbols[i].name = (char *) malloc_with_check(strlen(name) + 1);
+			strcpy(labels->symbols[i].name, name);
+		}
+	}
+	free(addresses);
+}
+
+static void write_data(object_file* obj, symbol_index* labels, bool with_hex, FILE* out){
+	long i, address, in_line = 0;
+	char* label;
+
+	for (i = 0; i < obj->data_size; i++) {
+		address = IC_INIT_VALUE + obj->code_size + i;
+		label = find_symbol(labels, address);
+		/* a new line for every label, and every few bytes */
+		if (label != NULL || in_line == DATA_BYTES_PER_LINE) {
+			fprintf(out, in_line > 0 ? "\n" : "");
+			in_line = 0;
+		}
+		if (in_line == 0) {
+			if (with_hex) {
+				fprintf(out, "%.4ld  %-11s  ", address, "");
+			}
+			fprintf(out, "%s%s\t.db ", label != NULL ? label : "", label != NULL ? ":" : "");
+		}
+		fprintf(out, "%s%d", in_line > 0 ? "," : "", (int) (signed char) obj->data[i]);
+		in_line++;
+	}
+	if (in_line > 0) {
+		fprintf(out, "\n");
+	}
+}
+
+static void write_externals(symbol_index* externals, FILE* out){
+	char** names = (char **) malloc_with_check((externals->count + 1) * sizeof(char *));
+	long i;
+
+	for (i = 0; i < externals->count; i++) {
+		names[i] = externals->symbols[i].name;
+	}
+	qsort(names, externals->count, sizeof(char *), compare_names);
+	for (i = 0; i < externals->count; i++) {
+		if (i == 0 || strcmp(names[i], names[i - 1]) != 0) {
+			fprintf(out, ".extern %s\n", names[i]);
+		}
+	}
+	free(names);
+}
+
+static int compare_symbols(const void* first, const void* second){
+	long diff = ((address_symbol *) first)->address - ((address_symbol *) second)->address;
+	return diff < 0 ? -1 : diff > 0;
+}
+
+static int compare_addresses(const void* first, const void* second){
+	long diff = *(long *) first - *(long *) second;
+	return diff < 0 ? -1 : diff > 0;
+}
+
+static int compare_names(const void* first, const void* second){
+	return strcmp(*(char **) first, *(char **) second);
+}
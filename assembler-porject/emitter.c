@@ -0,0 +1,462 @@
+/* Implements the emitter - the same words, data and label references as the first pass builds from source lines */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "emitter.h"
+#include "code.h"
+#include "instructions.h"
+#include "second_pass.h"
+#include "write_output.h"
+#include "batch_io.h"
+#include "utils.h"
+
+/**
+ * Starts the next emitted statement
+ * @param em The emitter
+ * @return The line of the statement, for the diagnostics
+ */
+static line_info next_statement(emitter* em);
+
+/**
+ * Defines the pending label of the emitter, if any, at an address
+ * @param em The emitter
+ * @param line The line of the statement
+ * @param type CODE_SYMBOL or DATA_SYMBOL
+ * @param address The address of the statement
+ * @return Whether succeeded - the label isn't defined already
+ */
+static bool define_pending_label(emitter* em, line_info line, symbol_type type, long address);
+
+/**
+ * Gets the name of a label handle
+ * @param em The emitter
+ * @param line The line of the statement
+ * @param label The label
+ * @return The name, NULL if the handle is invalid
+ */
+static char* get_label_name(emitter* em, line_info line, label_handle label);
+
+/**
+ * Finds the descriptor of an emitted command, and checks that it's emitted by the right call
+ * @param line The line of the statement
+ * @param opc The opcode
+ * @param func The funct
+ * @param format The format of the call - 'r', 'i' or 'j'
+ * @param field The field the call encodes, NO_FIELD if any
+ * @return The descriptor, NULL if it's not a command of the call
+ */
+static command_descriptor* find_emitted_command(line_info line, opcode opc, funct func, char format, operand_field field);
+
+/**
+ * Checks that register numbers are valid
+ * @param line The line of the statement
+ * @param count The count of the registers
+ * @param ... The registers
+ * @return Whether all of them are valid
+ */
+static bool check_registers(line_info line, int count, ...);
+
+/**
+ * Allocates a code word of a command, with all it's fields 0
+ * @param command The command
+ * @return The code word
+ */
+static code_word* new_code_word(command_descriptor* command);
+
+/**
+ * Appends a code word to the code image, with the label it uses
+ * @param em The emitter
+ * @param line The line of the statement
+ * @param codeword The code word, freed if it's not appended
+ * @param target The label operand of the word, NO_LABEL if none
+ * @return Whether succeeded - the code image has room for it
+ */
+static bool add_code_word(emitter* em, line_info line, code_word* codeword, label_handle target);
+
+void init_emitter(emitter* em, char* file_name, bool auto_align, bool merge_strings){
+	memset(em, 0, sizeof(emitter));
+	em->file_name = file_name;
+	em->ic = IC_INIT_VALUE;
+	em->dc = DC_INIT_VALUE;
+	em->code_img = (machine_word **) malloc_with_check(CODE_ARR_IMG_LENGTH * sizeof(machine_word *));
+	memset(em->code_img, 0, CODE_ARR_IMG_LENGTH * sizeof(machine_word *));
+	init_data_image(&em->data);
+	em->data.auto_align = auto_align;
+	em->data.merge_strings = merge_strings;
+	init_diagnostics(&em->diag, FALSE);
+	em->pending_label = NO_LABEL;
+}
+
+label_handle get_label_handle(emitter* em, char* name){
+	line_info line;
+
+	if (!is_valid_label_name(name)) {
+		line = next_statement(em);
+		print_error(line, LABEL_NAME_ERR, "Illegal label name: %.*s", MAX_LABEL_LENGTH, name); /* the name is of the caller, of any length */
+		return NO_LABEL;
+	}
+	if (em->label_count == em->label_capacity) {
+		em->label_capacity = em->label_capacity == 0 ? 16 : em->label_capacity * 2;
+		em->labels = (char **) realloc_with_check(em->labels, em->label_capacity * sizeof(char *));
+	}
+	em->labels[em->label_count] = (char *) malloc_with_check(strlen(name) + 1);
+	strcpy(em->labels[em->label_count], name);
+	return em->label_count++;
+}
+
+bool emit_label(emitter* em, label_handle label){
+	line_info line;
+
+	if (em->pending_label != NO_LABEL) {
+		line = next_statement(em);
+		print_error(line, LABEL_NAME_ERR, "The label %s has no statement.", em->labels[em->pending_label]);
+		em->pending_label = NO_LABEL;
+		return FALSE;
+	}
+	if (label < 0 || label >= em->label_count) {
+		line = next_statement(em);
+		return get_label_name(em, line, label) != NULL;
+	}
+	em->pending_label = label;
+	return TRUE;
+}
+
+bool emit_r(emitter* em, opcode opc, funct func, int rs, int rt, int rd){
+	line_info line = next_statement(em);
+	command_descriptor* command;
+	code_word* codeword;
+
+	if (!define_pending_label(em, line, CODE_SYMBOL, em->ic) ||
+			(command = find_emitted_command(line, opc, func, 'r', NO_FIELD)) == NULL ||
+			!check_registers(line, 3, rs, command->operand_count == 3 ? rt : 0, rd)) {
+		return FALSE;
+	}
+	codeword = new_code_word(command);
+	codeword->commad_type.r->rs = rs;
+	codeword->commad_type.r->rt = command->operand_count == 3 ? rt : 0;
+	codeword->commad_type.r->rd = rd;
+	return add_code_word(em, line, codeword, NO_LABEL);
+}
+
+bool emit_i(emitter* em, opcode opc, int rs, long immed, int rt){
+	line_info line = next_statement(em);
+	command_descriptor* command;
+	code_word* codeword;
+
+	if (!define_pending_label(em, line, CODE_SYMBOL, em->ic) ||
+			(command = find_emitted_command(line, opc, NONE_FUNCT, 'i', IMMED_FIELD)) == NULL ||
+			!check_registers(line, 2, rs, rt)) {
+		return FALSE;
+	}
+	/* the immed field has 16 bits */
+	if (immed < -0x8000L || immed > 0x7FFFL) {
+		print_error(line, OPERAND_RANGE_ERR, "The immediate value %ld is out of range.", immed);
+		return FALSE;
+	}
+	codeword = new_code_word(command);
+	codeword->commad_type.i->rs = rs;
+	codeword->commad_type.i->immed = immed;
+	codeword->commad_type.i->rt = rt;
+	return add_code_word(em, line, codeword, NO_LABEL);
+}
+
+bool emit_branch(emitter* em, opcode opc, int rs, int rt, label_handle target){
+	line_info line = next_statement(em);
+	command_descriptor* command;
+	code_word* codeword;
+
+	if (!define_pending_label(em, line, CODE_SYMBOL, em->ic) ||
+			(command = find_emitted_command(line, opc, NONE_FUNCT, 'i', OFFSET_FIELD)) == NULL ||
+			!check_registers(line, 2, rs, rt) || get_label_name(em, line, target) == NULL) {
+		return FALSE;
+	}
+	/* the distance to the label is encoded in the second pass */
+	codeword = new_code_word(command);
+	codeword->commad_type.i->rs = rs;
+	codeword->commad_type.i->rt = rt;
+	return add_code_word(em, line, codeword, target);
+}
+
+bool emit_j(emitter* em, opcode opc, label_handle target){
+	line_info line = next_statement(em);
+	command_descriptor* command;
+	code_word* codeword;
+	char* name = NULL;
+
+	if (!define_pending_label(em, line, CODE_SYMBOL, em->ic) ||
+			(command = find_emitted_command(line, opc, NONE_FUNCT, 'j', NO_FIELD)) == NULL) {
+		return FALSE;
+	}
+	if ((target == NO_LABEL) != (command->operand_count == 0)) {
+		if (command->operand_count == 0) {
+			print_error(line, OPERAND_COUNT_ERR, "Operation requires no operands, got 1");
+		}
+		else {
+			print_error(line, OPERAND_COUNT_ERR, "Operation requires 1 operand, got 0");
+		}
+		return FALSE;
+	}
+	if (target != NO_LABEL && (name = get_label_name(em, line, target)) == NULL) {
+		return FALSE;
+	}
+	/* the address of the label, which is encoded again in the second pass */
+	codeword = new_code_word(command);
+	codeword->commad_type.j->address = name != NULL ? find_by_name(em->symbol_table, name) : 0;
+	return add_code_word(em, line, codeword, target);
+}
+
+bool emit_jmp_register(emitter* em, int reg){
+	line_info line = next_statement(em);
+	command_descriptor* command;
+	code_word* codeword;
+
+	if (!define_pending_label(em, line, CODE_SYMBOL, em->ic) || !check_registers(line, 1, reg)) {
+		return FALSE;
+	}
+	command = get_command_by_code(JMP_OP, NONE_FUNCT);
+	codeword = new_code_word(command);
+	codeword->commad_type.j->reg = 1;
+	codeword->commad_type.j->address = reg;
+	return add_code_word(em, line, codeword, NO_LABEL);
+}
+
+bool emit_data(emitter* em, instruction inst, long* values, int count){
+	line_info line = next_statement(em);
+	int i, size = inst == DB_INST ? 1 : inst == DH_INST ? 2 : 4;
+	/* the same bounds as the numbers of the source - signed, or the unsigned bit patterns */
+	unsigned long max = size == 4 ? 0xFFFFFFFFUL : (1UL << (size * BYTE)) - 1;
+	long min = -(long) (max / 2) - 1;
+
+	if (inst != DB_INST && inst != DH_INST && inst != DW_INST) {
+		print_error(line, UNKNOWN_INSTRUCTION_ERR, "Invalid data instruction.");
+		return FALSE;
+	}
+	for (i = 0; i < count; i++) {
+		if (values[i] < min || (values[i] > 0 && (unsigned long) values[i] > max)) {
+			print_error(line, DATA_RANGE_ERR, "The value %ld is out of range for this instruction", values[i]);
+			return FALSE;
+		}
+	}
+	if (inst != DB_INST && em->data.auto_align) {
+		align_data_counter(&em->dc, size, &em->data);
+	}
+	if (!define_pending_label(em, line, DATA_SYMBOL, em->dc)) {
+		return FALSE;
+	}
+	for (i = 0; i < count; i++) {
+		add_data_value(&em->data, (unsigned long) values[i], size);
+		em->dc += size;
+	}
+	return TRUE;
+}
+
+bool emit_string(emitter* em, char* string){
+	line_info line = next_statement(em);
+	long size_before = em->data.size, address;
+
+	/* the label of a string is defined after it, as a merged string has the address of the same string before it */
+	address = add_data_string(&em->data, string, em->dc);
+	em->dc += em->data.size - size_before;
+	return define_pending_label(em, line, DATA_SYMBOL, address);
+}
+
+bool emit_space(emitter* em, long size){
+	line_info line = next_statement(em);
+
+	if (size < 0 || size > 0x7FFFFFFFL) {
+		print_error(line, DATA_RANGE_ERR, "The size of .space is out of range");
+		return FALSE;
+	}
+	if (!define_pending_label(em, line, DATA_SYMBOL, em->dc)) {
+		return FALSE;
+	}
+	add_data_fill(&em->data, size, 1, 0);
+	em->dc += size;
+	return TRUE;
+}
+
+bool emit_align(emitter* em, int alignment){
+	line_info line = next_statement(em);
+
+	if (alignment != 1 && alignment != 2 && alignment != MAX_DATA_ALIGNMENT) {
+		print_error(line, DATA_RANGE_ERR, "The alignment of .align must be 1, 2 or %d", MAX_DATA_ALIGNMENT);
+		return FALSE;
+	}
+	/* the padding comes before the label, so the label has the aligned address */
+	align_data_counter(&em->dc, alignment, &em->data);
+	return define_pending_label(em, line, DATA_SYMBOL, em->dc);
+}
+
+bool emit_extern(emitter* em, label_handle label){
+	line_info line = next_statement(em);
+	char* name;
+
+	em->pending_label = NO_LABEL; /* a label of .extern is ignored */
+	if ((name = get_label_name(em, line, label)) == NULL) {
+		return FALSE;
+	}
+	add_table_item(&em->symbol_table, name, 0, EXTERNAL_SYMBOL);
+	return TRUE;
+}
+
+bool emit_entry(emitter* em, label_handle label){
+	line_info line = next_statement(em);
+	char* name;
+
+	if (em->pending_label != NO_LABEL) {
+		em->pending_label = NO_LABEL;
+		print_error(line, ENTRY_ERR, "Can't define a label to an entry instruction.");
+		return FALSE;
+	}
+	if ((name = get_label_name(em, line, label)) == NULL) {
+		return FALSE;
+	}
+	/* resolved in the second pass, after all the symbols are known */
+	add_label_ref(&em->refs, 0, TRUE, name, line);
+	return TRUE;
+}
+
+bool finish_emitter(emitter* em, bool with_relocations, table_format ext_format){
+	bool is_success = em->diag.error_count == 0;
+
+	/* as a source with first pass errors, an invalid statement prevents the second pass */
+	if (is_success) {
+		add_value_to_type(em->symbol_table, em->ic, DATA_SYMBOL);
+		is_success = process_label_refs_sp(&em->refs, em->code_img, &em->symbol_table);
+	}
+	if (is_success) {
+		is_success = write_output_files(em->code_img, em->ic, em->dc, em->file_name, em->symbol_table, &em->data, &em->refs,
+				NULL, with_relocations, ext_format, NULL);
+	}
+	if (!flush_output_files()) {
+		is_success = FALSE;
+	}
+	flush_diagnostics(&em->diag, stdout);
+	return is_success;
+}
+
+void free_emitter(emitter* em){
+	long i;
+	for (i = 0; i < em->label_count; i++) {
+		free(em->labels[i]);
+	}
+	free(em->labels);
+	free_code_image(em->code_img, em->ic - IC_INIT_VALUE);
+	free(em->code_img);
+	free_table(em->symbol_table);
+	free_data_image(&em->data);
+	free_label_refs(&em->refs);
+	free_diagnostics(&em->diag);
+	memset(em, 0, sizeof(emitter));
+}
+
+static line_info next_statement(emitter* em){
+	line_info line;
+	line.line_number = ++em->statement_count;
+	line.file_name = em->file_name;
+	line.content = NULL;
+	line.diag = &em->diag;
+	em->diag.order = em->statement_count;
+	return line;
+}
+
+static bool define_pending_label(emitter* em, line_info line, symbol_type type, long address){
+	char* name;
+
+	if (em->pending_label == NO_LABEL) {
+		return TRUE;
+	}
+	name = em->labels[em->pending_label];
+	em->pending_label = NO_LABEL;
+	if (find_by_types(em->symbol_table, name, 3, EXTERNAL_SYMBOL, DATA_SYMBOL, CODE_SYMBOL)) {
+		print_error(line, SYMBOL_REDEFINED_ERR, "Symbol %s is already defined.", name);
+		return FALSE;
+	}
+	add_table_item(&em->symbol_table, name, address, type);
+	return TRUE;
+}
+
+static char* get_label_name(emitter* em, line_info line, label_handle label){
+	if (label < 0 || label >= em->label_count) {
+		print_error(line, LABEL_NAME_ERR, "Invalid label handle %ld.", label);
+		return NULL;
+	}
+	return em->labels[label];
+}
+
+static command_descriptor* find_emitted_command(line_info line, opcode opc, funct func, char format, operand_field field){
+	command_descriptor* command = get_command_by_code(opc, func);
+	int i;
+
+	for (i = 0; command != NULL && command->format == format && field != NO_FIELD && i < command->operand_count; i++) {
+		if (command->fields[i] == field) {
+			break;
+		}
+	}
+	if (command == NULL || command->format != format || (field != NO_FIELD && i == command->operand_count)) {
+		print_error(line, UNKNOWN_COMMAND_ERR, "Unrecognized command: opcode %d, funct %d.", (int) opc, (int) func);
+		return NULL;
+	}
+	return command;
+}
+
+static bool check_registers(line_info line, int count, ...){
+	va_list registers;
+	int i, reg;
+	bool is_valid = TRUE;
+
+	va_start(registers, count);
+	for (i = 0; i < count && is_valid; i++) {
+		reg = va_arg(registers, int);
+		if (reg < 0 || reg > 31) {
+			print_error(line, OPERAND_RANGE_ERR, "Invalid register %d.", reg);
+			is_valid = FALSE;
+		}
+	}
+	va_end(registers);
+	return is_valid;
+}
+
+static code_word* new_code_word(command_descriptor* command){
+	code_word* codeword = (code_word *) malloc_with_check(sizeof(code_word));
+	codeword->opcode = command->opc;
+	codeword->command = command->format;
+	if (command->format == 'r') {
+		codeword->commad_type.r = (r_command *) malloc_with_check(sizeof(r_command));
+		codeword->commad_type.r->funct = command->func;
+		codeword->commad_type.r->NONE = codeword->commad_type.r->rt = codeword->commad_type.r->rd = codeword->commad_type.r->rs = 0;
+	}
+	else if (command->format == 'i') {
+		codeword->commad_type.i = (i_command *) malloc_with_check(sizeof(i_command));
+		codeword->commad_type.i->immed = codeword->commad_type.i->rt = codeword->commad_type.i->rs = 0;
+	}
+	else {
+		codeword->commad_type.j = (j_command *) malloc_with_check(sizeof(j_command));
+		codeword->commad_type.j->reg = codeword->commad_type.j->address = 0;
+	}
+	return codeword;
+}
+
+static bool add_code_word(emitter* em, line_info line, code_word* codeword, label_handle target){
+	machine_word* word;
+
+	if (em->ic - IC_INIT_VALUE + 4 > CODE_ARR_IMG_LENGTH) {
+		word = (machine_word *) malloc_with_check(sizeof(machine_word));
+		word->length = 4;
+		word->word.code = codeword;
+		free_code_word(word);
+		print_error(line, IMAGE_SIZE_ERR, "The code image is too large.");
+		return FALSE;
+	}
+	/* the label operand is encoded in the second pass */
+	if (target != NO_LABEL) {
+		add_label_ref(&em->refs, em->ic, FALSE, em->labels[target], line);
+	}
+	word = (machine_word *) malloc_with_check(sizeof(machine_word));
+	word->word.code = codeword;
+	word->length = 4;
+	em->code_img[em->ic - IC_INIT_VALUE] = word;
+	em->ic += 4;
+	return TRUE;
+}
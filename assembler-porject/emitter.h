@@ -0,0 +1,176 @@
+/* The emitter: builds a program by typed calls instead of source lines - for code generators, that would otherwise
+ * format assembly text for the first pass to parse back. The calls append the code words, the data and the label
+ * references directly, and the program is finished by the second pass and the output writers of the assembler. */
+#ifndef _EMITTER_H
+#define _EMITTER_H
+
+#include "globals.h"
+#include "table.h"
+#include "data_image.h"
+#include "diagnostics.h"
+
+/** The handle of no label, for the commands without a label operand */
+#define NO_LABEL -1
+
+/* A label of an emitter, by the index of it's name */
+typedef long label_handle;
+
+/* A program being emitted */
+typedef struct emitter {
+	char* file_name; /* the outputs name, without the extension. not a copy */
+	long ic, dc;
+	machine_word** code_img;
+	table symbol_table;
+	data_image data;
+	label_ref_list refs;
+	diagnostics diag;
+	char** labels; /* the names of the label handles */
+	long label_count, label_capacity;
+	label_handle pending_label; /* the label of the next emitted statement, NO_LABEL if none */
+	long statement_count; /* the emitted statements, as the line numbers of the diagnostics */
+} emitter;
+
+/**
+ * Initializes an empty program
+ * @param em The emitter
+ * @param file_name The name of the outputs, without the extension
+ * @param auto_align Whether .dh and .dw data are aligned to their size
+ * @param merge_strings Whether the same strings are stored once
+ */
+void init_emitter(emitter* em, char* file_name, bool auto_align, bool merge_strings);
+
+/**
+ * Gets a handle of a label name, to define it and to use it as operand. The name is checked once, here.
+ * @param em The emitter
+ * @param name The label name
+ * @return The handle, NO_LABEL if the name is invalid
+ */
+label_handle get_label_handle(emitter* em, char* name);
+
+/**
+ * Defines a label at the next emitted statement, like a label at the start of a source line
+ * @param em The emitter
+ * @param label The label
+ * @return Whether succeeded
+ */
+bool emit_label(emitter* em, label_handle label);
+
+/**
+ * Emits an R command: add, sub, and, or, nor (rs, rt, rd) or move, mvhi, mvlo (rs, rd)
+ * @param em The emitter
+ * @param opc The opcode
+ * @param func The funct
+ * @param rs The rs register
+ * @param rt The rt register, ignored by the commands of 2 operands
+ * @param rd The rd register
+ * @return Whether succeeded
+ */
+bool emit_r(emitter* em, opcode opc, funct func, int rs, int rt, int rd);
+
+/**
+ * Emits an I command with an immediate: addi, subi, andi, ori, nori, lb, sb, lw, sw, lh, sh
+ * @param em The emitter
+ * @param opc The opcode
+ * @param rs The rs register
+ * @param immed The immediate, in the range of 16 bits
+ * @param rt The rt register
+ * @return Whether succeeded
+ */
+bool emit_i(emitter* em, opcode opc, int rs, long immed, int rt);
+
+/**
+ * Emits a branch: bne, beq, blt, bgt
+ * @param em The emitter
+ * @param opc The opcode
+ * @param rs The rs register
+ * @param rt The rt register
+ * @param target The label to branch to
+ * @return Whether succeeded
+ */
+bool emit_branch(emitter* em, opcode opc, int rs, int rt, label_handle target);
+
+/**
+ * Emits a J command: jmp, la or call of a label, or stop
+ * @param em The emitter
+ * @param opc The opcode
+ * @param target The label, NO_LABEL for stop
+ * @return Whether succeeded
+ */
+bool emit_j(emitter* em, opcode opc, label_handle target);
+
+/**
+ * Emits a jmp to the address in a register
+ * @param em The emitter
+ * @param reg The register
+ * @return Whether succeeded
+ */
+bool emit_jmp_register(emitter* em, int reg);
+
+/**
+ * Emits data values, like .db, .dh and .dw
+ * @param em The emitter
+ * @param inst DB_INST, DH_INST or DW_INST
+ * @param values The values, each in the range of the instruction
+ * @param count The values count
+ * @return Whether succeeded
+ */
+bool emit_data(emitter* em, instruction inst, long* values, int count);
+
+/**
+ * Emits a string and it's terminator, like .asciz
+ * @param em The emitter
+ * @param string The string
+ * @return Whether succeeded
+ */
+bool emit_string(emitter* em, char* string);
+
+/**
+ * Emits zero bytes, like .space
+ * @param em The emitter
+ * @param size The bytes count
+ * @return Whether succeeded
+ */
+bool emit_space(emitter* em, long size);
+
+/**
+ * Aligns the data counter, like .align
+ * @param em The emitter
+ * @param alignment 1, 2 or MAX_DATA_ALIGNMENT
+ * @return Whether succeeded
+ */
+bool emit_align(emitter* em, int alignment);
+
+/**
+ * Declares a label as external, like .extern
+ * @param em The emitter
+ * @param label The label
+ * @return Whether succeeded
+ */
+bool emit_extern(emitter* em, label_handle label);
+
+/**
+ * Declares a label as entry, like .entry
+ * @param em The emitter
+ * @param label The label
+ * @return Whether succeeded
+ */
+bool emit_entry(emitter* em, label_handle label);
+
+/**
+ * Finishes the program: resolves the label operands and the entries, and writes the outputs as the assembler does
+ * for a source file - nothing is written if an emitted statement was invalid. The diagnostics are printed to the
+ * standard output.
+ * @param em The emitter
+ * @param with_relocations Whether to write the relocations (.rel) too
+ * @param ext_format The format of the external references
+ * @return Whether succeeded
+ */
+bool finish_emitter(emitter* em, bool with_relocations, table_format ext_format);
+
+/**
+ * Deallocates all the memory required by an emitter
+ * @param em The emitter
+ */
+void free_emitter(emitter* em);
+
+#endif
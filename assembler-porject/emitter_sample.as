@@ -0,0 +1,21 @@
+; The program of emitter_sample.c, as a source
+.extern EXT
+.entry MAIN
+MAIN: add $1,$2,$3
+	move $4,$5
+	addi $1,-5,$2
+LOOP: sw $3,12,$4
+	bne $1,$2,LOOP
+	beq $1,$2,END
+	jmp EXT
+	la STR
+	call MAIN
+	jmp $7
+.entry STR
+END: stop
+STR: .asciz "hello"
+NUMS: .dh 1,-2,0xFFFF
+	.db 7
+	.align 4
+WORDS: .dw -2147483647,0xFFFFFFFF
+BUFFER: .space 3
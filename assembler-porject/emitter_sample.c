@@ -0,0 +1,57 @@
+/* A sample client of the emitter: emits the program of emitter_sample.as by calls, and writes the same outputs */
+#include <stdio.h>
+#include "emitter.h"
+
+/** The name of the outputs, unless given by the command line */
+#define SAMPLE_FILE_NAME "emitter_sample"
+
+int main(int argc, char *argv[]){
+	emitter em;
+	label_handle ext, main_label, loop, end, str, nums, words, buffer;
+	long halves[] = {1, -2, 0xFFFF}, bytes[] = {7}, full_words[] = {-2147483647L, 0xFFFFFFFFL};
+	bool succeeded;
+
+	init_emitter(&em, argc > 1 ? argv[1] : SAMPLE_FILE_NAME, FALSE, FALSE);
+	/* the names are checked once, and the statements refer to them by handle */
+	ext = get_label_handle(&em, "EXT");
+	main_label = get_label_handle(&em, "MAIN");
+	loop = get_label_handle(&em, "LOOP");
+	end = get_label_handle(&em, "END");
+	str = get_label_handle(&em, "STR");
+	nums = get_label_handle(&em, "NUMS");
+	words = get_label_handle(&em, "WORDS");
+	buffer = get_label_handle(&em, "BUFFER");
+
+	emit_extern(&em, ext);
+	emit_entry(&em, main_label);
+	emit_label(&em, main_label);
+	emit_r(&em, ADD_OP, ADD_FUNCT, 1, 2, 3);
+	emit_r(&em, MOVE_OP, MOVE_FUNCT, 4, 0, 5);
+	emit_i(&em, ADDI_OP, 1, -5, 2);
+	emit_label(&em, loop);
+	emit_i(&em, SW_OP, 3, 12, 4);
+	emit_branch(&em, BNE_OP, 1, 2, loop);
+	emit_branch(&em, BEQ_OP, 1, 2, end);
+	emit_j(&em, JMP_OP, ext);
+	emit_j(&em, LA_OP, str);
+	emit_j(&em, CALL_OP, main_label);
+	emit_jmp_register(&em, 7);
+	emit_entry(&em, str);
+	emit_label(&em, end);
+	emit_j(&em, STOP_OP, NO_LABEL);
+
+	emit_label(&em, str);
+	emit_string(&em, "hello");
+	emit_label(&em, nums);
+	emit_data(&em, DH_INST, halves, 3);
+	emit_data(&em, DB_INST, bytes, 1);
+	emit_align(&em, MAX_DATA_ALIGNMENT);
+	emit_label(&em, words);
+	emit_data(&em, DW_INST, full_words, 2);
+	emit_label(&em, buffer);
+	emit_space(&em, 3);
+
+	succeeded = finish_emitter(&em, FALSE, TABLE_LINES);
+	free_emitter(&em);
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,308 @@
+; Code image errors - the code image holds 300 instructions
+
+.entry MAIN
+MAIN: add $1,$2,$3
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+add $1,$2,$3
+sub $4,$5,$6
+addi $7,-3,$8
+move $9,$10
+and $11,$12,$13
+or $14,$15,$16
+nor $17,$18,$19
+ori $20,12,$21
+andi $22,7,$23
+mvhi $24,$25
+LAST: bne $1,$2,MAIN
+; past the code image
+jmp MAIN
+EXTRA: call LAST
+stop
+DATA: .db 1,2,3
@@ -0,0 +1,24 @@
+; Errors of the numeric literals, the data directives and the macros
+MAIN: addi $1,0x10000,$2
+	subi $3,-32769,$4
+	ori $5,0b2,$6
+	andi $7,'ab',$8
+	stop
+	.db 0x100
+	.dh -0x8001
+	.dw 0x100000000
+	.db 0x
+	.space -1
+	.space 1,2
+	.fill 2,3,0
+	.fill 2,1,256
+	.fill -1,1,0
+	.align 3
+	.incbin "errors_input4.missing"
+	.incbin "errors_input4.as", 0, 100000
+mcro stop
+endmcro
+endmcro
+mcro twice
+	mcro inner
+endmcro
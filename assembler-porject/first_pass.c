@@ -7,6 +7,32 @@
 #include "utils.h"
 #include "instructions.h"
 #include "first_pass.h"
+#include "parallel.h"
+
+/* A label defined by a line of a chunk, checked against the labels of the chunks before it */
+typedef struct label_def {
+	char* label;
+	long value; /* the address in the chunk */
+	symbol_type type;
+	long line_index;
+} label_def;
+
+/* A chunk of lines, processed by a single thread with it's own counters, images and symbols */
+typedef struct fp_chunk {
+	fp_line* lines;
+	long line_count;
+	long first_line; /* the index of the first line of the chunk */
+	long ic, dc; /* the counters of the chunk */
+	long dc_start; /* the data counter the chunk started from - the data alignment depends on it */
+	machine_word** code_img;
+	data_image data;
+	table symbols; /* the symbols defined by the chunk, by their address in the chunk */
+	label_ref_list refs;
+	diagnostics diag;
+	label_def* defs; /* the labels defined by the chunk, in source order */
+	long def_count, def_capacity;
+	bool is_success;
+} fp_chunk;
 
 /**
  * Processes a single code line in the first pass.
@@ -15,16 +41,58 @@
  * @param line The code line to process
  * @param i Where to start processing the line from
  * @param ic A pointer to the current code counter
- * @param code_img The code image array
+ * @param code_img The code image array, NULL to only count the code words
  * @param tab The symbol table
+ * @param refs The label references list, to add the label operand to
  * @return Whether succeeded or not.
  */
-static bool process_code(line_info line, int i, long* ic, machine_word** code_img, table* tab);
+static bool process_code(line_info line, int i, long* ic, machine_word** code_img, table* tab, label_ref_list* refs);
+
+/**
+ * Initializes the counters, images and symbols of a chunk, to process it's lines
+ * @param chunk The chunk, with it's lines
+ * @param dc The data counter to start from
+ * @param with_code Whether the chunk has a code image, or only counts it's code words
+ * @param data The data image of the file, for it's options
+ * @param diag The diagnostics of the file, for it's options
+ */
+static void init_chunk_fp(fp_chunk* chunk, long dc, bool with_code, data_image* data, diagnostics* diag);
 
-bool process_line_fp(line_info line, long* IC, long* DC, machine_word** code_img, table* symbol_table, data_word** data){
+/**
+ * Deallocates the memory of a chunk, except it's images
+ * @param chunk The chunk
+ */
+static void free_chunk_fp(fp_chunk* chunk);
+
+/**
+ * Thread function: processes the lines of a chunk in the first pass
+ * @param arg The chunk
+ * @return NULL
+ */
+static void* process_chunk_fp(void* arg);
+
+/**
+ * Merges a processed chunk into the file's images, symbols, label references and diagnostics
+ * @param chunk The chunk
+ * @param code_base The code size of the chunks before it
+ * @param data_base The data size of the chunks before it, less the data counter the chunk started from
+ * @param with_images Whether the images of the chunk are merged, or only freed
+ * @param code_img The code image array, NULL if the code words are only counted
+ * @param symbol_table The symbol table
+ * @param data The data image array
+ * @param refs The label references
+ * @param diag The diagnostics of the file
+ * @return Whether succeeded - no label is defined twice
+ */
+static bool merge_chunk_fp(fp_chunk* chunk, long code_base, long data_base, bool with_images, machine_word** code_img,
+		table* symbol_table, data_image* data, label_ref_list* refs, diagnostics* diag);
+
+bool process_line_fp(line_info line, long* IC, long* DC, machine_word** code_img, table* symbol_table, data_image* data, label_ref_list* refs){
   int i=0, j;
 	char symbol[MAX_LINE_LENGTH];
 	instruction instruction;
+	long address;
+	bool result;
   SKIP_TO_NOT_WHITE(line.content, i) /* move to next non-white char */
 
   if (!line.content[i] || line.content[i] == '\n' || line.content[i] == EOF || line.content[i] == ';'){
@@ -36,7 +104,7 @@ bool process_line_fp(line_info line, long* IC, long* DC, machine_word** code_img
 	}
   /* if illegal name */
 	if (symbol[0] && !is_valid_label_name(symbol)) {
-		print_error(line, "Illegal label name: %s", symbol);
+		print_error(line, LABEL_NAME_ERR, "Illegal label name: %s", symbol);
 		return FALSE;
 	}
 	if (symbol[0] != '\0') {
@@ -50,7 +118,7 @@ bool process_line_fp(line_info line, long* IC, long* DC, machine_word** code_img
 
   /* if already defined as data/external/code and not empty line */
 	if (find_by_types(*symbol_table, symbol, 3, EXTERNAL_SYMBOL, DATA_SYMBOL, CODE_SYMBOL)) {
-		print_error(line, "Symbol %s is already defined.", symbol);
+		print_error(line, SYMBOL_REDEFINED_ERR, "Symbol %s is already defined.", symbol);
 		return FALSE;
 	}
   /* check if it's an instruction (starting with '.') */
@@ -62,19 +130,43 @@ bool process_line_fp(line_info line, long* IC, long* DC, machine_word** code_img
   SKIP_TO_NOT_WHITE(line.content, i)
   /* is it's an instruction */
   if (instruction != NONE_INST){
-    /* if .asciz or .dh, .dw, .db, and symbol defined, put it into the symbol table */
-		if ((instruction == ASCIZ_INST || instruction == DB_INST || instruction == DW_INST || instruction == DH_INST) && symbol[0] != '\0'){
+    /* the padding comes before the label, so the label has the aligned address */
+		if (instruction == ALIGN_INST && !process_align_instruction(line, i, DC, data)) {
+			return FALSE;
+		}
+		if ((instruction == DH_INST || instruction == DW_INST) && data->auto_align) {
+			align_data_counter(DC, instruction == DH_INST ? 2 : 4, data);
+		}
+    /* the label of a string is added after it, as a merged string has the address of the same string before it */
+		if (instruction == ASCIZ_INST){
+      result = process_asciz_instruction(line, i, DC, data, &address);
+      if (symbol[0] != '\0') {
+        add_table_item(symbol_table, symbol, address, DATA_SYMBOL);
+      }
+      return result;
+    }
+    /* if .dh, .dw, .db, and symbol defined, put it into the symbol table */
+		if ((instruction == DB_INST || instruction == DW_INST || instruction == DH_INST ||
+		     instruction == SPACE_INST || instruction == FILL_INST || instruction == INCBIN_INST || instruction == ALIGN_INST) &&
+		    symbol[0] != '\0'){
           /* is data or string, add DC with the symbol to the table as data */
 			    add_table_item(symbol_table, symbol, *DC, DATA_SYMBOL);
     }
-    /* if asciz, encode into data image buffer and increase dc as needed. */
-		if (instruction == ASCIZ_INST){
-      return process_asciz_instruction(line, i, DC, data);
-    }
-    /* if data instructions: .db, .dh, .dw, do same but need to parse the numbers. */
-		else if (instruction == DB_INST || instruction == DH_INST || instruction == DW_INST){
+    /* if data instructions: .db, .dh, .dw, encode into data image buffer, and increase dc as needed. */
+		if (instruction == DB_INST || instruction == DH_INST || instruction == DW_INST){
       return process_data_instruction(line, i,DC, instruction, data);
     }
+    /* .space and .fill reserve many bytes, which are kept as a single segment until the object is written */
+		else if (instruction == SPACE_INST){
+      return process_space_instruction(line, i, DC, data);
+    }
+		else if (instruction == FILL_INST){
+      return process_fill_instruction(line, i, DC, data);
+    }
+    /* .incbin splices a binary file into the data image, without copying it */
+		else if (instruction == INCBIN_INST){
+      return process_incbin_instruction(line, i, DC, data);
+    }
     /* if .extern, add to externals symbol table */
 		else if (instruction == EXTERN_INST){
       SKIP_TO_NOT_WHITE(line.content, i)
@@ -85,16 +177,24 @@ bool process_line_fp(line_info line, long* IC, long* DC, machine_word** code_img
       symbol[j] = 0;
       /* if invalid external label name, it's an error */
 			if (!is_valid_label_name(symbol)) {
-				print_error(line, "Invalid external label name: %s", symbol);
+				print_error(line, LABEL_NAME_ERR, "Invalid external label name: %s", symbol);
 				return TRUE;
 			}
       add_table_item(symbol_table, symbol, 0, EXTERNAL_SYMBOL); /* Extern value is defaulted to 0 */
     }
     /* if entry and symbol defined, print error */
     else if(instruction == ENTRY_INST && symbol[0] != '\0'){
-      print_error(line, "Can't define a label to an entry instruction.");
+      print_error(line, ENTRY_ERR, "Can't define a label to an entry instruction.");
 			return FALSE;
-    } /* .entry is handled in second pass! */
+    }
+    /* .entry is handled in second pass, after all the symbols are known - keep it's label */
+    else if(instruction == ENTRY_INST){
+			for (j = 0; line.content[i] && line.content[i] != '\n' && line.content[i] != '\t' && line.content[i] != ' ' && line.content[i] != EOF; i++, j++) {
+				symbol[j] = line.content[i];
+			}
+      symbol[j] = 0;
+      add_label_ref(refs, 0, TRUE, symbol, line);
+    }
   }
   /* not instruction, it's a command */
   else{
@@ -103,16 +203,15 @@ bool process_line_fp(line_info line, long* IC, long* DC, machine_word** code_img
       add_table_item(symbol_table, symbol, *IC, CODE_SYMBOL);
     }
     /* analyze the code */
-		return process_code(line, i, IC, code_img, symbol_table);
+		return process_code(line, i, IC, code_img, symbol_table, refs);
   }
   return TRUE;
 }
 
-static bool process_code(line_info line, int i, long* ic, machine_word** code_img, table* tab){
+static bool process_code(line_info line, int i, long* ic, machine_word** code_img, table* tab, label_ref_list* refs){
   char operation[8]; /* stores the string of the current code command */
 	char* operands[3]; /* 3 strings, each for operand */
-  opcode curr_opcode; /* the current opcode and funct values */
-	funct curr_funct;
+	command_descriptor* command; /* the current command */
 	code_word* codeword; /* The current code word */
 	long ic_before;
 	int j, operand_count;
@@ -126,12 +225,12 @@ static bool process_code(line_info line, int i, long* ic, machine_word** code_im
 		  operation[j] = line.content[i];
 	}
   operation[j] = '\0'; /* end of string */
-  /* get opcode & funct by command name into curr_opcode & curr_funct */
-	get_opcode_and_funct(operation, &curr_opcode, &curr_funct);
+  /* get the encoding and the operands of the command by it's name */
+	command = get_command_descriptor(operation);
 
-  /* if invalid operation (opcode is NONE_OP=-1), print and skip processing the line. */
-	if (curr_opcode == NONE_OP) {
-		print_error(line, "Unrecognized command: %s.", operation);
+  /* if invalid operation, print and skip processing the line. */
+	if (command == NULL) {
+		print_error(line, UNKNOWN_COMMAND_ERR, "Unrecognized command: %s.", operation);
 		return FALSE; /* an error occurred */
 	}
 
@@ -140,8 +239,9 @@ static bool process_code(line_info line, int i, long* ic, machine_word** code_im
 		return FALSE;
 	}
 
-  /* build code word struct to store in code image array */
-	if ((codeword = build_code_word(line, curr_opcode, curr_funct, operand_count, operands, tab)) == NULL) {
+  /* build code word struct to store in code image array - without a code image, the operands are only validated */
+	if (code_img == NULL ? !check_code_operands(line, command, operand_count, operands) :
+	    (codeword = build_code_word(line, command, operand_count, operands, tab)) == NULL) {
 		/* release allocated memory for operands */
     while(operand_count > 0){
       free(operands[operand_count-1]);
@@ -149,16 +249,38 @@ static bool process_code(line_info line, int i, long* ic, machine_word** code_im
     }
 		return FALSE;
 	}
+  /* allocate memory for a new word in the code image, and put the code word into it */
+  if (code_img != NULL) {
+	  word_to_write = (machine_word *) malloc_with_check(sizeof(machine_word));
+    (word_to_write->word).code = codeword;
+    word_to_write->length = 4;
+  }
+  /* the code image has a fixed size - a word past it is an error, and the counter stays at the end */
+  if ((*ic) - IC_INIT_VALUE + 4 > CODE_ARR_IMG_LENGTH) {
+    print_error(line, IMAGE_SIZE_ERR, "The code image is too large.");
+    if (code_img != NULL) {
+      free_code_word(word_to_write);
+    }
+    while(operand_count > 0){
+      free(operands[operand_count-1]);
+      operand_count--;
+    }
+    return FALSE;
+  }
   /* ic in position of new code word */
 	ic_before = *ic;
-  /* allocate memory for a new word in the code image, and put the code word into it */
-	word_to_write = (machine_word *) malloc_with_check(sizeof(machine_word));
-  (word_to_write->word).code = codeword;
-  code_img[(*ic) - IC_INIT_VALUE] = word_to_write; /* avoid "spending" cells of the array, by starting from initial value of ic */
-
+  /* keep the label operand (at most one), to encode it in the second pass */
+	for (j = 0; j < operand_count; j++) {
+		if (get_operand_type(operands[j]) == LABEL_TYPE) {
+			add_label_ref(refs, ic_before, FALSE, operands[j], line);
+		}
+	}
   (*ic)+=4; /* increase ic to point the next cell */
-  /* add the final length (of code word + data words) to the code word struct: */
-	code_img[ic_before - IC_INIT_VALUE]->length = (*ic) - ic_before;
+  if (code_img != NULL) {
+    /* add the final length (of code word + data words) to the code word struct: */
+    word_to_write->length = (*ic) - ic_before;
+    code_img[ic_before - IC_INIT_VALUE] = word_to_write; /* avoid "spending" cells of the array, by starting from initial value of ic */
+  }
 
   /* release allocated memory for operands */
   while(operand_count > 0){
@@ -166,4 +288,193 @@ static bool process_code(line_info line, int i, long* ic, machine_word** code_im
     operand_count--;
   }
   return TRUE; /* no errors */
-}
\ No newline at end of file
+}
+
+bool process_lines_fp(fp_line* lines, long line_count, int thread_count, long* IC, long* DC, machine_word** code_img,
+		table* symbol_table, data_image* data, label_ref_list* refs, diagnostics* diag){
+	fp_chunk* chunks;
+	int i, chunk_count;
+	long j, lines_per_chunk, code_size = 0, data_size = 0;
+	bool is_success = TRUE, fits;
+	fp_line* curr;
+
+	chunk_count = (int) (line_count / MIN_CHUNK_LINES);
+	chunk_count = chunk_count < 1 ? 1 : chunk_count > thread_count ? thread_count : chunk_count;
+	chunk_count = chunk_count > MAX_THREADS ? MAX_THREADS : chunk_count;
+	/* a merged string has the address of the same string before it, so the lines are processed in order */
+	chunk_count = data->merge_strings ? 1 : chunk_count;
+	lines_per_chunk = (line_count + chunk_count - 1) / chunk_count;
+
+	chunks = (fp_chunk *) malloc_with_check(chunk_count * sizeof(fp_chunk));
+	for (i = 0; i < chunk_count; i++) {
+		chunks[i].first_line = i * lines_per_chunk;
+		chunks[i].lines = lines + chunks[i].first_line;
+		chunks[i].line_count = chunks[i].first_line + lines_per_chunk < line_count ? lines_per_chunk : line_count - chunks[i].first_line;
+		init_chunk_fp(&chunks[i], DC_INIT_VALUE, code_img != NULL, data, diag);
+	}
+
+	run_in_threads(chunks, chunk_count, sizeof(fp_chunk), process_chunk_fp);
+
+	/* the address of each chunk is the sum of the sizes before it. each chunk checked the words it wrote against it's
+	 * own image, and the words past the image of all the chunks together are reported here - at the same lines
+	 * as if the lines were processed in order */
+	fits = TRUE;
+	for (i = 0; i < chunk_count; i++) {
+		for (j = 0; j < chunks[i].line_count; j++) {
+			curr = &chunks[i].lines[j];
+			if (curr->ic_end > curr->ic && code_size + curr->ic_end - IC_INIT_VALUE > CODE_ARR_IMG_LENGTH) {
+				curr->line.diag = diag;
+				diag->order = chunks[i].first_line + j;
+				print_error(curr->line, IMAGE_SIZE_ERR, "The code image is too large.");
+				fits = FALSE;
+			}
+		}
+		code_size += chunks[i].ic - IC_INIT_VALUE;
+	}
+	is_success = fits;
+	for (i = 0, code_size = 0, data_size = 0; i < chunk_count; i++) {
+		/* the padding of an aligned chunk depends on where it's data starts in a word - if it's not where it was
+		 * processed from, process it again from there. the code words are always aligned. */
+		if (chunks[i].data.alignment > 1 && chunks[i].dc_start - DC_INIT_VALUE != data_size % MAX_DATA_ALIGNMENT) {
+			free_code_image(chunks[i].code_img, chunks[i].ic - IC_INIT_VALUE);
+			free_data_image(&chunks[i].data);
+			free_chunk_fp(&chunks[i]);
+			init_chunk_fp(&chunks[i], DC_INIT_VALUE + data_size % MAX_DATA_ALIGNMENT, code_img != NULL, data, diag);
+			process_chunk_fp(&chunks[i]);
+		}
+		if (!merge_chunk_fp(&chunks[i], code_size, data_size - (chunks[i].dc_start - DC_INIT_VALUE), fits, code_img, symbol_table,
+				data, refs, diag) || !chunks[i].is_success) {
+			is_success = FALSE;
+		}
+		code_size += chunks[i].ic - IC_INIT_VALUE;
+		data_size += chunks[i].dc - chunks[i].dc_start;
+	}
+	sort_diagnostics(diag);
+
+	*IC = IC_INIT_VALUE + (fits ? code_size : 0); /* the words that don't fit aren't merged */
+	*DC = DC_INIT_VALUE + data_size;
+	free(chunks);
+	return is_success;
+}
+
+static void init_chunk_fp(fp_chunk* chunk, long dc, bool with_code, data_image* data, diagnostics* diag){
+	chunk->ic = IC_INIT_VALUE;
+	chunk->dc = chunk->dc_start = dc;
+	chunk->code_img = NULL;
+	if (with_code) {
+		chunk->code_img = (machine_word **) malloc_with_check(CODE_ARR_IMG_LENGTH * sizeof(machine_word *));
+		memset(chunk->code_img, 0, CODE_ARR_IMG_LENGTH * sizeof(machine_word *));
+	}
+	init_data_image(&chunk->data);
+	chunk->data.auto_align = data->auto_align;
+	chunk->data.merge_strings = data->merge_strings;
+	chunk->data.count_only = data->count_only;
+	chunk->symbols = NULL;
+	chunk->refs.refs = NULL;
+	chunk->refs.count = chunk->refs.capacity = 0;
+	init_diagnostics(&chunk->diag, diag->json);
+	chunk->defs = NULL;
+	chunk->def_count = chunk->def_capacity = 0;
+	chunk->is_success = TRUE;
+}
+
+static void free_chunk_fp(fp_chunk* chunk){
+	free(chunk->code_img);
+	free(chunk->defs);
+	free_label_refs(&chunk->refs);
+	free_table(chunk->symbols);
+	free_diagnostics(&chunk->diag);
+}
+
+static void* process_chunk_fp(void* arg){
+	fp_chunk* chunk = (fp_chunk *) arg;
+	char label[MAX_LINE_LENGTH + 2];
+	table_entry* entry;
+	fp_line* curr;
+	bool existed;
+	long i;
+
+	for (i = 0; i < chunk->line_count; i++) {
+		curr = &chunk->lines[i];
+		curr->line.diag = &chunk->diag;
+		chunk->diag.order = chunk->first_line + i;
+		curr->ic = chunk->ic;
+		curr->dc = chunk->dc;
+		get_defined_label(curr->line.content, label);
+		existed = label[0] && find_by_types(chunk->symbols, label, 3, EXTERNAL_SYMBOL, DATA_SYMBOL, CODE_SYMBOL) != NULL;
+
+		if (!process_line_fp(curr->line, &chunk->ic, &chunk->dc, chunk->code_img, &chunk->symbols, &chunk->data, &chunk->refs)) {
+			chunk->is_success = FALSE;
+		}
+		curr->ic_end = chunk->ic;
+		curr->dc_end = chunk->dc;
+
+		/* keep the labels defined by the line, to check them against the other chunks */
+		if (label[0] && !existed && (entry = find_by_types(chunk->symbols, label, 2, DATA_SYMBOL, CODE_SYMBOL)) != NULL) {
+			if (chunk->def_count == chunk->def_capacity) {
+				chunk->def_capacity = chunk->def_capacity == 0 ? 16 : chunk->def_capacity * 2;
+				chunk->defs = (label_def *) realloc_with_check(chunk->defs, chunk->def_capacity * sizeof(label_def));
+			}
+			chunk->defs[chunk->def_count].label = entry->key;
+			chunk->defs[chunk->def_count].value = entry->value;
+			chunk->defs[chunk->def_count].type = entry->type;
+			chunk->defs[chunk->def_count].line_index = chunk->first_line + i;
+			chunk->def_count++;
+		}
+	}
+	return NULL;
+}
+
+static bool merge_chunk_fp(fp_chunk* chunk, long code_base, long data_base, bool with_images, machine_word** code_img,
+		table* symbol_table, data_image* data, label_ref_list* refs, diagnostics* diag){
+	long i;
+	table entry;
+	label_def* def;
+	bool is_success = TRUE;
+
+	/* the labels in source order. a label of the chunks before is defined twice, as if the lines were processed in order */
+	for (i = 0; i < chunk->def_count; i++) {
+		def = &chunk->defs[i];
+		if (find_by_types(*symbol_table, def->label, 3, EXTERNAL_SYMBOL, DATA_SYMBOL, CODE_SYMBOL) != NULL) {
+			/* the line isn't processed at all then, so it has no other errors */
+			drop_line_diagnostics(&chunk->diag, def->line_index);
+			chunk->diag.order = def->line_index;
+			print_error(chunk->lines[def->line_index - chunk->first_line].line, SYMBOL_REDEFINED_ERR, "Symbol %s is already defined.", def->label);
+			is_success = FALSE;
+			continue;
+		}
+		add_table_item(symbol_table, def->label, def->value + (def->type == CODE_SYMBOL ? code_base : data_base), def->type);
+	}
+	for (entry = chunk->symbols; entry != NULL; entry = entry->next) {
+		if (entry->type == EXTERNAL_SYMBOL) {
+			add_table_item(symbol_table, entry->key, entry->value, EXTERNAL_SYMBOL);
+		}
+	}
+
+	/* the second pass reports to the diagnostics of the file */
+	for (i = 0; i < chunk->refs.count; i++) {
+		label_ref* ref = &chunk->refs.refs[i];
+		ref->line.diag = diag;
+		add_label_ref(refs, ref->is_entry ? ref->ic : ref->ic + code_base, ref->is_entry, ref->label, ref->line);
+	}
+	for (i = 0; i < chunk->line_count; i++) {
+		chunk->lines[i].ic += code_base;
+		chunk->lines[i].ic_end += code_base;
+		chunk->lines[i].dc += data_base;
+		chunk->lines[i].dc_end += data_base;
+	}
+	if (with_images) {
+		if (code_img != NULL) {
+			memcpy(code_img + code_base, chunk->code_img, (chunk->ic - IC_INIT_VALUE) * sizeof(machine_word *));
+		}
+		append_data_image(data, &chunk->data);
+	}
+	else {
+		free_code_image(chunk->code_img, chunk->ic - IC_INIT_VALUE);
+		free_data_image(&chunk->data);
+	}
+	append_diagnostics(diag, &chunk->diag);
+
+	free_chunk_fp(chunk);
+	return is_success;
+}
@@ -4,17 +4,51 @@
 
 #include "globals.h"
 #include "table.h"
+#include "diagnostics.h"
+#include "data_image.h"
+
+/** Minimum lines in the chunk of a thread - smaller files are processed by a single thread */
+#define MIN_CHUNK_LINES 1024
+
+/* A source line read ahead, for the parallel first pass */
+typedef struct fp_line {
+	line_info line; /* with a copy of the content */
+	long ic, ic_end; /* the code counter before and after the line */
+	long dc, dc_end; /* the data counter before and after the line */
+} fp_line;
 
 /**
  * Processes a single line in the first pass
  * @param line The current source line info
  * @param IC A pointer to the current code counter
  * @param DC A pointer to the current data counter
- * @param code_img The code image array
+ * @param code_img The code image array, NULL to only count the code words - for --check
  * @param symbol_table The data symbol table
- * @param data The data image array
+ * @param data The data image
+ * @param refs The labels used by the source, to resolve in the second pass
+ * @return Whether succeeded.
+ */
+bool process_line_fp(line_info line, long* IC, long* DC, machine_word** code_img, table* symbol_table, data_image* data, label_ref_list* refs);
+
+/**
+ * Processes all the lines of a file in the first pass, split into chunks of lines that are processed in parallel.
+ * Each chunk starts from zero counters, with it's own images and symbols. Then the chunks are merged in order:
+ * their addresses are moved by the sizes of the chunks before them, and labels already defined by the chunks
+ * before them are reported as defined twice. A chunk that aligns it's data is processed again if it's data starts at
+ * another place in a word than it was processed from. The diagnostics are kept in the source order.
+ * @param lines The lines, updated with their final counters
+ * @param line_count The lines count
+ * @param thread_count The maximum threads to use
+ * @param IC A pointer to the current code counter
+ * @param DC A pointer to the current data counter
+ * @param code_img The code image array, NULL to only count the code words - for --check
+ * @param symbol_table The symbol table
+ * @param data The data image
+ * @param refs The labels used by the source, to resolve in the second pass
+ * @param diag The diagnostics of the file
  * @return Whether succeeded.
  */
-bool process_line_fp(line_info line, long* IC, long* DC, machine_word** code_img, table* symbol_table, data_word** data);
+bool process_lines_fp(fp_line* lines, long line_count, int thread_count, long* IC, long* DC, machine_word** code_img,
+		table* symbol_table, data_image* data, label_ref_list* refs, diagnostics* diag);
 
 #endif
\ No newline at end of file
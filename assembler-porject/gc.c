@@ -0,0 +1,268 @@
+/* Implements the removal of the unreached code regions and data blocks */
+#include <stdlib.h>
+#include <string.h>
+#include "gc.h"
+#include "optimize.h"
+#include "utils.h"
+
+/* The blocks of an image: each one starts at a label, or at the start of the image, and ends at the next one */
+typedef struct gc_blocks {
+	long* starts; /* sorted, without repeats */
+	long count;
+	long end; /* the end of the image */
+	bool* reached;
+} gc_blocks;
+
+/**
+ * Splits an image into blocks by the labels of a type. The block before the first label, if any, is reached,
+ * as there's no label to reach it.
+ * @param symbol_table The symbol table
+ * @param type The type of the labels
+ * @param start The start of the image
+ * @param end The end of the image
+ * @param blocks The destination blocks
+ */
+static void build_blocks(table symbol_table, symbol_type type, long start, long end, gc_blocks* blocks);
+
+/**
+ * Finds the block that contains an address, by binary search
+ * @param blocks The blocks
+ * @param address The address
+ * @return The index of the block
+ */
+static long find_block(gc_blocks* blocks, long address);
+
+/**
+ * Marks the block of a label as reached. A code region that's reached for the first time is pushed, to reach
+ * the labels it uses.
+ * @param index The code and data symbols, by name
+ * @param label The label
+ * @param code The code regions
+ * @param data The data blocks
+ * @param stack The code regions to visit
+ * @param stack_count The count of the code regions to visit
+ */
+static void reach_label(table_index* index, char* label, gc_blocks* code, gc_blocks* data, long* stack, long* stack_count);
+
+/**
+ * Returns the new address of a data byte, after removing the data ranges before it
+ * @param dc The address, relative to the data image
+ * @param ranges The removed ranges, as pairs of the first byte and the byte after the last one
+ * @param removed_before The removed bytes count before each range
+ * @param count The ranges count
+ * @return The new address. an address inside a removed range moves to the end of it
+ */
+static long move_data_address(long dc, long* ranges, long* removed_before, long count);
+
+/**
+ * Compares two addresses, for sorting
+ * @param first The first address
+ * @param second The second address
+ * @return Negative, zero or positive, as the first address is before, equal or after the second
+ */
+static int compare_addresses(const void* first, const void* second);
+
+void collect_garbage(machine_word** code_img, long* icf, long* dcf, table symbol_table, label_ref_list* refs, data_image* data,
+		listing* lst){
+	gc_blocks code, data_blocks;
+	table_index index;
+	label_ref** word_refs;
+	bool* removed;
+	long *stack, *ranges, *removed_before;
+	long i, block, address, end, word_count = (*icf - IC_INIT_VALUE) / 4, stack_count = 0, range_count = 0;
+	bool has_removed = FALSE;
+	code_word* last_word;
+	table entry;
+
+	build_blocks(symbol_table, CODE_SYMBOL, IC_INIT_VALUE, *icf, &code);
+	build_blocks(symbol_table, DATA_SYMBOL, DC_INIT_VALUE, *dcf, &data_blocks);
+	build_table_index(symbol_table, &index, 2, CODE_SYMBOL, DATA_SYMBOL);
+	stack = (long *) malloc_with_check((code.count + 1) * sizeof(long));
+
+	/* index the label operands by their code word */
+	word_refs = (label_ref **) malloc_with_check((word_count + 1) * sizeof(label_ref *));
+	for (i = 0; i < word_count; i++) {
+		word_refs[i] = NULL;
+	}
+	for (i = 0; i < refs->count; i++) {
+		if (!refs->refs[i].is_entry) {
+			word_refs[(refs->refs[i].ic - IC_INIT_VALUE) / 4] = &refs->refs[i];
+		}
+	}
+
+	/* from the program start and the entries, through the labels used by the reached code */
+	code.reached[0] = TRUE;
+	stack[stack_count++] = 0;
+	for (i = 0; i < refs->count; i++) {
+		if (refs->refs[i].is_entry) {
+			reach_label(&index, refs->refs[i].label, &code, &data_blocks, stack, &stack_count);
+		}
+	}
+	while (stack_count > 0) {
+		block = stack[--stack_count];
+		end = block + 1 < code.count ? code.starts[block + 1] : code.end;
+		for (address = code.starts[block]; address < end; address += 4) {
+			if (word_refs[(address - IC_INIT_VALUE) / 4] != NULL) {
+				reach_label(&index, word_refs[(address - IC_INIT_VALUE) / 4]->label, &code, &data_blocks, stack, &stack_count);
+			}
+		}
+		/* the next region is reached by fall-through, unless the last instruction never continues to it */
+		last_word = end > code.starts[block] ? code_img[end - 4 - IC_INIT_VALUE]->word.code : NULL;
+		if (block + 1 < code.count && !code.reached[block + 1] &&
+		    (last_word == NULL || (last_word->opcode != JMP_OP && last_word->opcode != STOP_OP))) {
+			code.reached[block + 1] = TRUE;
+			stack[stack_count++] = block + 1;
+		}
+	}
+
+	/* remove the code words of the regions that weren't reached */
+	removed = (bool *) malloc_with_check((word_count + 1) * sizeof(bool));
+	for (i = 0; i < word_count; i++) {
+		removed[i] = !code.reached[find_block(&code, IC_INIT_VALUE + i * 4)];
+		has_removed = has_removed || removed[i];
+	}
+	if (has_removed) {
+		remove_code_words(code_img, icf, symbol_table, refs, lst, removed, GC_REMOVAL);
+	}
+
+	/* the data blocks that weren't reached, joined when they're next to each other. each range keeps the bytes
+	 * beyond a multiple of the alignment, so the data after it stays aligned */
+	ranges = (long *) malloc_with_check((2 * data_blocks.count + 1) * sizeof(long));
+	removed_before = (long *) malloc_with_check((data_blocks.count + 1) * sizeof(long));
+	for (i = 0; i < data_blocks.count; i++) {
+		end = i + 1 < data_blocks.count ? data_blocks.starts[i + 1] : data_blocks.end;
+		if (data_blocks.reached[i] || end == data_blocks.starts[i]) {
+			continue;
+		}
+		if (range_count > 0 && ranges[2 * range_count - 1] == data_blocks.starts[i]) {
+			ranges[2 * range_count - 1] = end;
+		}
+		else {
+			ranges[2 * range_count] = data_blocks.starts[i];
+			ranges[2 * range_count + 1] = end;
+			range_count++;
+		}
+	}
+	for (i = 0, address = 0; i < range_count; i++) {
+		ranges[2 * i + 1] -= (ranges[2 * i + 1] - ranges[2 * i]) % data->alignment;
+		removed_before[i] = address;
+		address += ranges[2 * i + 1] - ranges[2 * i];
+	}
+	if (address > 0) {
+		remove_data_ranges(data, ranges, range_count);
+		*dcf -= address;
+		for (entry = symbol_table; entry != NULL; entry = entry->next) {
+			if (entry->type == DATA_SYMBOL) {
+				entry->value = move_data_address(entry->value, ranges, removed_before, range_count);
+			}
+		}
+		for (i = 0; lst != NULL && i < lst->count; i++) {
+			if (lst->lines[i].dc_end > lst->lines[i].dc) {
+				lst->lines[i].dc = move_data_address(lst->lines[i].dc, ranges, removed_before, range_count);
+				lst->lines[i].dc_end = move_data_address(lst->lines[i].dc_end, ranges, removed_before, range_count);
+				lst->lines[i].removed = lst->lines[i].dc_end == lst->lines[i].dc ? GC_REMOVAL : NOT_REMOVED;
+			}
+			else {
+				lst->lines[i].dc = lst->lines[i].dc_end = move_data_address(lst->lines[i].dc, ranges, removed_before, range_count);
+			}
+		}
+	}
+
+	free(ranges);
+	free(removed_before);
+	free(removed);
+	free(word_refs);
+	free(stack);
+	free_table_index(&index);
+	free(code.starts);
+	free(code.reached);
+	free(data_blocks.starts);
+	free(data_blocks.reached);
+}
+
+static void build_blocks(table symbol_table, symbol_type type, long start, long end, gc_blocks* blocks){
+	table entry;
+	long i, j, count = 0;
+
+	for (entry = symbol_table; entry != NULL; entry = entry->next) {
+		count += entry->type == type;
+	}
+	blocks->starts = (long *) malloc_with_check((count + 1) * sizeof(long));
+	blocks->starts[0] = start;
+	for (entry = symbol_table, i = 1; entry != NULL; entry = entry->next) {
+		if (entry->type == type) {
+			blocks->starts[i++] = entry->value;
+		}
+	}
+	qsort(blocks->starts, count + 1, sizeof(long), compare_addresses);
+	for (i = 1, j = 1; i <= count; i++) {
+		if (blocks->starts[i] != blocks->starts[j - 1]) {
+			blocks->starts[j++] = blocks->starts[i];
+		}
+	}
+	blocks->count = j;
+	blocks->end = end;
+	blocks->reached = (bool *) malloc_with_check(blocks->count * sizeof(bool));
+	for (i = 0; i < blocks->count; i++) {
+		blocks->reached[i] = FALSE;
+	}
+	/* no label starts the first block */
+	for (entry = symbol_table; entry != NULL && (entry->type != type || entry->value != start); entry = entry->next)
+		;
+	blocks->reached[0] = entry == NULL;
+}
+
+static long find_block(gc_blocks* blocks, long address){
+	long low = 0, high = blocks->count, middle;
+	/* the last block that starts at or before the address */
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (blocks->starts[middle] <= address) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low > 0 ? low - 1 : 0;
+}
+
+static void reach_label(table_index* index, char* label, gc_blocks* code, gc_blocks* data, long* stack, long* stack_count){
+	table_entry* entry = find_in_index(index, label);
+	long block;
+
+	if (entry == NULL) {
+		return; /* external or undefined, reported by the second pass */
+	}
+	if (entry->type == DATA_SYMBOL) {
+		data->reached[find_block(data, entry->value)] = TRUE;
+	}
+	else if (!code->reached[block = find_block(code, entry->value)]) {
+		code->reached[block] = TRUE;
+		stack[(*stack_count)++] = block;
+	}
+}
+
+static long move_data_address(long dc, long* ranges, long* removed_before, long count){
+	long low = 0, high = count, middle;
+	/* the last range that starts at or before the address */
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (ranges[2 * middle] <= dc) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	if (low == 0) {
+		return dc;
+	}
+	low--;
+	return dc - removed_before[low] - ((dc < ranges[2 * low + 1] ? dc : ranges[2 * low + 1]) - ranges[2 * low]);
+}
+
+static int compare_addresses(const void* first, const void* second){
+	long a = *(long *) first, b = *(long *) second;
+	return a < b ? -1 : a > b;
+}
@@ -0,0 +1,28 @@
+/* Removal of the code and the data that the program never reaches, between the first and the second pass */
+#ifndef _GC_H
+#define _GC_H
+
+#include "globals.h"
+#include "table.h"
+#include "listing.h"
+#include "data_image.h"
+
+/**
+ * Removes the code regions and the data blocks that are never referenced. A code region starts at a code label
+ * (or the program start) and ends at the next one, and a data block starts at a data label and ends at the next one.
+ * The program start and the .entry labels are reached, and so is every label used by a reached code region,
+ * and the region after a reached region that doesn't end with a jmp or a stop - it falls through to it.
+ * The data before the first data label has no label to reach it, so it's kept.
+ * The remaining symbols, label references and listed lines are moved to their new addresses.
+ * @param code_img The code image
+ * @param icf A pointer to the final code counter, updated by the removed code
+ * @param dcf A pointer to the final data counter, updated by the removed data
+ * @param symbol_table The symbol table, where the data symbols are still relative to the data image
+ * @param refs The label references collected by the first pass
+ * @param data The data image
+ * @param lst The listing, whose addresses are moved too, NULL if no listing
+ */
+void collect_garbage(machine_word** code_img, long* icf, long* dcf, table symbol_table, label_ref_list* refs, data_image* data,
+		listing* lst);
+
+#endif
@@ -17,13 +17,19 @@ typedef enum booleans {
 /** Maximum length of label */
 #define MAX_LABEL_LENGTH 31
 
-/** Maximum files to process */
+/** Maximum files to process, unless given by --max-files */
 #define MAX_FILES_TO_PROCESS 3
 
+/** The file name that reads the source from the standard input */
+#define STDIN_FILE_NAME "-"
+
 /** Initial IC and DC value */
 #define IC_INIT_VALUE 100
 #define DC_INIT_VALUE 0
 
+/** Largest alignment of the data counter - a word. The data image follows the code words, so it's aligned to it too */
+#define MAX_DATA_ALIGNMENT 4
+
 #define NONE_REG -3
 
 #define BYTE 8
@@ -107,6 +113,10 @@ typedef enum instruction {
 	EXTERN_INST,
 	ENTRY_INST,
 	ASCIZ_INST,
+	SPACE_INST,
+	FILL_INST,
+	INCBIN_INST,
+	ALIGN_INST,
 
 	/* Not found */
 	NONE_INST,
@@ -150,6 +160,13 @@ typedef struct code_word {
 } code_word;
 
 
+/* The result of parsing a numeric literal */
+typedef enum number_status {
+	NUMBER_OK = 0,
+	NUMBER_SYNTAX_ERROR,
+	NUMBER_RANGE_ERROR
+} number_status;
+
 /* Represents a single data word. */
 typedef struct data_word {
 	instruction ins;
@@ -168,12 +185,91 @@ typedef struct machine_word {
 	} word;
 } machine_word;
 
+/* Error codes of the diagnostics, grouped by the stage that reports them */
+typedef enum error_code {
+	/* Reading the source - macros & includes */
+	LINE_TOO_LONG_ERR = 100,
+	MACRO_ERR = 101,
+	INCLUDE_ERR = 102,
+
+	/* Labels & symbols */
+	LABEL_NAME_ERR = 200,
+	SYMBOL_REDEFINED_ERR = 201,
+	ENTRY_ERR = 202,
+	UNDEFINED_SYMBOL_ERR = 203,
+
+	/* Commands */
+	UNKNOWN_COMMAND_ERR = 300,
+	OPERAND_SYNTAX_ERR = 301,
+	OPERAND_COUNT_ERR = 302,
+	OPERAND_TYPE_ERR = 303,
+	OPERAND_RANGE_ERR = 304,
+
+	/* Instructions */
+	UNKNOWN_INSTRUCTION_ERR = 400,
+	STRING_SYNTAX_ERR = 401,
+	DATA_SYNTAX_ERR = 402,
+	DATA_RANGE_ERR = 403,
+
+	/* Processing limits */
+	TOO_MANY_ERRORS_ERR = 900,
+	IMAGE_SIZE_ERR = 901
+} error_code;
+
 /* Represents a single source line, including it's details */
 typedef struct line_info {	
 	long line_number; /* Line number in file */
 	char* file_name;
 	char* content; /* Line content (source) */
+	struct diagnostics* diag; /* where the errors of the line are collected, NULL to print them right away */
 } line_info;
 
+/* Represents a label used by a source line, that is resolved in the second pass */
+typedef struct label_ref {
+	long ic; /* address of the code word that uses the label as operand */
+	bool is_entry; /* whether it's the label of an .entry instruction (and not an operand) */
+	char* label;
+	line_info line; /* the source line, for error messages. it's content isn't kept */
+} label_ref;
+
+/* The labels used by the source, in source order */
+typedef struct label_ref_list {
+	label_ref* refs;
+	long count;
+	long capacity;
+} label_ref_list;
+
+/* The formats of the external references (.ext) */
+typedef enum table_format {
+	/* a line of the symbol name and the address, for each reference */
+	TABLE_LINES = 0,
+	/* a line for each symbol name, with the sorted addresses of it's references */
+	TABLE_GROUPED,
+	/* grouped, and each address after the first one is the distance from the address before it, as +N */
+	TABLE_GROUPED_DELTA
+} table_format;
+
+/* The command line options, applied to all the processed files */
+typedef struct assembler_options {
+	bool optimize; /* run the peephole optimizer after the first pass */
+	bool listing; /* write a .lst file too */
+	bool json_errors; /* print the diagnostics as JSON lines */
+	long max_errors; /* stop processing a file after that many errors, 0 for no limit */
+	long max_files; /* the most files processed by a single run, 0 for no limit */
+	int jobs; /* threads for the first pass of a single file, 1 to process it's lines in order */
+	int ob_fd; /* where the object of the standard input ("-") is written, -1 for the standard output */
+	int ent_fd; /* where it's entries are written, -1 for none */
+	int ext_fd; /* where it's externals are written, -1 for none */
+	bool sections; /* append the entries and the externals of the standard input to it's object, as sections */
+	bool align_data; /* align .dh and .dw to their size */
+	bool merge_strings; /* store the same .asciz strings, and the strings that end others, once */
+	bool gc; /* remove the code and the data that the program never reaches */
+	bool relocations; /* write the relocations (.rel) too, to load the object at another address */
+	bool debug_map; /* write the address to source line map (.dbg) too */
+	table_format ext_format; /* the format of the external references */
+	bool check; /* only report the diagnostics of the files, checked in parallel, without the images and the outputs */
+	bool incremental; /* assemble a single file again after each edit read from the standard input */
+} assembler_options;
+
 
 #endif
\ No newline at end of file
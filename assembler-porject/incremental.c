@@ -0,0 +1,403 @@
+/* Implements the incremental assembly of an edited source */
+#include <stdlib.h>
+#include <string.h>
+#include "incremental.h"
+#include "first_pass.h"
+#include "data_image.h"
+#include "table.h"
+#include "utils.h"
+
+/** The code words of a single line - a line encodes one word at most */
+#define LINE_CODE_LENGTH 4
+
+/**
+ * Processes a line alone in the first pass, from zero counters, and keeps it's result
+ * @param ses The session
+ * @param line The line
+ * @param dc_start The place in a word to process the data of the line from
+ */
+static void process_session_line(session* ses, session_line* line, long dc_start);
+
+/**
+ * Deallocates the result of processing a line, and removes it from the symbols it uses
+ * @param ses The session
+ * @param line The line
+ */
+static void clear_session_line(session* ses, session_line* line);
+
+/**
+ * Finds a symbol of a session by it's name, and adds it if it's not found
+ * @param ses The session
+ * @param name The name
+ * @return The symbol
+ */
+static session_symbol* get_session_symbol(session* ses, char* name);
+
+/**
+ * Removes a symbol from a session, if no line uses it
+ * @param ses The session
+ * @param symbol The symbol
+ */
+static void release_session_symbol(session* ses, session_symbol* symbol);
+
+/**
+ * Adds a line to a lines array
+ * @param lines The array
+ * @param count The count of the lines
+ * @param capacity The capacity of the array
+ * @param line The line
+ */
+static void add_symbol_line(session_line*** lines, long* count, long* capacity, session_line* line);
+
+/**
+ * Removes a line from a lines array
+ * @param lines The array
+ * @param count The count of the lines
+ * @param line The line
+ */
+static void remove_symbol_line(session_line** lines, long* count, session_line* line);
+
+/**
+ * Marks a symbol to be resolved again
+ * @param ses The session
+ * @param symbol The symbol
+ */
+static void mark_symbol_changed(session* ses, session_symbol* symbol);
+
+/**
+ * Resolves a symbol: the first line that defines it is it's definer, unless a line before declares it as external
+ * - as the first pass reports a label that's already defined, or external
+ * @param symbol The symbol
+ */
+static void resolve_session_symbol(session_symbol* symbol);
+
+void init_session(session* ses, char* file_name, bool auto_align, bool json){
+	memset(ses, 0, sizeof(session));
+	ses->file_name = file_name;
+	ses->auto_align = auto_align;
+	ses->json = json;
+	ses->bucket_count = 64;
+	ses->buckets = (session_symbol **) malloc_with_check(ses->bucket_count * sizeof(session_symbol *));
+	memset(ses->buckets, 0, ses->bucket_count * sizeof(session_symbol *));
+}
+
+void edit_session(session* ses, long first, long removed_count, char** lines, long added_count){
+	long i, data_size = 0;
+	session_line* line;
+
+	for (i = first; i < first + removed_count; i++) {
+		clear_session_line(ses, ses->lines[i]);
+		free(ses->lines[i]->content);
+		free(ses->lines[i]);
+	}
+	/* only the pointers of the lines after them are moved */
+	if (ses->line_count - removed_count + added_count > ses->line_capacity) {
+		ses->line_capacity = ses->line_capacity == 0 ? 64 : ses->line_capacity;
+		while (ses->line_count - removed_count + added_count > ses->line_capacity) {
+			ses->line_capacity *= 2;
+		}
+		ses->lines = (session_line **) realloc_with_check(ses->lines, ses->line_capacity * sizeof(session_line *));
+	}
+	memmove(ses->lines + first + added_count, ses->lines + first + removed_count,
+			(ses->line_count - first - removed_count) * sizeof(session_line *));
+	ses->line_count += added_count - removed_count;
+	for (i = first + added_count; i < ses->line_count; i++) {
+		ses->lines[i]->index = i;
+	}
+
+	for (i = first; i < first + added_count; i++) {
+		line = (session_line *) malloc_with_check(sizeof(session_line));
+		memset(line, 0, sizeof(session_line));
+		line->content = copy_string(lines[i - first]);
+		line->index = i;
+		ses->lines[i] = line;
+		process_session_line(ses, line, 0);
+	}
+
+	/* the padding of the aligned lines depends on the data before them, that may have changed */
+	for (i = 0; ses->aligned_count > 0 && i < ses->line_count; i++) {
+		line = ses->lines[i];
+		if (line->is_aligned && line->dc_start != data_size % MAX_DATA_ALIGNMENT) {
+			clear_session_line(ses, line);
+			process_session_line(ses, line, data_size % MAX_DATA_ALIGNMENT);
+		}
+		data_size += line->data_size;
+	}
+}
+
+bool get_session_diagnostics(session* ses, diagnostics* diag){
+	long i, j, code_size = 0;
+	bool is_success = TRUE;
+	session_line* line;
+	session_symbol* symbol;
+	line_info info;
+
+	for (i = 0; i < ses->changed_count; i++) {
+		resolve_session_symbol(ses->changed[i]);
+	}
+	ses->changed_count = 0;
+	info.file_name = ses->file_name;
+	info.diag = diag;
+
+	/* the first pass diagnostics, as the lines were processed in order */
+	for (i = 0; i < ses->line_count; i++) {
+		line = ses->lines[i];
+		info.line_number = i + 1;
+		info.content = line->content;
+		diag->order = i;
+		/* a label that's already defined stops the line */
+		if (line->label_symbol != NULL && line->label_symbol->definer != line) {
+			print_error(info, SYMBOL_REDEFINED_ERR, "Symbol %s is already defined.", line->label);
+			is_success = FALSE;
+			continue;
+		}
+		copy_diagnostics(diag, &line->diag, info.line_number);
+		is_success = is_success && line->is_success;
+		code_size += line->code_size;
+	}
+	if (code_size > CODE_ARR_IMG_LENGTH) {
+		diag->order = ses->line_count;
+		print_error(info, IMAGE_SIZE_ERR, "The code image is too large.");
+		is_success = FALSE;
+	}
+	if (!is_success) {
+		return FALSE;
+	}
+
+	/* the second pass, by the resolved symbols */
+	ses->round++;
+	for (i = 0; i < ses->line_count; i++) {
+		line = ses->lines[i];
+		info.line_number = i + 1;
+		info.content = line->content;
+		diag->order = i;
+		for (j = 0; j < line->refs.count; j++) {
+			symbol = line->ref_symbols[j];
+			if (!line->refs.refs[j].is_entry) {
+				if (symbol->definer == NULL && !symbol->is_external) {
+					print_error(info, UNDEFINED_SYMBOL_ERR, "The symbol %s not found", symbol->name);
+					is_success = FALSE;
+				}
+			}
+			else if (symbol->name[0] == '\0') {
+				print_error(info, ENTRY_ERR, "You have to specify a label name for .entry instruction.");
+				is_success = FALSE;
+			}
+			else if (symbol->entry_round == ses->round) {
+				continue; /* already an entry */
+			}
+			else if (symbol->definer == NULL && symbol->is_external) {
+				print_error(info, ENTRY_ERR, "The symbol %s can be either external or entry, but not both.", symbol->name);
+				is_success = FALSE;
+			}
+			else if (symbol->definer == NULL) {
+				print_error(info, ENTRY_ERR, "The symbol %s for .entry is undefined.", symbol->name);
+				is_success = FALSE;
+			}
+			else {
+				symbol->entry_round = ses->round;
+			}
+		}
+	}
+	return is_success;
+}
+
+void free_session(session* ses){
+	long i;
+	for (i = 0; i < ses->line_count; i++) {
+		clear_session_line(ses, ses->lines[i]);
+		free(ses->lines[i]->content);
+		free(ses->lines[i]);
+	}
+	free(ses->lines);
+	free(ses->buckets); /* the symbols are released with their last line */
+	free(ses->changed);
+	memset(ses, 0, sizeof(session));
+}
+
+static void process_session_line(session* ses, session_line* line, long dc_start){
+	machine_word* code_img[LINE_CODE_LENGTH] = {NULL};
+	long ic = IC_INIT_VALUE, dc = DC_INIT_VALUE + dc_start, i;
+	table symbols = NULL, entry;
+	data_image data;
+	line_info info;
+
+	info.line_number = line->index + 1;
+	info.file_name = ses->file_name;
+	info.content = line->content;
+	info.diag = &line->diag;
+	init_diagnostics(&line->diag, ses->json);
+	init_data_image(&data);
+	data.auto_align = ses->auto_align;
+
+	line->is_success = process_line_fp(info, &ic, &dc, code_img, &symbols, &data, &line->refs);
+	line->code_size = ic - IC_INIT_VALUE;
+	line->data_size = dc - DC_INIT_VALUE - dc_start;
+	line->dc_start = dc_start;
+	line->is_aligned = data.alignment > 1;
+	ses->aligned_count += line->is_aligned;
+
+	/* only the names are kept - the addresses are the sizes of the lines before */
+	for (entry = symbols; entry != NULL; entry = entry->next) {
+		if (entry->type == EXTERNAL_SYMBOL && line->external == NULL) {
+			line->external = copy_string(entry->key);
+			line->external_symbol = get_session_symbol(ses, line->external);
+			add_symbol_line(&line->external_symbol->externals, &line->external_symbol->external_count,
+					&line->external_symbol->external_capacity, line);
+			mark_symbol_changed(ses, line->external_symbol);
+		}
+		else if ((entry->type == CODE_SYMBOL || entry->type == DATA_SYMBOL) && line->label == NULL) {
+			line->label = copy_string(entry->key);
+			line->label_symbol = get_session_symbol(ses, line->label);
+			add_symbol_line(&line->label_symbol->defs, &line->label_symbol->def_count, &line->label_symbol->def_capacity, line);
+			mark_symbol_changed(ses, line->label_symbol);
+		}
+	}
+	line->ref_symbols = (session_symbol **) malloc_with_check((line->refs.count + 1) * sizeof(session_symbol *));
+	for (i = 0; i < line->refs.count; i++) {
+		line->ref_symbols[i] = get_session_symbol(ses, line->refs.refs[i].label);
+		line->ref_symbols[i]->use_count++;
+	}
+
+	free_code_image(code_img, line->code_size);
+	free_data_image(&data);
+	free_table(symbols);
+}
+
+static void clear_session_line(session* ses, session_line* line){
+	long i;
+
+	if (line->label_symbol != NULL) {
+		remove_symbol_line(line->label_symbol->defs, &line->label_symbol->def_count, line);
+		mark_symbol_changed(ses, line->label_symbol);
+		release_session_symbol(ses, line->label_symbol);
+	}
+	if (line->external_symbol != NULL) {
+		remove_symbol_line(line->external_symbol->externals, &line->external_symbol->external_count, line);
+		mark_symbol_changed(ses, line->external_symbol);
+		release_session_symbol(ses, line->external_symbol);
+	}
+	for (i = 0; i < line->refs.count; i++) {
+		line->ref_symbols[i]->use_count--;
+		release_session_symbol(ses, line->ref_symbols[i]);
+	}
+	ses->aligned_count -= line->is_aligned;
+	free(line->label);
+	free(line->external);
+	free(line->ref_symbols);
+	free_label_refs(&line->refs);
+	free_diagnostics(&line->diag);
+	line->label = line->external = NULL;
+	line->label_symbol = line->external_symbol = NULL;
+	line->ref_symbols = NULL;
+	line->is_aligned = FALSE;
+}
+
+static session_symbol* get_session_symbol(session* ses, char* name){
+	unsigned long hash = hash_string(name);
+	session_symbol *symbol, *next, **new_buckets;
+	long i, new_count;
+
+	for (symbol = ses->buckets[hash % ses->bucket_count]; symbol != NULL; symbol = symbol->next) {
+		if (symbol->hash == hash && strcmp(symbol->name, name) == 0) {
+			return symbol;
+		}
+	}
+	/* the buckets are doubled when they're full, so the chains stay short */
+	if (ses->symbol_count == ses->bucket_count) {
+		new_count = ses->bucket_count * 2;
+		new_buckets = (session_symbol **) malloc_with_check(new_count * sizeof(session_symbol *));
+		memset(new_buckets, 0, new_count * sizeof(session_symbol *));
+		for (i = 0; i < ses->bucket_count; i++) {
+			for (symbol = ses->buckets[i]; symbol != NULL; symbol = next) {
+				next = symbol->next;
+				symbol->next = new_buckets[symbol->hash % new_count];
+				new_buckets[symbol->hash % new_count] = symbol;
+			}
+		}
+		free(ses->buckets);
+		ses->buckets = new_buckets;
+		ses->bucket_count = new_count;
+	}
+	symbol = (session_symbol *) malloc_with_check(sizeof(session_symbol));
+	memset(symbol, 0, sizeof(session_symbol));
+	symbol->name = copy_string(name);
+	symbol->hash = hash;
+	symbol->next = ses->buckets[hash % ses->bucket_count];
+	ses->buckets[hash % ses->bucket_count] = symbol;
+	ses->symbol_count++;
+	return symbol;
+}
+
+static void release_session_symbol(session* ses, session_symbol* symbol){
+	session_symbol** link;
+	long i;
+
+	if (symbol->def_count > 0 || symbol->external_count > 0 || symbol->use_count > 0) {
+		return;
+	}
+	for (link = &ses->buckets[symbol->hash % ses->bucket_count]; *link != symbol; link = &(*link)->next)
+		;
+	*link = symbol->next;
+	ses->symbol_count--;
+	/* it's not resolved anymore */
+	for (i = 0; i < ses->changed_count; i++) {
+		if (ses->changed[i] == symbol) {
+			ses->changed[i] = ses->changed[--ses->changed_count];
+			break;
+		}
+	}
+	free(symbol->name);
+	free(symbol->defs);
+	free(symbol->externals);
+	free(symbol);
+}
+
+static void add_symbol_line(session_line*** lines, long* count, long* capacity, session_line* line){
+	if (*count == *capacity) {
+		*capacity = *capacity == 0 ? 4 : *capacity * 2;
+		*lines = (session_line **) realloc_with_check(*lines, *capacity * sizeof(session_line *));
+	}
+	(*lines)[(*count)++] = line;
+}
+
+static void remove_symbol_line(session_line** lines, long* count, session_line* line){
+	long i;
+	for (i = 0; i < *count; i++) {
+		if (lines[i] == line) {
+			lines[i] = lines[--(*count)];
+			return;
+		}
+	}
+}
+
+static void mark_symbol_changed(session* ses, session_symbol* symbol){
+	if (symbol->is_changed) {
+		return;
+	}
+	symbol->is_changed = TRUE;
+	if (ses->changed_count == ses->changed_capacity) {
+		ses->changed_capacity = ses->changed_capacity == 0 ? 16 : ses->changed_capacity * 2;
+		ses->changed = (session_symbol **) realloc_with_check(ses->changed, ses->changed_capacity * sizeof(session_symbol *));
+	}
+	ses->changed[ses->changed_count++] = symbol;
+}
+
+static void resolve_session_symbol(session_symbol* symbol){
+	session_line *first_def = NULL, *first_external = NULL;
+	long i;
+
+	for (i = 0; i < symbol->def_count; i++) {
+		if (first_def == NULL || symbol->defs[i]->index < first_def->index) {
+			first_def = symbol->defs[i];
+		}
+	}
+	for (i = 0; i < symbol->external_count; i++) {
+		if (first_external == NULL || symbol->externals[i]->index < first_external->index) {
+			first_external = symbol->externals[i];
+		}
+	}
+	symbol->definer = first_external != NULL && first_def != NULL && first_external->index < first_def->index ? NULL : first_def;
+	symbol->is_external = first_external != NULL;
+	symbol->is_changed = FALSE;
+}
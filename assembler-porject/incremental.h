@@ -0,0 +1,95 @@
+/* Incremental assembly of an edited source - each line keeps it's first pass result, so an edit processes only the
+ * changed lines, and resolves only the symbols they define or declare */
+#ifndef _INCREMENTAL_H
+#define _INCREMENTAL_H
+
+#include "globals.h"
+#include "diagnostics.h"
+
+/* A line of a session, with the first pass result of processing it alone, from zero counters */
+typedef struct session_line {
+	char* content; /* a copy */
+	long index; /* the place of the line in the session */
+	long code_size, data_size; /* how much the line adds to the counters */
+	long dc_start; /* the place in a word the data of the line was processed from */
+	bool is_aligned; /* whether the padding of the line depends on where it's data starts */
+	bool is_success;
+	char* label; /* the code or data label defined by the line, NULL if none */
+	char* external; /* the symbol declared by the line as external, NULL if none */
+	struct session_symbol* label_symbol;
+	struct session_symbol* external_symbol;
+	label_ref_list refs; /* the labels used by the line, with the code addresses from the line start */
+	struct session_symbol** ref_symbols; /* the symbol of each label used by the line */
+	diagnostics diag; /* the first pass diagnostics of the line */
+} session_line;
+
+/* A name used by the lines of a session, and it's resolution */
+typedef struct session_symbol {
+	char* name;
+	unsigned long hash;
+	struct session_symbol* next; /* in the same bucket */
+	session_line** defs; /* the lines that define the name as a label, in no order */
+	long def_count, def_capacity;
+	session_line** externals; /* the lines that declare the name as external, in no order */
+	long external_count, external_capacity;
+	long use_count; /* the label operands and the .entry labels of the name */
+	session_line* definer; /* the line that defines the name - the later definitions are errors. NULL if none */
+	bool is_external; /* whether it's declared as external */
+	bool is_changed; /* whether it's definitions changed since it was resolved */
+	long entry_round; /* the last diagnostics round where it was an entry */
+} session_symbol;
+
+/* An edited source, kept between it's edits */
+typedef struct session {
+	char* file_name; /* not a copy */
+	session_line** lines;
+	long line_count, line_capacity;
+	session_symbol** buckets;
+	long bucket_count, symbol_count;
+	session_symbol** changed; /* the symbols to resolve again */
+	long changed_count, changed_capacity;
+	long aligned_count; /* the lines whose padding depends on where their data starts */
+	bool auto_align; /* align .dh and .dw to their size */
+	bool json; /* print the diagnostics as JSON lines */
+	long round; /* the count of the diagnostics rounds */
+} session;
+
+/**
+ * Initializes an empty session.
+ * The lines are the lines the first pass sees, after macro expansion - the lines of the source, if it has no macros
+ * and includes. The strings are not merged, since the diagnostics don't depend on it.
+ * @param ses The session
+ * @param file_name The source name, for the diagnostics
+ * @param auto_align Whether .dh and .dw are aligned to their size
+ * @param json Whether the diagnostics are printed as JSON lines
+ */
+void init_session(session* ses, char* file_name, bool auto_align, bool json);
+
+/**
+ * Replaces lines of a session, and processes only the new lines. The lines after them are moved, with their labels,
+ * by the change of the counters. A line whose padding depends on where it's data starts is processed again
+ * if that changes.
+ * @param ses The session
+ * @param first The index of the first replaced line
+ * @param removed_count The count of the replaced lines
+ * @param lines The new lines
+ * @param added_count The count of the new lines
+ */
+void edit_session(session* ses, long first, long removed_count, char** lines, long added_count);
+
+/**
+ * Collects the diagnostics of a session, as the whole source was assembled: the first pass diagnostics of the lines,
+ * and if there are no errors, the unresolved labels. Only the symbols changed by the edits are resolved again.
+ * @param ses The session
+ * @param diag The diagnostics buffer, to add the diagnostics to
+ * @return Whether the source has no errors
+ */
+bool get_session_diagnostics(session* ses, diagnostics* diag);
+
+/**
+ * Deallocates all the memory required by a session
+ * @param ses The session
+ */
+void free_session(session* ses);
+
+#endif
@@ -0,0 +1,15 @@
+; Numeric literals: decimal, hex (0x), binary (0b) and character ('c') values
+.entry MASK
+.extern TABLE
+MAIN: addi $1,0x7FFF,$2
+	subi $3,-0x8000,$4
+	andi $5,0b1010,$6
+	ori $7,'A',$8
+	nori $9,0XFFFF,$10
+	lw $11,0b0,$12
+	sh $13,'z',$14
+	la TABLE
+	stop
+MASK: .dw 0xFFFFFFFF,-0x80000000,0b1111,'!'
+HALVES: .dh 0xFFFF,-32768,0B1000000000000000,'0'
+BYTES: .db 0xFF,-128,0b11111111,'a','''
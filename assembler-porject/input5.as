@@ -0,0 +1,21 @@
+; Data directives: .space, .fill, .align and .incbin
+.entry TABLE
+.extern COPY
+MAIN: la BUFFER
+	lw $1,0,$2
+	call COPY
+	la TABLE
+	stop
+NAME: .asciz "abc"
+BUFFER: .space 5
+	.align 2
+PATTERN: .fill 3,2,0x1234
+	.align 4
+WORDS: .fill 2,4,-1
+FLAGS: .fill 4,1,'x'
+	.align 4
+TABLE: .incbin "input5.bin"
+PART: .incbin "input5.bin", 8, 4
+	.db 1
+	.align 4
+END: .dw 0x7FFFFFFF
@@ -0,0 +1,19 @@
+; The macro stage: each macro body is stored once and expanded at every call
+.entry LOOP
+.extern PRINT
+mcro saveRegs
+	sw $0,0,$1
+	sw $0,4,$2
+endmcro
+mcro printCount
+	call PRINT
+	addi $3,1,$3
+endmcro
+saveRegs
+LOOP: add $0,$0,$0
+printCount
+printCount
+	blt $3,$4,LOOP
+saveRegs
+	stop
+COUNT: .dw 0
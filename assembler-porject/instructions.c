@@ -2,7 +2,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "utils.h"
+#include "instructions.h"
 
+/** Maximum operands of the .space and .fill instructions */
+#define MAX_DATA_OPERANDS 3
+
+/**
+ * Separates the comma separated operands of a data instruction, and prints error message if needed.
+ * @param line The current source line info
+ * @param index The index to start from
+ * @param destination The operand strings, of MAX_DATA_OPERANDS
+ * @param columns The indices of the operands in the line
+ * @param count The destination of the operands count
+ * @param name The instruction name, for the error messages
+ * @return Whether succeeded
+ */
+static bool get_data_operands(line_info line, int index, char destination[MAX_DATA_OPERANDS][MAX_LINE_LENGTH], int* columns,
+		int* count, char* name);
 
 instruction find_instruction_from_index(line_info line, int* index){
   char temp[MAX_LINE_LENGTH];
@@ -22,54 +38,49 @@ instruction find_instruction_from_index(line_info line, int* index){
   if ((result = find_instruction_by_name(temp+1)) != NONE_INST){
     return result;
   }
-  print_error(line, "Invalid instruction name: %s", temp);
+  print_error(line, UNKNOWN_INSTRUCTION_ERR, "Invalid instruction name: %s", temp);
 	return ERROR_INST; /* starts with '.' but not a valid instruction! */
 }
 
-bool process_asciz_instruction(line_info line, int index, long* dc, data_word** data){
-  char temp_str[MAX_LINE_LENGTH];
+bool process_asciz_instruction(line_info line, int index, long* dc, data_image* data, long* address){
+  char temp_str[MAX_LINE_LENGTH + 2];
 	char* last_quote_location = strrchr(line.content, '"');
+	long size_before = data->size;
+	*address = *dc;
 	SKIP_TO_NOT_WHITE(line.content, index)
   if (line.content[index] != '"') {
-		print_error(line, "Missing opening quote of string");
+		print_error_at(line, index, STRING_SYNTAX_ERR, "Missing opening quote of string");
 		return FALSE;
   }
   else if (&line.content[index] == last_quote_location) { /* last quote is same as first quote */
-		print_error(line, "Missing closing quote of string");
+		print_error_at(line, index, STRING_SYNTAX_ERR, "Missing closing quote of string");
 		return FALSE;
   }
   else{
     int i;
-		/* copy the string including quotes and everything until end of line */
-		for (i = 0;line.content[index] && line.content[index] != '\n' && line.content[index] != EOF; index++,i++) {
+		/* copy the characters after the opening quote, up to the next quote */
+		for (i = 0, index++; line.content[index] && line.content[index] != '"'; index++, i++) {
 				temp_str[i] = line.content[index];
 		}
-    /* put string terminator instead of last quote */
-		temp_str[last_quote_location - line.content] = '\0';
-
-    for(i = 1; temp_str[i] && temp_str[i] != '"'; i++) {
-      data[*dc] = (data_word*) malloc_with_check(sizeof(data_word));
-      data[*dc]->ins = ASCIZ_INST;
-      data[*dc]->data = temp_str[i];
-			(*dc)++;
-		}
+    /* put string terminator instead of the quote */
+		temp_str[i] = '\0';
 
-    data[*dc] = (data_word*) malloc_with_check(sizeof(data_word));
-    data[*dc]->ins = ASCIZ_INST;
-    /* put string terminator */
-    data[*dc]->data = '\0';
-		(*dc)++;
+    /* the string and it's terminator - or the address of the same string, if the strings are merged */
+    *address = add_data_string(data, temp_str, *dc);
+		(*dc) += data->size - size_before;
   }
   return TRUE;
 }
 
-bool process_data_instruction(line_info line, int index, long* dc, instruction inst, data_word** data){
-  char temp[80], *temp_ptr;
+bool process_data_instruction(line_info line, int index, long* dc, instruction inst, data_image* data){
+  char temp[80];
 	long value;
+	number_status status;
+	int size = inst == DB_INST ? 1 : inst == DH_INST ? 2 : 4;
 	int i;
 	SKIP_TO_NOT_WHITE(line.content, index)
   if (line.content[index] == ',') {
-		print_error(line, "Unexpected comma after data instruction");
+		print_error_at(line, index, DATA_SYNTAX_ERR, "Unexpected comma after data instruction");
     return FALSE;
 	}
   do{
@@ -79,30 +90,20 @@ bool process_data_instruction(line_info line, int index, long* dc, instruction i
 		}
     temp[i] = '\0'; /* end of string */
 
-    if (!is_int(temp)) {
-			print_error(line, "Expected integer for .data instruction, got '%s'", temp);
+    /* validated and range-checked by the width of the instruction, in a single scan */
+    status = parse_number(temp, size, &value);
+    if (status == NUMBER_SYNTAX_ERROR) {
+			print_error_at(line, index - i, DATA_SYNTAX_ERR, "Expected integer for .data instruction, got '%s'", temp);
 			return FALSE;
 		}
-   
-    /* write to data buffer */
-		value = strtol(temp, &temp_ptr, 10);
-    if(!is_num_in_range(value, inst)){
-      print_error(line, "The value is out of range for this instruction");
+    if (status == NUMBER_RANGE_ERROR) {
+      print_error_at(line, index - i, DATA_RANGE_ERR, "The value is out of range for this instruction");
       return FALSE;
     }
-    data[*dc] = (data_word*) malloc_with_check(sizeof(data_word));
-    data[*dc]->ins = inst;
-    data[*dc]->data = value;
 
-    if(inst == DB_INST){
-      (*dc)++; /* a word was written right now */
-    }
-    else if(inst == DW_INST){
-      (*dc)+=4;
-    }
-    else{ /* it's .dh instruction */
-      (*dc)+=2;
-    }
+    /* write to data buffer */
+    add_data_value(data, (unsigned long) value, size);
+    (*dc) += size;
 
     SKIP_TO_NOT_WHITE(line.content, index)
     if (line.content[index] == ','){
@@ -112,20 +113,220 @@ bool process_data_instruction(line_info line, int index, long* dc, instruction i
       break;  /* end of line/file/string - nothing to process anymore */
     }
     else{
-      print_error(line, "Missing comma.");
+      print_error_at(line, index, DATA_SYNTAX_ERR, "Missing comma.");
       return FALSE;
     }
     /* got comma. skip white chars and check if end of line (if so, there's extraneous comma) */
 		SKIP_TO_NOT_WHITE(line.content, index)
     if (line.content[index] == ',') {
-			print_error(line, "Multiple consecutive commas.");
+			print_error_at(line, index, DATA_SYNTAX_ERR, "Multiple consecutive commas.");
 			return FALSE;
 		}
     else if (line.content[index] == EOF || line.content[index] == '\n' || !line.content[index]){
-      print_error(line, "Missing data after comma");
+      print_error_at(line, index, DATA_SYNTAX_ERR, "Missing data after comma");
 			return FALSE;
     }
   } while(line.content[index] != '\n' && line.content[index] != EOF);
 
   return TRUE;
-}
\ No newline at end of file
+}
+
+bool process_space_instruction(line_info line, int index, long* dc, data_image* data){
+  char operands[MAX_DATA_OPERANDS][MAX_LINE_LENGTH];
+  int columns[MAX_DATA_OPERANDS], count;
+  long size;
+  number_status status;
+
+  if (!get_data_operands(line, index, operands, columns, &count, ".space")) {
+    return FALSE;
+  }
+  if (count != 1) {
+    print_error(line, DATA_SYNTAX_ERR, ".space requires 1 operand, got %d", count);
+    return FALSE;
+  }
+  status = parse_number(operands[0], 4, &size);
+  if (status == NUMBER_SYNTAX_ERROR) {
+    print_error_at(line, columns[0], DATA_SYNTAX_ERR, "Expected integer for .space instruction, got '%s'", operands[0]);
+    return FALSE;
+  }
+  if (status == NUMBER_RANGE_ERROR || size < 0) {
+    print_error_at(line, columns[0], DATA_RANGE_ERR, "The size of .space is out of range");
+    return FALSE;
+  }
+  /* zeros, which are written only with the object */
+  add_data_fill(data, size, 1, 0);
+  (*dc) += size;
+  return TRUE;
+}
+
+bool process_fill_instruction(line_info line, int index, long* dc, data_image* data){
+  char operands[MAX_DATA_OPERANDS][MAX_LINE_LENGTH];
+  int columns[MAX_DATA_OPERANDS], count, i;
+  long values[MAX_DATA_OPERANDS];
+  number_status status[MAX_DATA_OPERANDS];
+
+  if (!get_data_operands(line, index, operands, columns, &count, ".fill")) {
+    return FALSE;
+  }
+  if (count != 3) {
+    print_error(line, DATA_SYNTAX_ERR, ".fill requires 3 operands, got %d", count);
+    return FALSE;
+  }
+  for (i = 0; i < count; i++) {
+    if ((status[i] = parse_number(operands[i], 4, &values[i])) == NUMBER_SYNTAX_ERROR) {
+      print_error_at(line, columns[i], DATA_SYNTAX_ERR, "Expected integer for .fill instruction, got '%s'", operands[i]);
+      return FALSE;
+    }
+  }
+  if (status[0] == NUMBER_RANGE_ERROR || values[0] < 0) {
+    print_error_at(line, columns[0], DATA_RANGE_ERR, "The count of .fill is out of range");
+    return FALSE;
+  }
+  if (status[1] == NUMBER_RANGE_ERROR || (values[1] != 1 && values[1] != 2 && values[1] != 4)) {
+    print_error_at(line, columns[1], DATA_RANGE_ERR, "The size of .fill must be 1, 2 or 4");
+    return FALSE;
+  }
+  /* the value is checked by it's own size */
+  if (parse_number(operands[2], (int) values[1], &values[2]) != NUMBER_OK) {
+    print_error_at(line, columns[2], DATA_RANGE_ERR, "The value is out of range for this instruction");
+    return FALSE;
+  }
+  add_data_fill(data, values[0], (int) values[1], (unsigned long) values[2]);
+  (*dc) += values[0] * values[1];
+  return TRUE;
+}
+
+bool process_incbin_instruction(line_info line, int index, long* dc, data_image* data){
+  char name[MAX_LINE_LENGTH + 2];
+  char operands[MAX_DATA_OPERANDS][MAX_LINE_LENGTH];
+  int columns[MAX_DATA_OPERANDS], count = 0, i;
+  long values[2];
+  char* closing_quote;
+  data_file file;
+
+  SKIP_TO_NOT_WHITE(line.content, index)
+  if (line.content[index] != '"' || (closing_quote = strchr(line.content + index + 1, '"')) == NULL) {
+    print_error_at(line, index, DATA_SYNTAX_ERR, "Expected a quoted file name for .incbin.");
+    return FALSE;
+  }
+  for (index++, i = 0; line.content + index != closing_quote; index++, i++) {
+    name[i] = line.content[index];
+  }
+  name[i] = '\0';
+  index++;
+  /* the optional offset and length */
+  SKIP_TO_NOT_WHITE(line.content, index)
+  if (line.content[index] == ',') {
+    if (!get_data_operands(line, index + 1, operands, columns, &count, ".incbin")) {
+      return FALSE;
+    }
+    if (count != 2) {
+      print_error(line, DATA_SYNTAX_ERR, ".incbin requires a file name, or a file name, offset and length");
+      return FALSE;
+    }
+  }
+  else if (line.content[index] && line.content[index] != '\n' && line.content[index] != EOF) {
+    print_error_at(line, index, DATA_SYNTAX_ERR, "Missing comma.");
+    return FALSE;
+  }
+  for (i = 0; i < count; i++) {
+    if (parse_number(operands[i], 4, &values[i]) == NUMBER_SYNTAX_ERROR) {
+      print_error_at(line, columns[i], DATA_SYNTAX_ERR, "Expected integer for .incbin instruction, got '%s'", operands[i]);
+      return FALSE;
+    }
+  }
+
+  /* a counted image only needs the size of the file */
+  if (data->count_only ? !stat_data_file(name, &file) : !open_data_file(name, &file)) {
+    print_error(line, INCLUDE_ERR, "Cannot open the binary file: %s", name);
+    return FALSE;
+  }
+  if (count == 0) {
+    values[0] = 0;
+    values[1] = file.size;
+  }
+  for (i = 0; i < count; i++) {
+    if (parse_number(operands[i], 4, &values[i]) != NUMBER_OK || values[i] < 0 ||
+        (i == 0 ? values[0] > file.size : values[0] + values[1] > file.size)) {
+      print_error_at(line, columns[i], DATA_RANGE_ERR, "The %s of .incbin is out of the file range", i == 0 ? "offset" : "length");
+      close_data_file(&file);
+      return FALSE;
+    }
+  }
+  add_data_file(data, &file, values[0], values[1]);
+  (*dc) += values[1];
+  return TRUE;
+}
+
+bool process_align_instruction(line_info line, int index, long* dc, data_image* data){
+  char operands[MAX_DATA_OPERANDS][MAX_LINE_LENGTH];
+  int columns[MAX_DATA_OPERANDS], count;
+  long alignment;
+
+  if (!get_data_operands(line, index, operands, columns, &count, ".align")) {
+    return FALSE;
+  }
+  if (count != 1) {
+    print_error(line, DATA_SYNTAX_ERR, ".align requires 1 operand, got %d", count);
+    return FALSE;
+  }
+  if (parse_number(operands[0], 4, &alignment) == NUMBER_SYNTAX_ERROR) {
+    print_error_at(line, columns[0], DATA_SYNTAX_ERR, "Expected integer for .align instruction, got '%s'", operands[0]);
+    return FALSE;
+  }
+  if (alignment != 1 && alignment != 2 && alignment != MAX_DATA_ALIGNMENT) {
+    print_error_at(line, columns[0], DATA_RANGE_ERR, "The alignment of .align must be 1, 2 or %d", MAX_DATA_ALIGNMENT);
+    return FALSE;
+  }
+  align_data_counter(dc, (int) alignment, data);
+  return TRUE;
+}
+
+void align_data_counter(long* dc, int alignment, data_image* data){
+  long padding = (alignment - *dc % alignment) % alignment;
+  add_data_padding(data, padding, alignment);
+  (*dc) += padding;
+}
+
+static bool get_data_operands(line_info line, int index, char destination[MAX_DATA_OPERANDS][MAX_LINE_LENGTH], int* columns,
+		int* count, char* name){
+  int i;
+  *count = 0;
+  SKIP_TO_NOT_WHITE(line.content, index)
+  if (line.content[index] == ',') {
+    print_error_at(line, index, DATA_SYNTAX_ERR, "Unexpected comma after %s instruction", name);
+    return FALSE;
+  }
+  while (line.content[index] && line.content[index] != '\n' && line.content[index] != EOF) {
+    if (*count == MAX_DATA_OPERANDS) {
+      print_error_at(line, index, DATA_SYNTAX_ERR, "Too many operands for %s instruction", name);
+      return FALSE;
+    }
+    columns[*count] = index;
+    for (i = 0; line.content[index] && line.content[index] != EOF && line.content[index] != '\t' &&
+         line.content[index] != ' ' && line.content[index] != ',' && line.content[index] != '\n'; index++, i++) {
+      destination[*count][i] = line.content[index];
+    }
+    destination[(*count)++][i] = '\0';
+
+    SKIP_TO_NOT_WHITE(line.content, index)
+    if (!line.content[index] || line.content[index] == '\n' || line.content[index] == EOF) {
+      break;
+    }
+    if (line.content[index] != ',') {
+      print_error_at(line, index, DATA_SYNTAX_ERR, "Missing comma.");
+      return FALSE;
+    }
+    index++;
+    SKIP_TO_NOT_WHITE(line.content, index)
+    if (line.content[index] == ',') {
+      print_error_at(line, index, DATA_SYNTAX_ERR, "Multiple consecutive commas.");
+      return FALSE;
+    }
+    else if (line.content[index] == EOF || line.content[index] == '\n' || !line.content[index]) {
+      print_error_at(line, index, DATA_SYNTAX_ERR, "Missing data after comma");
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
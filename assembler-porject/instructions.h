@@ -2,6 +2,7 @@
 #ifndef _INSTRUCTIONS_H
 #define _INSTRUCTIONS_H
 #include "globals.h"
+#include "data_image.h"
 
 /**
  * Returns the first instruction detected from the index in the string.
@@ -17,9 +18,11 @@ instruction find_instruction_from_index(line_info line, int* index);
  * @param index The index
  * @param dc The current data counter
  * @param data The data image struct
+ * @param address The destination address of the string - the data counter before it, or the address of the same
+ * string when the strings are merged
  * @return Whether succeeded
  */
-bool process_asciz_instruction(line_info line, int index, long* dc, data_word** data);
+bool process_asciz_instruction(line_info line, int index, long* dc, data_image* data, long* address);
 
 /**
  * Processes a data instructions: .db, .dh, .dw from index of source line.
@@ -31,6 +34,58 @@ bool process_asciz_instruction(line_info line, int index, long* dc, data_word**
  * @param data The data image
  * @return Whether succeeded
  */
-bool process_data_instruction(line_info line, int index, long* dc, instruction inst, data_word** data);
+bool process_data_instruction(line_info line, int index, long* dc, instruction inst, data_image* data);
+
+/**
+ * Processes a .space N instruction from index of source line: reserves N zero bytes,
+ * which are stored as a single segment of the data image.
+ * @param line The current source line info
+ * @param index The index
+ * @param dc The current data counter
+ * @param data The data image
+ * @return Whether succeeded
+ */
+bool process_space_instruction(line_info line, int index, long* dc, data_image* data);
+
+/**
+ * Processes a .fill count, size, value instruction from index of source line: the value, of 1, 2 or 4 bytes,
+ * repeated count times. It's stored once, as a single segment of the data image.
+ * @param line The current source line info
+ * @param index The index
+ * @param dc The current data counter
+ * @param data The data image
+ * @return Whether succeeded
+ */
+bool process_fill_instruction(line_info line, int index, long* dc, data_image* data);
+
+/**
+ * Processes a .incbin "file"[, offset, length] instruction from index of source line: the bytes of the file
+ * (or of a part of it) are spliced into the data image by reference, and copied only when they're written.
+ * @param line The current source line info
+ * @param index The index
+ * @param dc The current data counter
+ * @param data The data image
+ * @return Whether succeeded
+ */
+bool process_incbin_instruction(line_info line, int index, long* dc, data_image* data);
+
+/**
+ * Processes a .align N instruction from index of source line: pads the data image with zero bytes, up to the next
+ * multiple of N. N is 1, 2 or 4 - the code words are always aligned to 4 already.
+ * @param line The current source line info
+ * @param index The index
+ * @param dc The current data counter
+ * @param data The data image
+ * @return Whether succeeded
+ */
+bool process_align_instruction(line_info line, int index, long* dc, data_image* data);
+
+/**
+ * Pads the data image with zero bytes, up to the next multiple of the alignment
+ * @param dc The current data counter
+ * @param alignment The alignment, up to MAX_DATA_ALIGNMENT
+ * @param data The data image
+ */
+void align_data_counter(long* dc, int alignment, data_image* data);
 
 #endif
\ No newline at end of file
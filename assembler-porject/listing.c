@@ -0,0 +1,276 @@
+/* Implements the listing file, from the lines metadata kept by the first pass */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "listing.h"
+#include "code.h"
+#include "utils.h"
+#include "batch_io.h"
+
+/** Encoded bytes in a single listing row */
+#define LISTING_ROW_BYTES 4
+
+/* A label defined or used by a listed line, for the cross references */
+typedef struct listing_xref {
+	char* label;
+	line_info line;
+	long order; /* the source order, for the lines of the same label */
+} listing_xref;
+
+/**
+ * Writes a single listing row - it's location, address, bytes and source
+ * @param file_desc The listing file
+ * @param line The listed line, NULL for a continuation row of the previous line's bytes
+ * @param address The address of the bytes, -1 if none
+ * @param bytes The bytes
+ * @param count The bytes count, up to LISTING_ROW_BYTES
+ */
+static void write_listing_row(FILE* file_desc, listing_line* line, long address, unsigned char* bytes, int count);
+
+/**
+ * Writes the cross references: each symbol, it's value and type, where it's defined and where it's used
+ * @param file_desc The listing file
+ * @param lst The listing
+ * @param symbol_table The symbol table
+ * @param refs The label references
+ */
+static void write_cross_references(FILE* file_desc, listing* lst, table symbol_table, label_ref_list* refs);
+
+/**
+ * Finds the first cross reference of a label, by binary search
+ * @param xrefs The cross references, sorted by label
+ * @param count The cross references count
+ * @param label The label
+ * @return The index of the first cross reference of the label, count if not found
+ */
+static long find_first_xref(listing_xref* xrefs, long count, char* label);
+
+/* Compares two cross references by label, then by source order, for qsort */
+static int compare_xrefs(const void* first, const void* second);
+
+/* Compares two symbol table entries by value, then by name, for qsort */
+static int compare_symbols(const void* first, const void* second);
+
+void add_listing_line(listing* lst, line_info line, long ic_before, long ic_after, long dc_before, long dc_after){
+	listing_line* new_line;
+	char* content = line.content != NULL ? line.content : "";
+	long length = strlen(content);
+
+	if (lst->count == lst->capacity) {
+		lst->capacity = lst->capacity == 0 ? 64 : lst->capacity * 2;
+		lst->lines = (listing_line *) realloc_with_check(lst->lines, lst->capacity * sizeof(listing_line));
+	}
+	new_line = &lst->lines[lst->count++];
+	/* the line break isn't part of the listed source */
+	while (length > 0 && (content[length - 1] == '\n' || content[length - 1] == '\r')) {
+		length--;
+	}
+	new_line->content = (char *) malloc_with_check(length + 1);
+	strncpy(new_line->content, content, length);
+	new_line->content[length] = '\0';
+	new_line->file_name = line.file_name;
+	new_line->line_number = line.line_number;
+	new_line->ic = ic_after > ic_before ? ic_before : -1;
+	new_line->removed = NOT_REMOVED;
+	new_line->dc = dc_before;
+	new_line->dc_end = dc_after;
+}
+
+bool write_listing_file(listing* lst, machine_word** code_img, long icf, data_image* data, table symbol_table,
+		label_ref_list* refs, char* filename){
+	FILE* file_desc;
+	long i, j, ref_index = 0;
+	unsigned long word;
+	unsigned char code_bytes[4];
+	unsigned char data_bytes[LISTING_ROW_BYTES];
+	int row_size;
+	listing_line* line;
+	table_entry* symbol;
+	char* output_filename = strconcat(filename, ".lst");
+
+	file_desc = open_output_file(output_filename);
+	if (file_desc == NULL) {
+		printf("Can't create or rewrite to file %s.\n", output_filename);
+		free(output_filename);
+		return FALSE;
+	}
+	free(output_filename);
+
+	fprintf(file_desc, "; code %ld bytes, data %ld bytes\n", icf - IC_INIT_VALUE, lst->count > 0 ? lst->lines[lst->count - 1].dc_end : 0);
+	for (i = 0; i < lst->count; i++) {
+		line = &lst->lines[i];
+		if (line->ic >= 0) {
+			word = encode_code_word(code_img[line->ic - IC_INIT_VALUE]->word.code);
+			for (j = 0; j < 4; j++) {
+				code_bytes[j] = (word >> (j * 8)) & 0xFF;
+			}
+			write_listing_row(file_desc, line, line->ic, code_bytes, 4);
+			/* the labels used by the line. the references are in the order of the code */
+			while (ref_index < refs->count && (refs->refs[ref_index].is_entry || refs->refs[ref_index].ic < line->ic)) {
+				ref_index++;
+			}
+			for ( ; ref_index < refs->count && refs->refs[ref_index].ic == line->ic; ref_index++) {
+				symbol = find_by_types(symbol_table, refs->refs[ref_index].label, 3, CODE_SYMBOL, DATA_SYMBOL, EXTERNAL_SYMBOL);
+				if (symbol != NULL && symbol->type == EXTERNAL_SYMBOL) {
+					fprintf(file_desc, "\t; %s = external", symbol->key);
+				}
+				else if (symbol != NULL) {
+					fprintf(file_desc, "\t; %s = %.4ld", symbol->key, symbol->value);
+				}
+			}
+		}
+		else if (line->dc_end > line->dc) {
+			/* the data bytes, in rows of a few bytes. each row is taken by it's own, as a line may reserve a large buffer */
+			for (j = 0; j < line->dc_end - line->dc; j += LISTING_ROW_BYTES) {
+				if (j > 0) {
+					fprintf(file_desc, "\n");
+				}
+				row_size = line->dc_end - line->dc - j < LISTING_ROW_BYTES ? (int) (line->dc_end - line->dc - j) : LISTING_ROW_BYTES;
+				get_data_bytes(data, line->dc + j, line->dc + j + row_size, data_bytes);
+				write_listing_row(file_desc, j == 0 ? line : NULL, icf + line->dc + j, data_bytes, row_size);
+			}
+		}
+		else {
+			write_listing_row(file_desc, line, -1, NULL, 0);
+			if (line->removed != NOT_REMOVED) {
+				fprintf(file_desc, line->removed == GC_REMOVAL ? "\t; removed as unreachable" : "\t; removed by the optimizer");
+			}
+		}
+		fprintf(file_desc, "\n");
+	}
+
+	write_cross_references(file_desc, lst, symbol_table, refs);
+	close_output_file(file_desc);
+	return TRUE;
+}
+
+void free_listing(listing* lst){
+	long i;
+	for (i = 0; i < lst->count; i++) {
+		free(lst->lines[i].content);
+	}
+	free(lst->lines);
+	lst->lines = NULL;
+	lst->count = lst->capacity = 0;
+}
+
+static void write_listing_row(FILE* file_desc, listing_line* line, long address, unsigned char* bytes, int count){
+	char location[MAX_LINE_LENGTH + 24] = "";
+	char hex[LISTING_ROW_BYTES * 3 + 1] = "";
+	int i;
+
+	if (line != NULL) {
+		sprintf(location, "%.*s:%ld", MAX_LINE_LENGTH, line->file_name, line->line_number);
+	}
+	for (i = 0; i < count; i++) {
+		sprintf(hex + i * 3, "%02X ", bytes[i]);
+	}
+	if (address >= 0) {
+		fprintf(file_desc, "%-16s %.4ld  %-12s", location, address, hex);
+	}
+	else {
+		fprintf(file_desc, "%-16s %4s  %-12s", location, "", hex);
+	}
+	if (line != NULL) {
+		fprintf(file_desc, " %s", line->content);
+	}
+}
+
+static void write_cross_references(FILE* file_desc, listing* lst, table symbol_table, label_ref_list* refs){
+	long i, j, def_count = 0, use_count = refs->count, symbol_count = 0;
+	listing_xref *defs, *uses;
+	table_entry *entry, **symbols;
+	char label[MAX_LINE_LENGTH + 2];
+
+	/* the labels defined by the lines, and the labels used by them (operands & .entry), sorted by label */
+	defs = (listing_xref *) malloc_with_check((lst->count + 1) * sizeof(listing_xref));
+	for (i = 0; i < lst->count; i++) {
+		get_defined_label(lst->lines[i].content, label);
+		if (label[0]) {
+			defs[def_count].label = (char *) malloc_with_check(strlen(label) + 1);
+			strcpy(defs[def_count].label, label);
+			defs[def_count].line.file_name = lst->lines[i].file_name;
+			defs[def_count].line.line_number = lst->lines[i].line_number;
+			defs[def_count].order = i;
+			def_count++;
+		}
+	}
+	qsort(defs, def_count, sizeof(listing_xref), compare_xrefs);
+	uses = (listing_xref *) malloc_with_check((use_count + 1) * sizeof(listing_xref));
+	for (i = 0; i < use_count; i++) {
+		uses[i].label = refs->refs[i].label;
+		uses[i].line = refs->refs[i].line;
+		uses[i].order = i;
+	}
+	qsort(uses, use_count, sizeof(listing_xref), compare_xrefs);
+
+	/* the symbols by address, then by name */
+	for (entry = symbol_table; entry != NULL; entry = entry->next) {
+		symbol_count++;
+	}
+	symbols = (table_entry **) malloc_with_check((symbol_count + 1) * sizeof(table_entry *));
+	for (symbol_count = 0, entry = symbol_table; entry != NULL; entry = entry->next) {
+		if (entry->type != EXTERNAL_REFERENCE && entry->type != ENTRY_SYMBOL) {
+			symbols[symbol_count++] = entry;
+		}
+	}
+	qsort(symbols, symbol_count, sizeof(table_entry *), compare_symbols);
+
+	fprintf(file_desc, "\n; symbols\n");
+	for (j = 0; j < symbol_count; j++) {
+		entry = symbols[j];
+		fprintf(file_desc, "%-32s %.4ld  %-8s", entry->key, entry->value,
+				entry->type == CODE_SYMBOL ? "code" : entry->type == DATA_SYMBOL ? "data" : "external");
+
+		if ((i = find_first_xref(defs, def_count, entry->key)) < def_count) {
+			fprintf(file_desc, "  defined %s:%ld", defs[i].line.file_name, defs[i].line.line_number);
+		}
+		if ((i = find_first_xref(uses, use_count, entry->key)) < use_count) {
+			fprintf(file_desc, "  used");
+		}
+		for ( ; i < use_count && strcmp(uses[i].label, entry->key) == 0; i++) {
+			fprintf(file_desc, " %s:%ld", uses[i].line.file_name, uses[i].line.line_number);
+		}
+		fprintf(file_desc, "\n");
+	}
+	free(symbols);
+
+	for (i = 0; i < def_count; i++) {
+		free(defs[i].label);
+	}
+	free(defs);
+	free(uses);
+}
+
+static long find_first_xref(listing_xref* xrefs, long count, char* label){
+	long low = 0, high = count, middle;
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (strcmp(xrefs[middle].label, label) < 0) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low < count && strcmp(xrefs[low].label, label) == 0 ? low : count;
+}
+
+static int compare_xrefs(const void* first, const void* second){
+	listing_xref* xref1 = (listing_xref *) first;
+	listing_xref* xref2 = (listing_xref *) second;
+	int result = strcmp(xref1->label, xref2->label);
+	if (result != 0) {
+		return result;
+	}
+	return xref1->order < xref2->order ? -1 : xref1->order > xref2->order;
+}
+
+static int compare_symbols(const void* first, const void* second){
+	table_entry* entry1 = *(table_entry **) first;
+	table_entry* entry2 = *(table_entry **) second;
+	if (entry1->value != entry2->value) {
+		return entry1->value < entry2->value ? -1 : 1;
+	}
+	return strcmp(entry1->key, entry2->key);
+}
@@ -0,0 +1,65 @@
+/* The listing file (.lst) - the address, hex and source of each line, built from the first pass metadata */
+#ifndef _LISTING_H
+#define _LISTING_H
+#include "globals.h"
+#include "table.h"
+#include "data_image.h"
+
+/* Why the code or the data of a listed line was removed */
+typedef enum removal_reason {
+	NOT_REMOVED = 0,
+	OPTIMIZER_REMOVAL, /* an instruction without effect, removed by the optimizer */
+	GC_REMOVAL /* code or data the program never reaches, removed by --gc */
+} removal_reason;
+
+/* A single source line of the listing */
+typedef struct listing_line {
+	char* file_name; /* not a copy - the file names are kept until the output files are written */
+	long line_number;
+	char* content; /* a copy of the line */
+	long ic; /* address of the code word of the line, -1 if none */
+	removal_reason removed; /* why the code word or the data of the line was removed, NOT_REMOVED if it wasn't */
+	long dc; /* the data bytes of the line, relative to the data image */
+	long dc_end;
+} listing_line;
+
+/* The listed lines, in source order (after macro expansion) */
+typedef struct listing {
+	listing_line* lines;
+	long count;
+	long capacity;
+} listing;
+
+/**
+ * Adds a processed line to the listing
+ * @param lst The listing
+ * @param line The source line
+ * @param ic_before The code counter before the line
+ * @param ic_after The code counter after the line
+ * @param dc_before The data counter before the line
+ * @param dc_after The data counter after the line
+ */
+void add_listing_line(listing* lst, line_info line, long ic_before, long ic_after, long dc_before, long dc_after);
+
+/**
+ * Writes the .lst file: each line with it's address and encoded bytes, the labels it uses,
+ * and the symbols with their definition and references at the end.
+ * @param lst The listing
+ * @param code_img The final code image
+ * @param icf The final code counter
+ * @param data The data image
+ * @param symbol_table The symbol table, after the second pass
+ * @param refs The label references
+ * @param filename The filename, without the extension
+ * @return Whether succeeded
+ */
+bool write_listing_file(listing* lst, machine_word** code_img, long icf, data_image* data, table symbol_table,
+		label_ref_list* refs, char* filename);
+
+/**
+ * Deallocates all the memory required by a listing
+ * @param lst The listing
+ */
+void free_listing(listing* lst);
+
+#endif
@@ -0,0 +1,287 @@
+/* Implements the CPU simulation: the code image is predecoded once, and executed from the decoded table */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "machine.h"
+#include "utils.h"
+
+/** Converts a value to a signed 32 bits word, as kept in the registers */
+#define TO_WORD(x) ((long) (((unsigned long) (x) & 0xFFFFFFFFUL) ^ 0x80000000UL) - 0x7FFFFFFFL - 1)
+
+/** Estimated cycles of each instruction class, and the extra cycles of a taken branch */
+#define ALU_CYCLES 1
+#define BRANCH_CYCLES 1
+#define MEMORY_CYCLES 2
+#define JUMP_CYCLES 2
+#define TAKEN_BRANCH_PENALTY 1
+
+/* The class of each operation, by the machine_op values */
+static op_class op_classes[M_INVALID + 1] = {
+	ALU_CLASS, ALU_CLASS, ALU_CLASS, ALU_CLASS, ALU_CLASS,
+	ALU_CLASS, ALU_CLASS, ALU_CLASS,
+	ALU_CLASS, ALU_CLASS, ALU_CLASS, ALU_CLASS, ALU_CLASS,
+	BRANCH_CLASS, BRANCH_CLASS, BRANCH_CLASS, BRANCH_CLASS,
+	MEMORY_CLASS, MEMORY_CLASS, MEMORY_CLASS, MEMORY_CLASS, MEMORY_CLASS, MEMORY_CLASS,
+	JUMP_CLASS, JUMP_CLASS, JUMP_CLASS, JUMP_CLASS, JUMP_CLASS,
+	ALU_CLASS
+};
+
+/* The cycles of each class, by the op_class values */
+static int class_cycles[OP_CLASS_COUNT] = {ALU_CYCLES, BRANCH_CYCLES, MEMORY_CYCLES, JUMP_CYCLES};
+
+/* The names of the classes, for the report */
+static char* class_names[OP_CLASS_COUNT] = {"alu", "branch", "memory", "jump"};
+
+/**
+ * Decodes a single code word into it's operation and fields
+ * @param word The code word
+ * @param dest The destination decoded instruction
+ */
+static void decode_instruction(unsigned long word, decoded_instruction* dest);
+
+/**
+ * Reads a little-endian value from memory
+ * @param mach The machine
+ * @param address The address
+ * @param size The size in bytes (1, 2 or 4)
+ * @return The value, sign-extended
+ */
+static long read_memory(machine* mach, long address, int size);
+
+/**
+ * Writes a little-endian value to memory, and decodes again the code words that were written.
+ * @param mach The machine
+ * @param address The address
+ * @param size The size in bytes (1, 2 or 4)
+ * @param value The value
+ */
+static void write_memory(machine* mach, long address, int size, long value);
+
+bool load_machine(machine* mach, unsigned char* code, long code_size, unsigned char* data, long data_size){
+	long i;
+
+	memset(mach, 0, sizeof(machine));
+	if (code_size % 4 != 0 || IC_INIT_VALUE + code_size + data_size > MEMORY_SIZE) {
+		return FALSE;
+	}
+	mach->memory = (unsigned char *) calloc(MEMORY_SIZE, 1);
+	if (mach->memory == NULL) {
+		return FALSE;
+	}
+	memcpy(mach->memory + IC_INIT_VALUE, code, code_size);
+	memcpy(mach->memory + IC_INIT_VALUE + code_size, data, data_size);
+	mach->code_end = IC_INIT_VALUE + code_size;
+	mach->data_end = mach->code_end + data_size;
+
+	/* decode each code word once */
+	mach->code = (decoded_instruction *) malloc_with_check((code_size / 4 + 1) * sizeof(decoded_instruction));
+	for (i = 0; i < code_size / 4; i++) {
+		decode_instruction((unsigned long) read_memory(mach, IC_INIT_VALUE + i * 4, 4) & 0xFFFFFFFFUL, &mach->code[i]);
+	}
+	mach->pc = mach->error_address = IC_INIT_VALUE;
+	return TRUE;
+}
+
+bool run_machine(machine* mach, unsigned long max_steps){
+	long* reg = mach->registers;
+	long pc = mach->pc, next, address;
+	long executed = pc; /* the address of the last executed instruction */
+	unsigned long steps = 0;
+	decoded_instruction* ins;
+
+	mach->error = NULL;
+	while (TRUE) {
+		if (max_steps != 0 && steps == max_steps) {
+			mach->error = "Maximum steps reached.";
+			executed = pc; /* the next instruction is the one not executed */
+			break;
+		}
+		if (pc < IC_INIT_VALUE || pc >= mach->code_end || (pc - IC_INIT_VALUE) % 4 != 0) {
+			mach->error = "Jump outside of the code image.";
+			/* the target is not an instruction - the error is of the jump to it, or of the word the run fell off */
+			break;
+		}
+		executed = pc;
+		ins = &mach->code[(pc - IC_INIT_VALUE) >> 2];
+		mach->op_count[ins->op]++;
+		steps++;
+		next = pc + 4;
+
+		switch (ins->op) {
+			case M_ADD: reg[ins->rd] = TO_WORD(reg[ins->rs] + reg[ins->rt]); break;
+			case M_SUB: reg[ins->rd] = TO_WORD(reg[ins->rs] - reg[ins->rt]); break;
+			case M_AND: reg[ins->rd] = reg[ins->rs] & reg[ins->rt]; break;
+			case M_OR: reg[ins->rd] = reg[ins->rs] | reg[ins->rt]; break;
+			case M_NOR: reg[ins->rd] = ~(reg[ins->rs] | reg[ins->rt]); break;
+			case M_MOVE: reg[ins->rd] = reg[ins->rs]; break;
+			case M_MVHI: reg[ins->rd] = (reg[ins->rs] >> 16) & 0xFFFF; break;
+			case M_MVLO: reg[ins->rd] = reg[ins->rs] & 0xFFFF; break;
+
+			case M_ADDI: reg[ins->rt] = TO_WORD(reg[ins->rs] + ins->value); break;
+			case M_SUBI: reg[ins->rt] = TO_WORD(reg[ins->rs] - ins->value); break;
+			case M_ANDI: reg[ins->rt] = reg[ins->rs] & ins->value; break;
+			case M_ORI: reg[ins->rt] = reg[ins->rs] | ins->value; break;
+			case M_NORI: reg[ins->rt] = ~(reg[ins->rs] | ins->value); break;
+
+			case M_BNE:
+				if (reg[ins->rs] != reg[ins->rt]) { next = pc + ins->value; mach->taken_branches++; }
+				break;
+			case M_BEQ:
+				if (reg[ins->rs] == reg[ins->rt]) { next = pc + ins->value; mach->taken_branches++; }
+				break;
+			case M_BLT:
+				if (reg[ins->rs] < reg[ins->rt]) { next = pc + ins->value; mach->taken_branches++; }
+				break;
+			case M_BGT:
+				if (reg[ins->rs] > reg[ins->rt]) { next = pc + ins->value; mach->taken_branches++; }
+				break;
+
+			case M_LB: case M_LH: case M_LW:
+				address = reg[ins->rs] + ins->value;
+				if (address < 0 || address + 4 > MEMORY_SIZE) {
+					mach->error = "Memory access out of range.";
+					break;
+				}
+				reg[ins->rt] = read_memory(mach, address, ins->op == M_LB ? 1 : ins->op == M_LH ? 2 : 4);
+				break;
+			case M_SB: case M_SH: case M_SW:
+				address = reg[ins->rs] + ins->value;
+				if (address < 0 || address + 4 > MEMORY_SIZE) {
+					mach->error = "Memory access out of range.";
+					break;
+				}
+				write_memory(mach, address, ins->op == M_SB ? 1 : ins->op == M_SH ? 2 : 4, reg[ins->rt]);
+				break;
+
+			case M_JMP: next = ins->value; break;
+			case M_JMP_REG: next = reg[ins->value]; break;
+			case M_LA: reg[0] = ins->value; break;
+			case M_CALL: reg[0] = next; next = ins->value; break;
+			case M_STOP: mach->stopped = TRUE; break;
+
+			default:
+				mach->error = "Invalid instruction.";
+				break;
+		}
+		if (mach->stopped || mach->error != NULL) {
+			break;
+		}
+		pc = next;
+	}
+	mach->pc = pc;
+	mach->error_address = executed;
+	return mach->stopped && mach->error == NULL;
+}
+
+void print_machine_report(machine* mach, double seconds, FILE* out){
+	int i;
+	unsigned long instructions = 0, cycles = 0, class_count[OP_CLASS_COUNT] = {0};
+
+	for (i = 0; i <= M_INVALID; i++) {
+		instructions += mach->op_count[i];
+		class_count[op_classes[i]] += mach->op_count[i];
+	}
+	for (i = 0; i < OP_CLASS_COUNT; i++) {
+		cycles += class_count[i] * class_cycles[i];
+	}
+	cycles += mach->taken_branches * TAKEN_BRANCH_PENALTY;
+
+	if (mach->error != NULL) {
+		fprintf(out, "Error at %.4ld: %s\n", mach->error_address, mach->error);
+		if (mach->error_address != mach->pc) {
+			fprintf(out, "Next address: %.4ld\n", mach->pc);
+		}
+	}
+	fprintf(out, "Instructions: %lu\n", instructions);
+	fprintf(out, "Cycles: %lu\n", cycles);
+	if (instructions > 0) {
+		fprintf(out, "CPI: %.2f\n", (double) cycles / instructions);
+	}
+	for (i = 0; i < OP_CLASS_COUNT; i++) {
+		fprintf(out, "  %-8s %lu\n", class_names[i], class_count[i]);
+	}
+	fprintf(out, "  taken branches %lu\n", mach->taken_branches);
+	if (seconds > 0) {
+		fprintf(out, "Simulation speed: %.1f MIPS\n", instructions / seconds / 1e6);
+	}
+	fprintf(out, "Registers:");
+	for (i = 0; i < REGISTERS_COUNT; i++) {
+		fprintf(out, "%s$%d=%ld", i % 8 == 0 ? "\n  " : " ", i, mach->registers[i]);
+	}
+	fprintf(out, "\n");
+}
+
+void free_machine(machine* mach){
+	free(mach->memory);
+	free(mach->code);
+	mach->memory = NULL;
+	mach->code = NULL;
+}
+
+static void decode_instruction(unsigned long word, decoded_instruction* dest){
+	int opcode = (word >> 26) & 0x3F;
+	int funct = (word >> 6) & 0x1F;
+
+	dest->op = M_INVALID;
+	dest->rs = (word >> 21) & 0x1F;
+	dest->rt = (word >> 16) & 0x1F;
+	dest->rd = (word >> 11) & 0x1F;
+	dest->value = 0;
+
+	if (opcode == ADD_OP && funct >= ADD_FUNCT && funct <= NOR_FUNCT) { /* R commands */
+		dest->op = M_ADD + (funct - ADD_FUNCT);
+	}
+	else if (opcode == MOVE_OP && funct >= MOVE_FUNCT && funct <= MVLO_FUNCT) {
+		dest->op = M_MOVE + (funct - MOVE_FUNCT);
+	}
+	else if (opcode >= ADDI_OP && opcode <= SH_OP) { /* I commands - sign-extend the immed */
+		dest->op = M_ADDI + (opcode - ADDI_OP);
+		dest->value = (long) (word & 0xFFFF) - ((word & 0x8000) ? 0x10000L : 0);
+	}
+	else if (opcode >= JMP_OP && opcode <= CALL_OP) { /* J commands */
+		if (opcode == JMP_OP) {
+			dest->op = ((word >> 25) & 1) ? M_JMP_REG : M_JMP;
+		}
+		else {
+			dest->op = opcode == LA_OP ? M_LA : M_CALL;
+		}
+		dest->value = word & 0x1FFFFFF;
+		if (dest->op == M_JMP_REG && dest->value >= REGISTERS_COUNT) {
+			dest->op = M_INVALID;
+		}
+	}
+	else if (opcode == STOP_OP) {
+		dest->op = M_STOP;
+	}
+}
+
+static long read_memory(machine* mach, long address, int size){
+	unsigned char* bytes = mach->memory + address;
+	if (size == 1) {
+		return (long) bytes[0] - (bytes[0] & 0x80 ? 0x100L : 0);
+	}
+	if (size == 2) {
+		unsigned long value = bytes[0] | ((unsigned long) bytes[1] << 8);
+		return (long) value - (value & 0x8000 ? 0x10000L : 0);
+	}
+	return TO_WORD(bytes[0] | ((unsigned long) bytes[1] << 8) | ((unsigned long) bytes[2] << 16) | ((unsigned long) bytes[3] << 24));
+}
+
+static void write_memory(machine* mach, long address, int size, long value){
+	int i;
+	long first, last;
+	for (i = 0; i < size; i++) {
+		mach->memory[address + i] = (unsigned char) ((unsigned long) value >> (i * 8));
+	}
+	/* self-modifying code - decode the written code words again */
+	if (address + size > IC_INIT_VALUE && address < mach->code_end) {
+		first = (address < IC_INIT_VALUE ? 0 : address - IC_INIT_VALUE) / 4;
+		last = (address + size - 1 - IC_INIT_VALUE) / 4;
+		if (last >= (mach->code_end - IC_INIT_VALUE) / 4) {
+			last = (mach->code_end - IC_INIT_VALUE) / 4 - 1;
+		}
+		for (; first <= last; first++) {
+			decode_instruction((unsigned long) read_memory(mach, IC_INIT_VALUE + first * 4, 4) & 0xFFFFFFFFUL, &mach->code[first]);
+		}
+	}
+}
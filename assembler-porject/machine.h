@@ -0,0 +1,90 @@
+/* Simulation of the imaginary CPU, running assembled code and data images */
+#ifndef _MACHINE_H
+#define _MACHINE_H
+#include <stdio.h>
+#include "globals.h"
+
+/** Memory size in bytes, as addressed by the 25 bits address of a J command */
+#define MEMORY_SIZE (1L << 25)
+
+/** Registers count */
+#define REGISTERS_COUNT 32
+
+/* The executed operation of a predecoded instruction. values are dense, for a compact dispatch */
+typedef enum machine_op {
+	M_ADD, M_SUB, M_AND, M_OR, M_NOR,
+	M_MOVE, M_MVHI, M_MVLO,
+	M_ADDI, M_SUBI, M_ANDI, M_ORI, M_NORI,
+	M_BNE, M_BEQ, M_BLT, M_BGT,
+	M_LB, M_SB, M_LW, M_SW, M_LH, M_SH,
+	M_JMP, M_JMP_REG, M_LA, M_CALL, M_STOP,
+	/* Not a valid instruction */
+	M_INVALID
+} machine_op;
+
+/* Instruction classes, for the cycles report */
+typedef enum op_class {
+	ALU_CLASS,
+	BRANCH_CLASS,
+	MEMORY_CLASS,
+	JUMP_CLASS,
+	OP_CLASS_COUNT
+} op_class;
+
+/* A code word, decoded once when loaded */
+typedef struct decoded_instruction {
+	machine_op op;
+	unsigned char rs, rt, rd;
+	long value; /* sign-extended immed of I commands, or address/register of J commands */
+} decoded_instruction;
+
+/* The state of the simulated machine */
+typedef struct machine {
+	unsigned char* memory;
+	long registers[REGISTERS_COUNT];
+	long pc;
+	long code_end; /* address right after the code image */
+	long data_end; /* address right after the data image */
+	decoded_instruction* code; /* predecoded code image, by (address - IC_INIT_VALUE) / 4 */
+	unsigned long op_count[M_INVALID + 1]; /* executed instructions by operation */
+	unsigned long taken_branches; /* executed branches that were taken */
+	bool stopped; /* whether reached stop */
+	char* error; /* runtime error, NULL if none */
+	long error_address; /* the address of the instruction of the error */
+} machine;
+
+/**
+ * Loads code and data images into a new machine, and predecodes the code image.
+ * The code is placed at IC_INIT_VALUE, and the data right after it, as the assembler addresses them.
+ * @param mach The machine to initialize
+ * @param code The code image bytes
+ * @param code_size The code image size in bytes
+ * @param data The data image bytes
+ * @param data_size The data image size in bytes
+ * @return Whether succeeded (the images fit into memory)
+ */
+bool load_machine(machine* mach, unsigned char* code, long code_size, unsigned char* data, long data_size);
+
+/**
+ * Runs the loaded program from it's first instruction, until stop, a runtime error or the maximum steps.
+ * @param mach The machine
+ * @param max_steps Maximum instructions to execute, 0 for no limit
+ * @return Whether reached stop without errors
+ */
+bool run_machine(machine* mach, unsigned long max_steps);
+
+/**
+ * Prints the instructions count and the cycles report of the last run.
+ * @param mach The machine
+ * @param seconds The time of the run in seconds
+ * @param out The output file
+ */
+void print_machine_report(machine* mach, double seconds, FILE* out);
+
+/**
+ * Deallocates all the memory required by the machine.
+ * @param mach The machine
+ */
+void free_machine(machine* mach);
+
+#endif
@@ -0,0 +1,372 @@
+/* Implements loading of the assembler output files: the files are mapped into memory, and decoded in a single scan */
+/* for posix_madvise, to read the mapped files ahead */
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "object_file.h"
+#include "data_image.h"
+#include "utils.h"
+
+/** The value of a hex digit character, or -1 if it's not one */
+static const signed char hex_values[256] = {
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+/** Whether a character separates the fields of the files */
+#define IS_BLANK(c) ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')
+
+/**
+ * Parses a non-negative decimal number, after the blanks before it
+ * @param text The text, advanced past the number
+ * @param end The end of the text
+ * @param value The destination value
+ * @return Whether there was a number
+ */
+static bool parse_decimal(unsigned char** text, unsigned char* end, long* value);
+
+/**
+ * Decodes the rows of the .ob file into the image: each row is an address and up to 4 hex bytes.
+ * The rows are decoded through the hex table, with no per-byte calls.
+ * @param text The text after the header, advanced past the rows
+ * @param end The end of the text
+ * @param image The destination image
+ * @param size The bytes count of the image
+ * @return The count of the decoded bytes, less than size if the rows are too short or invalid
+ */
+static long decode_rows(unsigned char** text, unsigned char* end, unsigned char* image, long size);
+
+/**
+ * Parses symbol lines: each one is a symbol name and an address, or the addresses of a grouped line - each one
+ * either an address or the distance from the address before it, as +N. Stops at the end of the text,
+ * or at a line that starts with '.' - the header of the next section.
+ * @param text The text, advanced past the symbol lines
+ * @param end The end of the text
+ * @param symbols The destination of the allocated symbols array
+ * @param count The destination of the symbols count
+ * @return Whether all the lines are valid
+ */
+static bool parse_symbols(unsigned char** text, unsigned char* end, object_symbol** symbols, long* count);
+
+/**
+ * Deallocates the names of symbols. the symbols of a grouped line are next to each other, and share their name.
+ * @param symbols The symbols
+ * @param count The symbols count
+ */
+static void free_symbols(object_symbol* symbols, long count);
+
+/**
+ * Loads a symbols file (.ent or .ext).
+ * A missing file has no symbols, as the assembler doesn't write empty files.
+ * @param filename The file name
+ * @param symbols The destination of the allocated symbols array
+ * @param count The destination of the symbols count
+ * @return Whether succeeded
+ */
+static bool load_symbols_file(char* filename, object_symbol** symbols, long* count);
+
+/**
+ * Loads the .ent, .ext and .rel sections that follow the rows, in the output of --sections
+ * @param text The text after the rows
+ * @param end The end of the text
+ * @param obj The object file
+ * @param filename The file name, for the error messages
+ * @return Whether succeeded
+ */
+static bool load_sections(unsigned char* text, unsigned char* end, object_file* obj, char* filename);
+
+bool load_object_file(char* filename, object_file* obj, bool with_symbols){
+	data_file file;
+	unsigned char *text, *end;
+	long base_length;
+	char *base_name, *symbols_filename;
+	bool result, has_sections;
+
+	memset(obj, 0, sizeof(object_file));
+	if (!open_data_file(filename, &file)) {
+		printf("Error: cannot open the file: %s.\n", filename);
+		return FALSE;
+	}
+	if (file.bytes != NULL) {
+		posix_madvise(file.bytes, (size_t) file.size, POSIX_MADV_SEQUENTIAL);
+	}
+	text = file.bytes;
+	end = file.bytes + file.size;
+	/* the header is the code and data sizes */
+	if (!parse_decimal(&text, end, &obj->code_size) || !parse_decimal(&text, end, &obj->data_size) ||
+			obj->code_size + obj->data_size > file.size) {
+		printf("Error: invalid header in %s.\n", filename);
+		close_data_file(&file);
+		return FALSE;
+	}
+	/* a single buffer, with the data image right after the code image as in memory */
+	obj->code = (unsigned char *) malloc_with_check(obj->code_size + obj->data_size + 1);
+	obj->data = obj->code + obj->code_size;
+	if (decode_rows(&text, end, obj->code, obj->code_size + obj->data_size) < obj->code_size + obj->data_size) {
+		printf("Error: %s is shorter than it's header.\n", filename);
+		close_data_file(&file);
+		free_object_file(obj);
+		return FALSE;
+	}
+	while (text < end && IS_BLANK(*text)) {
+		text++;
+	}
+	has_sections = text < end && *text == '.';
+	result = !with_symbols || !has_sections || load_sections(text, end, obj, filename);
+	close_data_file(&file);
+	if (!with_symbols || has_sections) {
+		if (!result) {
+			free_object_file(obj);
+		}
+		return result;
+	}
+
+	/* the symbols files have the same name, with another extension */
+	base_length = strlen(filename);
+	if (base_length > 3 && strcmp(filename + base_length - 3, ".ob") == 0) {
+		base_length -= 3;
+	}
+	base_name = (char *) malloc_with_check(base_length + 1);
+	strncpy(base_name, filename, base_length);
+	base_name[base_length] = '\0';
+
+	symbols_filename = strconcat(base_name, ".ent");
+	result = load_symbols_file(symbols_filename, &obj->entries, &obj->entry_count);
+	free(symbols_filename);
+	if (result) {
+		symbols_filename = strconcat(base_name, ".ext");
+		result = load_symbols_file(symbols_filename, &obj->externals, &obj->external_count);
+		free(symbols_filename);
+	}
+	if (result) {
+		symbols_filename = strconcat(base_name, ".rel");
+		result = load_symbols_file(symbols_filename, &obj->relocations, &obj->relocation_count);
+		free(symbols_filename);
+	}
+	free(base_name);
+	if (!result) {
+		free_object_file(obj);
+	}
+	return result;
+}
+
+void relocate_object_file(object_file* obj, long base){
+	long i, offset, distance = base - IC_INIT_VALUE;
+	unsigned long word;
+
+	for (i = 0; i < obj->relocation_count; i++) {
+		offset = obj->relocations[i].address - IC_INIT_VALUE;
+		if (offset < 0 || offset + 4 > obj->code_size) {
+			continue;
+		}
+		/* the address field is the low 25 bits of the little endian word */
+		word = (unsigned long) obj->code[offset] | ((unsigned long) obj->code[offset + 1] << 8) |
+				((unsigned long) obj->code[offset + 2] << 16) | ((unsigned long) obj->code[offset + 3] << 24);
+		word = (word & ~0x1FFFFFFUL) | ((word + distance) & 0x1FFFFFFUL);
+		obj->code[offset] = word & 0xFF;
+		obj->code[offset + 1] = (word >> 8) & 0xFF;
+		obj->code[offset + 2] = (word >> 16) & 0xFF;
+		obj->code[offset + 3] = (word >> 24) & 0xFF;
+		obj->relocations[i].address += distance;
+	}
+	for (i = 0; i < obj->entry_count; i++) {
+		obj->entries[i].address += distance;
+	}
+	for (i = 0; i < obj->external_count; i++) {
+		obj->externals[i].address += distance;
+	}
+}
+
+void free_object_file(object_file* obj){
+	free_symbols(obj->entries, obj->entry_count);
+	free_symbols(obj->externals, obj->external_count);
+	free_symbols(obj->relocations, obj->relocation_count);
+	free(obj->entries);
+	free(obj->externals);
+	free(obj->relocations);
+	free(obj->code); /* the data image is in the same buffer */
+	memset(obj, 0, sizeof(object_file));
+}
+
+static bool parse_decimal(unsigned char** text, unsigned char* end, long* value){
+	unsigned char* p = *text;
+	while (p < end && IS_BLANK(*p)) {
+		p++;
+	}
+	if (p == end || *p < '0' || *p > '9') {
+		return FALSE;
+	}
+	for (*value = 0; p < end && *p >= '0' && *p <= '9'; p++) {
+		*value = *value * 10 + (*p - '0');
+	}
+	*text = p;
+	return TRUE;
+}
+
+static long decode_rows(unsigned char** text, unsigned char* end, unsigned char* image, long size){
+	unsigned char* p = *text;
+	long i = 0;
+	int column;
+	signed char high, low;
+
+	while (i < size) {
+		/* the address isn't needed, the rows are in the order of the image */
+		while (p < end && IS_BLANK(*p)) {
+			p++;
+		}
+		if (p == end || *p < '0' || *p > '9') {
+			break;
+		}
+		while (p < end && *p >= '0' && *p <= '9') {
+			p++;
+		}
+		for (column = 0; column < 4 && i < size; column++) {
+			if (end - p < 3 || p[0] != ' ') {
+				break;
+			}
+			high = hex_values[p[1]];
+			low = hex_values[p[2]];
+			if ((high | low) < 0) {
+				break;
+			}
+			image[i++] = (unsigned char) ((high << 4) | low);
+			p += 3;
+		}
+		/* a short row is the last one */
+		if (column < 4) {
+			break;
+		}
+	}
+	*text = p;
+	return i;
+}
+
+static bool parse_symbols(unsigned char** text, unsigned char* end, object_symbol** symbols, long* count){
+	unsigned char *p = *text, *name;
+	char* copy;
+	long address, distance, length, capacity = 0;
+	bool is_delta;
+
+	*symbols = NULL;
+	*count = 0;
+	while (TRUE) {
+		while (p < end && IS_BLANK(*p)) {
+			p++;
+		}
+		if (p == end || *p == '.') {
+			break;
+		}
+		for (name = p; p < end && !IS_BLANK(*p); p++)
+			;
+		length = p - name;
+		if (length > MAX_LINE_LENGTH || !parse_decimal(&p, end, &address)) {
+			*text = p;
+			return FALSE;
+		}
+		copy = (char *) malloc_with_check(length + 1);
+		memcpy(copy, name, length);
+		copy[length] = '\0';
+		/* the addresses of the line, all of the same name */
+		do {
+			if (*count == capacity) {
+				capacity = capacity == 0 ? 16 : capacity * 2;
+				*symbols = (object_symbol *) realloc_with_check(*symbols, capacity * sizeof(object_symbol));
+			}
+			(*symbols)[*count].name = copy;
+			(*symbols)[*count].address = address;
+			(*count)++;
+
+			while (p < end && (*p == ' ' || *p == '\t')) {
+				p++;
+			}
+			if (p == end || ((*p < '0' || *p > '9') && *p != '+')) {
+				break;
+			}
+			is_delta = *p == '+';
+			p += is_delta;
+			if (!parse_decimal(&p, end, &distance)) {
+				*text = p;
+				return FALSE;
+			}
+			address = is_delta ? address + distance : distance;
+		} while (TRUE);
+	}
+	*text = p;
+	return TRUE;
+}
+
+static void free_symbols(object_symbol* symbols, long count){
+	long i;
+	for (i = 0; i < count; i++) {
+		if (i == 0 || symbols[i].name != symbols[i - 1].name) {
+			free(symbols[i].name);
+		}
+	}
+}
+
+static bool load_symbols_file(char* filename, object_symbol** symbols, long* count){
+	data_file file;
+	unsigned char* text;
+	bool result;
+
+	*symbols = NULL;
+	*count = 0;
+	if (!open_data_file(filename, &file)) {
+		return TRUE; /* no symbols */
+	}
+	text = file.bytes;
+	result = parse_symbols(&text, file.bytes + file.size, symbols, count) && text == file.bytes + file.size;
+	close_data_file(&file);
+	if (!result) {
+		printf("Error: invalid symbol line in %s.\n", filename);
+	}
+	return result;
+}
+
+static bool load_sections(unsigned char* text, unsigned char* end, object_file* obj, char* filename){
+	object_symbol** symbols;
+	long* count;
+	bool result = TRUE;
+
+	while (result && text < end) {
+		/* a section header line, then it's symbols */
+		if (end - text >= 4 && strncmp((char *) text, ".ent", 4) == 0 && obj->entries == NULL) {
+			symbols = &obj->entries;
+			count = &obj->entry_count;
+		}
+		else if (end - text >= 4 && strncmp((char *) text, ".ext", 4) == 0 && obj->externals == NULL) {
+			symbols = &obj->externals;
+			count = &obj->external_count;
+		}
+		else if (end - text >= 4 && strncmp((char *) text, ".rel", 4) == 0 && obj->relocations == NULL) {
+			symbols = &obj->relocations;
+			count = &obj->relocation_count;
+		}
+		else {
+			printf("Error: invalid section in %s.\n", filename);
+			return FALSE;
+		}
+		text += 4;
+		result = parse_symbols(&text, end, symbols, count);
+	}
+	if (!result) {
+		printf("Error: invalid symbol line in %s.\n", filename);
+	}
+	return result;
+}
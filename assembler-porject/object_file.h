@@ -0,0 +1,52 @@
+/* Loads the output files of the assembler (.ob, .ent, .ext), for the tools that use them */
+#ifndef _OBJECT_FILE_H
+#define _OBJECT_FILE_H
+#include "globals.h"
+
+/* A symbol of an .ent, .ext or .rel file */
+typedef struct object_symbol {
+	char* name; /* shared by the symbols of a grouped line, next to each other */
+	long address; /* the entry address, or the address of the code word that references the external or the symbol */
+} object_symbol;
+
+/* The contents of an assembled file */
+typedef struct object_file {
+	unsigned char* code; /* the code image, that starts at IC_INIT_VALUE */
+	long code_size;
+	unsigned char* data; /* the data image, that starts right after the code image, in the same buffer */
+	long data_size;
+	object_symbol* entries; /* .ent symbols, in file order */
+	long entry_count;
+	object_symbol* externals; /* .ext references, in file order */
+	long external_count;
+	object_symbol* relocations; /* .rel references, the code words that hold an absolute address, in file order */
+	long relocation_count;
+} object_file;
+
+/**
+ * Loads an .ob file, and optionally the .ent, .ext and .rel files of the same name, if exist - or the .ent, .ext
+ * and .rel sections that follow the rows, in the output of --sections. The files are mapped into memory and decoded
+ * in a single scan, so large images load at the speed of reading them. Prints an error message on failure.
+ * @param filename The .ob file name
+ * @param obj The destination object file
+ * @param with_symbols Whether to load the .ent and .ext files too
+ * @return Whether succeeded
+ */
+bool load_object_file(char* filename, object_file* obj, bool with_symbols);
+
+/**
+ * Moves a loaded object file to another address, by it's relocations: the address field of each relocated
+ * code word, the entries and the external references are moved by the distance from IC_INIT_VALUE.
+ * The object file must be loaded with it's symbols.
+ * @param obj The object file
+ * @param base The new address of the code image
+ */
+void relocate_object_file(object_file* obj, long base);
+
+/**
+ * Deallocates all the memory required by a loaded object file.
+ * @param obj The object file
+ */
+void free_object_file(object_file* obj);
+
+#endif
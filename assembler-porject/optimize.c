@@ -0,0 +1,191 @@
+/* Implements the peephole optimizer over the code image */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optimize.h"
+#include "utils.h"
+
+/**
+ * Returns the address of the code label used by a label reference
+ * @param symbol_table The symbol table
+ * @param ref The label reference
+ * @return The address of the label, -1 if it's not a code label (data, external or undefined)
+ */
+static long get_code_target(table symbol_table, label_ref* ref);
+
+/**
+ * Returns whether a code word has no effect at all, regardless of the label operand
+ * @param word The code word
+ * @return Whether it can be removed
+ */
+static bool is_no_op(code_word* word);
+
+/**
+ * Returns whether a code word is a jump to a label (and not to a register)
+ * @param word The code word
+ * @return Whether it's a jump to a label
+ */
+static bool is_label_jump(code_word* word);
+
+/**
+ * Runs a single round of the optimizer: marks the removable code words and redirects jumps to jumps.
+ * @param code_img The code image
+ * @param word_count The code words count
+ * @param symbol_table The symbol table
+ * @param word_refs The label reference of each code word, NULL if none
+ * @param removed The destination of the removal marks of each code word
+ * @return The count of the changes done
+ */
+static long optimize_round(machine_word** code_img, long word_count, table symbol_table, label_ref** word_refs, bool* removed);
+
+void optimize_code_image(machine_word** code_img, long* icf, table symbol_table, label_ref_list* refs, listing* lst){
+	long i, word_count;
+	label_ref** word_refs;
+	bool* removed;
+
+	do {
+		word_count = (*icf - IC_INIT_VALUE) / 4;
+		word_refs = (label_ref **) malloc_with_check((word_count + 1) * sizeof(label_ref *));
+		removed = (bool *) malloc_with_check((word_count + 1) * sizeof(bool));
+		for (i = 0; i < word_count; i++) {
+			word_refs[i] = NULL;
+			removed[i] = FALSE;
+		}
+		/* index the label operands by their code word */
+		for (i = 0; i < refs->count; i++) {
+			if (!refs->refs[i].is_entry) {
+				word_refs[(refs->refs[i].ic - IC_INIT_VALUE) / 4] = &refs->refs[i];
+			}
+		}
+
+		i = optimize_round(code_img, word_count, symbol_table, word_refs, removed);
+		if (i > 0) {
+			remove_code_words(code_img, icf, symbol_table, refs, lst, removed, OPTIMIZER_REMOVAL);
+		}
+		free(word_refs);
+		free(removed);
+	} while (i > 0); /* removing code may create new chances, e.g. a branch that became a branch to next */
+}
+
+static long optimize_round(machine_word** code_img, long word_count, table symbol_table, label_ref** word_refs, bool* removed){
+	long i, j, target, final_target, changes = 0;
+	code_word* word;
+	label_ref* final_ref;
+
+	for (i = 0; i < word_count; i++) {
+		word = code_img[i * 4]->word.code;
+
+		if (is_no_op(word)) {
+			removed[i] = TRUE;
+			changes++;
+			continue;
+		}
+		if (word_refs[i] == NULL || (target = get_code_target(symbol_table, word_refs[i])) < 0) {
+			continue;
+		}
+		/* a branch, or a jump, to the next instruction does nothing either way */
+		if (((word->opcode >= BNE_OP && word->opcode <= BGT_OP) || is_label_jump(word)) && target == IC_INIT_VALUE + (i + 1) * 4) {
+			removed[i] = TRUE;
+			changes++;
+			continue;
+		}
+		/* a jump to a jump - jump directly to the last one in the chain */
+		if (is_label_jump(word)) {
+			final_ref = NULL;
+			final_target = target;
+			for (j = 0; j < MAX_JUMP_CHAIN; j++) {
+				long target_index = (final_target - IC_INIT_VALUE) / 4;
+				long next_target;
+				if (target_index >= word_count || target_index == i || !is_label_jump(code_img[target_index * 4]->word.code) ||
+				    word_refs[target_index] == NULL || (next_target = get_code_target(symbol_table, word_refs[target_index])) < 0 ||
+				    next_target == final_target) {
+					break;
+				}
+				final_ref = word_refs[target_index];
+				final_target = next_target;
+			}
+			/* don't turn a loop of jumps into a jump to itself */
+			if (final_ref != NULL && final_target != IC_INIT_VALUE + i * 4 && strcmp(final_ref->label, word_refs[i]->label) != 0) {
+				free(word_refs[i]->label);
+				word_refs[i]->label = (char *) malloc_with_check(strlen(final_ref->label) + 1);
+				strcpy(word_refs[i]->label, final_ref->label);
+				changes++;
+			}
+		}
+	}
+	return changes;
+}
+
+void remove_code_words(machine_word** code_img, long* icf, table symbol_table, label_ref_list* refs, listing* lst, bool* removed,
+		removal_reason reason){
+	long i, j, word_count = (*icf - IC_INIT_VALUE) / 4;
+	long* new_address = (long *) malloc_with_check((word_count + 1) * sizeof(long));
+	table curr_entry;
+
+	/* compact the code image, and keep the new address of each old one */
+	for (i = 0, j = 0; i < word_count; i++) {
+		new_address[i] = IC_INIT_VALUE + j * 4;
+		if (removed[i]) {
+			free_code_word(code_img[i * 4]);
+		}
+		else {
+			code_img[j * 4] = code_img[i * 4];
+			j++;
+		}
+		code_img[i * 4] = i < j ? code_img[i * 4] : NULL;
+	}
+	new_address[word_count] = IC_INIT_VALUE + j * 4; /* the end of the code */
+	*icf = IC_INIT_VALUE + j * 4;
+
+	/* move the code symbols. the order is kept, so the table stays sorted */
+	for (curr_entry = symbol_table; curr_entry != NULL; curr_entry = curr_entry->next) {
+		if (curr_entry->type == CODE_SYMBOL) {
+			curr_entry->value = new_address[(curr_entry->value - IC_INIT_VALUE) / 4];
+		}
+	}
+
+	/* move the label operands, and drop the ones of the removed code */
+	for (i = 0, j = 0; i < refs->count; i++) {
+		if (!refs->refs[i].is_entry) {
+			long index = (refs->refs[i].ic - IC_INIT_VALUE) / 4;
+			if (removed[index]) {
+				free(refs->refs[i].label);
+				continue;
+			}
+			refs->refs[i].ic = new_address[index];
+		}
+		refs->refs[j++] = refs->refs[i];
+	}
+	refs->count = j;
+
+	/* move the listed lines, and mark the ones of the removed code */
+	for (i = 0; lst != NULL && i < lst->count; i++) {
+		if (lst->lines[i].ic >= 0) {
+			long index = (lst->lines[i].ic - IC_INIT_VALUE) / 4;
+			lst->lines[i].removed = removed[index] ? reason : NOT_REMOVED;
+			lst->lines[i].ic = removed[index] ? -1 : new_address[index];
+		}
+	}
+	free(new_address);
+}
+
+static long get_code_target(table symbol_table, label_ref* ref){
+	table_entry* entry = find_by_types(symbol_table, ref->label, 1, CODE_SYMBOL);
+	return entry == NULL ? -1 : entry->value;
+}
+
+static bool is_no_op(code_word* word){
+	/* move $r,$r */
+	if (word->command == 'r' && word->opcode == MOVE_OP && word->commad_type.r->funct == MOVE_FUNCT) {
+		return word->commad_type.r->rs == word->commad_type.r->rd;
+	}
+	/* addi $r,0,$r / subi $r,0,$r / ori $r,0,$r */
+	if (word->opcode == ADDI_OP || word->opcode == SUBI_OP || word->opcode == ORI_OP) {
+		return word->commad_type.i->immed == 0 && word->commad_type.i->rs == word->commad_type.i->rt;
+	}
+	return FALSE;
+}
+
+static bool is_label_jump(code_word* word){
+	return word->opcode == JMP_OP && word->commad_type.j->reg == 0;
+}
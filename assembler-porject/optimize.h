@@ -0,0 +1,40 @@
+/* Peephole optimization of the code image, between the first and the second pass */
+#ifndef _OPTIMIZE_H
+#define _OPTIMIZE_H
+
+#include "globals.h"
+#include "table.h"
+#include "listing.h"
+
+/** Maximum jumps to follow when redirecting a jump to a jump */
+#define MAX_JUMP_CHAIN 32
+
+/**
+ * Optimizes the code image after the first pass: removes instructions without effect (move of a register to itself,
+ * adding/subtracting/or-ing 0 into the same register, branch or jump to the next instruction), and redirects jumps
+ * to jumps into their final target. Repeated until nothing changes.
+ * The code symbols and the label references are moved to the new addresses, so the second pass encodes the labels
+ * (and the branch distances) by the optimized code.
+ * @param code_img The code image
+ * @param icf A pointer to the final code counter, updated by the removed instructions
+ * @param symbol_table The symbol table, where the data symbols are still relative to the data image
+ * @param refs The label references collected by the first pass
+ * @param lst The listing, whose code addresses are moved too, NULL if no listing
+ */
+void optimize_code_image(machine_word** code_img, long* icf, table symbol_table, label_ref_list* refs, listing* lst);
+
+/**
+ * Removes the marked code words from the code image, and moves the code symbols, the label references
+ * and the listed lines to the new addresses. The symbols of a removed code word move to the next code word.
+ * @param code_img The code image
+ * @param icf A pointer to the final code counter
+ * @param symbol_table The symbol table
+ * @param refs The label references
+ * @param lst The listing, NULL if none
+ * @param removed The removal marks of each code word
+ * @param reason Why the code words are removed, for the listed lines
+ */
+void remove_code_words(machine_word** code_img, long* icf, table symbol_table, label_ref_list* refs, listing* lst, bool* removed,
+		removal_reason reason);
+
+#endif
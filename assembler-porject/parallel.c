@@ -0,0 +1,42 @@
+/* Implements the threads helpers with POSIX threads */
+#define _POSIX_C_SOURCE 200112L
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+
+/* Guards the state shared by the files processed together */
+static pthread_mutex_t shared_state_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int get_processor_count(void){
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count < 1 ? 1 : count > MAX_THREADS ? MAX_THREADS : (int) count;
+}
+
+void run_in_threads(void* tasks, int task_count, long task_size, void* (*func)(void*)){
+	pthread_t threads[MAX_THREADS];
+	int i, started;
+
+	if (task_count == 1) {
+		func(tasks);
+		return;
+	}
+	for (started = 0; started < task_count && started < MAX_THREADS; started++) {
+		if (pthread_create(&threads[started], NULL, func, (char *) tasks + started * task_size) != 0) {
+			break;
+		}
+	}
+	for (i = started; i < task_count; i++) {
+		func((char *) tasks + i * task_size);
+	}
+	for (i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+}
+
+void lock_shared_state(void){
+	pthread_mutex_lock(&shared_state_lock);
+}
+
+void unlock_shared_state(void){
+	pthread_mutex_unlock(&shared_state_lock);
+}
@@ -0,0 +1,34 @@
+/* Runs independent tasks in threads, for the stages that split their work into chunks */
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+/** Maximum threads to use */
+#define MAX_THREADS 64
+
+/**
+ * Returns the count of the online processors
+ * @return The processors count, at least 1
+ */
+int get_processor_count(void);
+
+/**
+ * Runs a function over all the tasks, each in it's own thread, and waits for all of them.
+ * A single task, and tasks that didn't get a thread, run in the calling thread.
+ * @param tasks The tasks array
+ * @param task_count The tasks count, up to MAX_THREADS
+ * @param task_size The size of a single task
+ * @param func The function to run, with a pointer to it's task
+ */
+void run_in_threads(void* tasks, int task_count, long task_size, void* (*func)(void*));
+
+/**
+ * Locks the state that's shared by the files processed together, like the cache of the included files
+ */
+void lock_shared_state(void);
+
+/**
+ * Unlocks the state that's shared by the files processed together
+ */
+void unlock_shared_state(void);
+
+#endif
@@ -0,0 +1,458 @@
+/* Implements the source reader, with the macro (pre-assembler) stage and the .include directive */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reader.h"
+#include "utils.h"
+#include "parallel.h"
+
+/* The cache of the included files, shared by all the processed files */
+static included_file* include_cache = NULL;
+
+/**
+ * Copies the next white-separated token of a line into the destination.
+ * @param content The line content
+ * @param i The index to start from
+ * @param dest The destination buffer, at least as long as the line
+ * @return The index right after the token
+ */
+static int get_token(char* content, int i, char* dest);
+
+/**
+ * Returns the hash of a macro name, used as index of the macros table
+ * @param name The macro name
+ * @return The index in the macros table
+ */
+static unsigned int hash_macro_name(char* name);
+
+/**
+ * Finds a macro by it's name
+ * @param reader The source reader
+ * @param name The macro name
+ * @return The macro if defined, NULL if not found
+ */
+static macro* find_macro(source_reader* reader, char* name);
+
+/**
+ * Starts a new macro definition by the rest of a "mcro" line, and prints errors if needed.
+ * @param reader The source reader
+ * @param line The current source line info
+ * @param i The index right after the "mcro" word
+ */
+static void start_macro_definition(source_reader* reader, line_info line, int i);
+
+/**
+ * Reads the next line from the top included file, or from the source file if no file is included.
+ * Lines that are too long are reported and skipped.
+ * @param reader The source reader
+ * @param line The destination line info
+ * @return Whether a line was read, FALSE on end of the source file
+ */
+static bool read_raw_line(source_reader* reader, line_info* line);
+
+/**
+ * Processes the rest of an .include line, and starts reading the included file.
+ * @param reader The source reader
+ * @param line The current source line info
+ * @param i The index right after the ".include" word
+ */
+static void include_file(source_reader* reader, line_info line, int i);
+
+/**
+ * Returns an included file from the cache, reading it into the cache if it's the first time.
+ * @param name The file name
+ * @return The cached file, NULL if the file can't be opened
+ */
+static included_file* get_included_file(char* name);
+
+/**
+ * Allocates a stored copy of a source line
+ * @param content The line content, or NULL for a line which is too long
+ * @return The stored line
+ */
+static source_line* new_source_line(char* content);
+
+void init_source_reader(source_reader* reader, FILE* file, char* file_name, struct diagnostics* diag){
+	reader->file = file;
+	reader->file_name = file_name;
+	reader->line_number = 0;
+	reader->buffer[0] = '\0';
+	memset(reader->macros, 0, sizeof(reader->macros));
+	reader->defining = NULL;
+	reader->expanding = NULL;
+	reader->call_line_number = 0;
+	reader->call_file_name = file_name;
+	reader->include_depth = 0;
+	reader->included = NULL;
+	reader->failed = FALSE;
+	reader->diag = diag;
+}
+
+bool read_source_line(source_reader* reader, line_info* line){
+	char token[MAX_LINE_LENGTH + 2];
+	macro* mac;
+	source_line* body_line;
+	int i;
+
+	line->content = reader->buffer;
+	line->diag = reader->diag;
+
+	while (TRUE) {
+		/* in the middle of a macro call, hand the next body line */
+		if (reader->expanding != NULL) {
+			strcpy(reader->buffer, reader->expanding->content);
+			reader->expanding = reader->expanding->next;
+			line->file_name = reader->call_file_name;
+			line->line_number = reader->call_line_number;
+			return TRUE;
+		}
+
+		if (!read_raw_line(reader, line)) {
+			if (reader->defining != NULL) {
+				print_error(*line, MACRO_ERR, "Missing endmcro for macro %s.", reader->defining->name);
+				reader->defining = NULL;
+				reader->failed = TRUE;
+			}
+			return FALSE; /* end of file */
+		}
+
+		i = get_token(reader->buffer, 0, token);
+
+		/* inside a macro definition, store the line in the body until endmcro */
+		if (reader->defining != NULL) {
+			if (strcmp(token, "endmcro") == 0) {
+				get_token(reader->buffer, i, token);
+				if (token[0] != '\0') {
+					print_error(*line, MACRO_ERR, "Extraneous text after endmcro.");
+					reader->failed = TRUE;
+				}
+				reader->defining = NULL;
+			}
+			else if (strcmp(token, "mcro") == 0) {
+				print_error(*line, MACRO_ERR, "Nested macro definitions are not allowed.");
+				reader->failed = TRUE;
+			}
+			else {
+				body_line = new_source_line(reader->buffer);
+				if (reader->defining->body_end == NULL) {
+					reader->defining->body = body_line;
+				}
+				else {
+					reader->defining->body_end->next = body_line;
+				}
+				reader->defining->body_end = body_line;
+			}
+			continue;
+		}
+
+		if (strcmp(token, "mcro") == 0) {
+			start_macro_definition(reader, *line, i);
+			continue;
+		}
+		if (strcmp(token, "endmcro") == 0) {
+			print_error(*line, MACRO_ERR, "endmcro without a macro definition.");
+			reader->failed = TRUE;
+			continue;
+		}
+		if (strcmp(token, ".include") == 0) {
+			include_file(reader, *line, i);
+			continue;
+		}
+		/* a line with only a macro name is a call - expand it from the next iteration */
+		if (token[0] != '\0' && (mac = find_macro(reader, token)) != NULL) {
+			get_token(reader->buffer, i, token);
+			if (token[0] == '\0') {
+				reader->expanding = mac->body;
+				reader->call_file_name = line->file_name;
+				reader->call_line_number = line->line_number;
+				continue;
+			}
+		}
+		return TRUE;
+	}
+}
+
+void free_source_reader(source_reader* reader){
+	int i;
+	macro *mac, *next_mac;
+	source_line *body_line, *next_line;
+	include_ref *ref, *next_ref;
+
+	for (i = 0; i < MACRO_TABLE_SIZE; i++) {
+		for (mac = reader->macros[i]; mac != NULL; mac = next_mac) {
+			next_mac = mac->next;
+			for (body_line = mac->body; body_line != NULL; body_line = next_line) {
+				next_line = body_line->next;
+				free(body_line->content);
+				free(body_line);
+			}
+			free(mac->name);
+			free(mac);
+		}
+		reader->macros[i] = NULL;
+	}
+	for (ref = reader->included; ref != NULL; ref = next_ref) {
+		next_ref = ref->next;
+		free(ref);
+	}
+	reader->included = NULL;
+}
+
+void free_include_cache(void){
+	included_file* next_file;
+	source_line *curr_line, *next_line;
+
+	while (include_cache != NULL) {
+		next_file = include_cache->next;
+		for (curr_line = include_cache->lines; curr_line != NULL; curr_line = next_line) {
+			next_line = curr_line->next;
+			free(curr_line->content);
+			free(curr_line);
+		}
+		free(include_cache->name);
+		free(include_cache);
+		include_cache = next_file;
+	}
+}
+
+static bool read_raw_line(source_reader* reader, line_info* line){
+	include_frame* frame;
+	source_line* cached;
+	int temp_c;
+
+	while (TRUE) {
+		/* lines of an included file come from the cache */
+		if (reader->include_depth > 0) {
+			frame = &reader->includes[reader->include_depth - 1];
+			if (frame->next_line == NULL) {
+				reader->include_depth--; /* done with this file, back to the includer */
+				continue;
+			}
+			cached = frame->next_line;
+			frame->next_line = cached->next;
+			line->file_name = frame->file->name;
+			line->line_number = ++(frame->line_number);
+			if (cached->content == NULL) {
+				print_error(*line, LINE_TOO_LONG_ERR, "Line too long to process. Maximum line length should be %d.", MAX_LINE_LENGTH);
+				reader->failed = TRUE;
+				continue;
+			}
+			strcpy(reader->buffer, cached->content);
+			return TRUE;
+		}
+
+		line->file_name = reader->file_name;
+		line->line_number = reader->line_number;
+		if (fgets(reader->buffer, MAX_LINE_LENGTH + 2, reader->file) == NULL) {
+			return FALSE;
+		}
+		line->line_number = ++(reader->line_number);
+
+		if (strchr(reader->buffer, '\n') == NULL && !feof(reader->file)) {
+			/* print message and prevent further line processing, as well as second pass. */
+			print_error(*line, LINE_TOO_LONG_ERR, "Line too long to process. Maximum line length should be %d.", MAX_LINE_LENGTH);
+			reader->failed = TRUE;
+			/* skip leftovers */
+			do {
+				temp_c = fgetc(reader->file);
+			} while (temp_c != '\n' && temp_c != EOF);
+			continue;
+		}
+		return TRUE;
+	}
+}
+
+static void include_file(source_reader* reader, line_info line, int i){
+	char name[MAX_LINE_LENGTH + 2];
+	char* closing_quote;
+	included_file* file;
+	include_ref* ref;
+	int j;
+
+	SKIP_TO_NOT_WHITE(line.content, i)
+	if (line.content[i] != '"' || (closing_quote = strchr(line.content + i + 1, '"')) == NULL) {
+		print_error_at(line, i, INCLUDE_ERR, "Expected a quoted file name for .include.");
+		reader->failed = TRUE;
+		return;
+	}
+	for (i++, j = 0; line.content + i != closing_quote; i++, j++) {
+		name[j] = line.content[i];
+	}
+	name[j] = '\0';
+	i++;
+	SKIP_TO_NOT_WHITE(line.content, i)
+	if (line.content[i] && line.content[i] != '\n' && line.content[i] != EOF) {
+		print_error_at(line, i, INCLUDE_ERR, "Extraneous text after .include file name.");
+		reader->failed = TRUE;
+		return;
+	}
+
+	/* the files checked together share the cache */
+	lock_shared_state();
+	file = get_included_file(name);
+	unlock_shared_state();
+	if (file == NULL) {
+		print_error(line, INCLUDE_ERR, "Cannot open the included file: %s", name);
+		reader->failed = TRUE;
+		return;
+	}
+	/* an include cycle can never end */
+	for (j = 0; j < reader->include_depth; j++) {
+		if (reader->includes[j].file == file) {
+			print_error(line, INCLUDE_ERR, "Recursive include of %s.", name);
+			reader->failed = TRUE;
+			return;
+		}
+	}
+	/* include guard - each file is included once by a source, like shared definitions should */
+	for (ref = reader->included; ref != NULL; ref = ref->next) {
+		if (ref->file == file) {
+			return;
+		}
+	}
+	if (reader->include_depth == MAX_INCLUDE_DEPTH) {
+		print_error(line, INCLUDE_ERR, "Too many nested includes. Maximum depth is %d.", MAX_INCLUDE_DEPTH);
+		reader->failed = TRUE;
+		return;
+	}
+
+	ref = (include_ref *) malloc_with_check(sizeof(include_ref));
+	ref->file = file;
+	ref->next = reader->included;
+	reader->included = ref;
+
+	reader->includes[reader->include_depth].file = file;
+	reader->includes[reader->include_depth].next_line = file->lines;
+	reader->includes[reader->include_depth].line_number = 0;
+	reader->include_depth++;
+}
+
+static included_file* get_included_file(char* name){
+	char temp_line[MAX_LINE_LENGTH + 2];
+	included_file* file;
+	source_line *curr_line, *last_line = NULL;
+	FILE* file_des;
+	int temp_c;
+
+	for (file = include_cache; file != NULL; file = file->next) {
+		if (strcmp(file->name, name) == 0) {
+			return file;
+		}
+	}
+
+	if ((file_des = fopen(name, "r")) == NULL) {
+		return NULL;
+	}
+	file = (included_file *) malloc_with_check(sizeof(included_file));
+	file->name = (char *) malloc_with_check(strlen(name) + 1);
+	strcpy(file->name, name);
+	file->lines = NULL;
+
+	/* read the whole file once. lines which are too long are kept as empty, to be reported by each includer */
+	while (fgets(temp_line, MAX_LINE_LENGTH + 2, file_des) != NULL) {
+		if (strchr(temp_line, '\n') == NULL && !feof(file_des)) {
+			curr_line = new_source_line(NULL);
+			do {
+				temp_c = fgetc(file_des);
+			} while (temp_c != '\n' && temp_c != EOF);
+		}
+		else {
+			curr_line = new_source_line(temp_line);
+		}
+		if (last_line == NULL) {
+			file->lines = curr_line;
+		}
+		else {
+			last_line->next = curr_line;
+		}
+		last_line = curr_line;
+	}
+	fclose(file_des);
+
+	file->next = include_cache;
+	include_cache = file;
+	return file;
+}
+
+static source_line* new_source_line(char* content){
+	source_line* new_line = (source_line *) malloc_with_check(sizeof(source_line));
+	new_line->next = NULL;
+	new_line->content = NULL;
+	if (content != NULL) {
+		new_line->content = (char *) malloc_with_check(strlen(content) + 1);
+		strcpy(new_line->content, content);
+	}
+	return new_line;
+}
+
+static void start_macro_definition(source_reader* reader, line_info line, int i){
+	char name[MAX_LINE_LENGTH + 2], rest[MAX_LINE_LENGTH + 2];
+	macro* mac;
+	unsigned int index;
+
+	i = get_token(line.content, i, name);
+	get_token(line.content, i, rest);
+
+	if (name[0] == '\0') {
+		print_error(line, MACRO_ERR, "Missing macro name after mcro.");
+	}
+	else if (rest[0] != '\0') {
+		print_error(line, MACRO_ERR, "Extraneous text after macro name %s.", name);
+	}
+	else if (!is_valid_label_name(name)) {
+		print_error(line, MACRO_ERR, "Illegal macro name: %s", name);
+	}
+	else if (find_macro(reader, name) != NULL) {
+		print_error(line, MACRO_ERR, "Macro %s is already defined.", name);
+	}
+	else {
+		mac = (macro *) malloc_with_check(sizeof(macro));
+		mac->name = (char *) malloc_with_check(strlen(name) + 1);
+		strcpy(mac->name, name);
+		mac->body = mac->body_end = NULL;
+		index = hash_macro_name(name);
+		mac->next = reader->macros[index];
+		reader->macros[index] = mac;
+		reader->defining = mac;
+		return;
+	}
+
+	/* invalid definition - still skip it's body, but into an anonymous macro that isn't callable */
+	reader->failed = TRUE;
+	mac = (macro *) malloc_with_check(sizeof(macro));
+	mac->name = (char *) malloc_with_check(1);
+	mac->name[0] = '\0';
+	mac->body = mac->body_end = NULL;
+	index = hash_macro_name(mac->name);
+	mac->next = reader->macros[index];
+	reader->macros[index] = mac;
+	reader->defining = mac;
+}
+
+static int get_token(char* content, int i, char* dest){
+	int j;
+	SKIP_TO_NOT_WHITE(content, i)
+	for (j = 0; content[i] && content[i] != '\n' && content[i] != '\t' && content[i] != ' ' && content[i] != EOF; i++, j++) {
+		dest[j] = content[i];
+	}
+	dest[j] = '\0';
+	return i;
+}
+
+static unsigned int hash_macro_name(char* name){
+	unsigned int hash = 0;
+	for (; *name; name++) {
+		hash = hash * 31 + (unsigned char) *name;
+	}
+	return hash % MACRO_TABLE_SIZE;
+}
+
+static macro* find_macro(source_reader* reader, char* name){
+	macro* mac;
+	for (mac = reader->macros[hash_macro_name(name)]; mac != NULL; mac = mac->next) {
+		if (strcmp(mac->name, name) == 0) {
+			return mac;
+		}
+	}
+	return NULL;
+}
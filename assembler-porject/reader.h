@@ -0,0 +1,96 @@
+/* Reads the source lines for the passes, expanding macros and included files on the fly */
+#ifndef _READER_H
+#define _READER_H
+#include <stdio.h>
+#include "globals.h"
+
+/** Size of the macro names hash table */
+#define MACRO_TABLE_SIZE 64
+
+/** Maximum nesting of .include directives */
+#define MAX_INCLUDE_DEPTH 16
+
+/* A single stored source line, of a macro body or of an included file */
+typedef struct source_line {
+	struct source_line* next;
+	char* content; /* NULL if the line was too long */
+} source_line;
+
+/* A macro definition: the name, and the body lines which are stored only once */
+typedef struct macro {
+	struct macro* next; /* next macro in the same hash bucket */
+	char* name;
+	source_line* body;
+	source_line* body_end; /* last body line, for appending */
+} macro;
+
+/* A file read by .include. read once per process, and handed again from the cache to every includer. the lines are
+ * kept as text, as the macros and the symbols they refer to are of the includer */
+typedef struct included_file {
+	struct included_file* next; /* next file in the cache */
+	char* name;
+	source_line* lines;
+} included_file;
+
+/* An included file that is being read */
+typedef struct include_frame {
+	included_file* file;
+	source_line* next_line; /* the next line to hand, NULL if done */
+	long line_number; /* last line number read from the file */
+} include_frame;
+
+/* A file that was already included by the current source */
+typedef struct include_ref {
+	struct include_ref* next;
+	included_file* file;
+} include_ref;
+
+/* The state of the source reader of a single file */
+typedef struct source_reader {
+	FILE* file;
+	char* file_name;
+	long line_number; /* last line number read from the file */
+	char buffer[MAX_LINE_LENGTH + 2]; /* the line handed to the passes */
+	macro* macros[MACRO_TABLE_SIZE]; /* the defined macros, by hash of name */
+	macro* defining; /* the macro that its body is being read, NULL if none */
+	source_line* expanding; /* the next line of the macro being expanded, NULL if none */
+	long call_line_number; /* line number of the macro call being expanded */
+	char* call_file_name; /* file name of the macro call being expanded */
+	include_frame includes[MAX_INCLUDE_DEPTH]; /* the stack of the included files being read */
+	int include_depth;
+	include_ref* included; /* files already included, which are not included again */
+	bool failed; /* whether an error was found while reading */
+	struct diagnostics* diag; /* where the errors of the read lines are collected */
+} source_reader;
+
+/**
+ * Initializes a source reader for an opened file
+ * @param reader The reader to initialize
+ * @param file The opened source file
+ * @param file_name The file name for error messages
+ * @param diag Where the errors of the read lines are collected, NULL to print them right away
+ */
+void init_source_reader(source_reader* reader, FILE* file, char* file_name, struct diagnostics* diag);
+
+/**
+ * Reads the next source line to process, after macro expansion and includes.
+ * Macro definitions are stored and not returned, macro calls are replaced by the macro body,
+ * and .include lines are replaced by the lines of the included file.
+ * @param reader The source reader
+ * @param line The destination line info. it's content points to the reader buffer
+ * @return Whether a line was read, FALSE on end of file
+ */
+bool read_source_line(source_reader* reader, line_info* line);
+
+/**
+ * Deallocates all the memory required by the reader (not closing the file).
+ * @param reader The source reader
+ */
+void free_source_reader(source_reader* reader);
+
+/**
+ * Deallocates the cache of the included files, when no more files are processed.
+ */
+void free_include_cache(void);
+
+#endif
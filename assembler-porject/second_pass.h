@@ -1,4 +1,4 @@
-/* Second pass line processing functions */
+/* Second pass processing functions */
 #ifndef _SECOND_PASS_H
 #define _SECOND_PASS_H
 
@@ -6,16 +6,16 @@
 #include "table.h"
 
 /**
- * Processes a single source line in the second pass
- * @param line The current source line info
- * @param ic A pointer to the current code counter
- * @param code_img The code image
+ * Processes the labels used by the source in the second pass, in source order:
+ * encodes the label operands into the code image, and adds the entries and the external references to the symbol table.
+ * @param refs The label references, collected by the first pass
+ * @param code_img The code image, NULL to only check that the labels are defined - for --check
  * @param symbol_table The symbol table
  * @return Whether succeeded
  */
-bool process_line_sp(line_info line, long* ic, machine_word** code_img, table* symbol_table);
+bool process_label_refs_sp(label_ref_list* refs, machine_word** code_img, table* symbol_table);
 
 
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,84 @@
+/* Runs an assembled .ob file on the simulated CPU, and prints the instructions and cycles report */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "globals.h"
+#include "machine.h"
+#include "object_file.h"
+#include "debug_map.h"
+#include "utils.h"
+
+/**
+ * Prints the source line of an address, by the .dbg file next to the object, if there's one
+ * @param filename The object file name
+ * @param address The address
+ */
+static void print_source_line(char* filename, long address);
+
+int main(int argc, char *argv[]){
+	int i;
+	char* filename = NULL;
+	unsigned long max_steps = 0;
+	object_file obj;
+	machine mach;
+	clock_t start;
+	bool result;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc) {
+			max_steps = strtoul(argv[++i], NULL, 10);
+		}
+		else if (argv[i][0] != '-' && filename == NULL) {
+			filename = argv[i];
+		}
+		else {
+			printf("Usage: %s [--max-steps N] file.ob\n", argv[0]);
+			return 1;
+		}
+	}
+	if (filename == NULL) {
+		printf("Missing input file. Please enter an .ob file.\n");
+		return 1;
+	}
+
+	if (!load_object_file(filename, &obj, FALSE)) {
+		return 1;
+	}
+	result = load_machine(&mach, obj.code, obj.code_size, obj.data, obj.data_size);
+	free_object_file(&obj);
+	if (!result) {
+		printf("Error: the images of %s don't fit into the memory.\n", filename);
+		return 1;
+	}
+
+	start = clock();
+	result = run_machine(&mach, max_steps);
+	print_machine_report(&mach, (double) (clock() - start) / CLOCKS_PER_SEC, stdout);
+	if (mach.error != NULL) {
+		print_source_line(filename, mach.error_address);
+	}
+	free_machine(&mach);
+	return result ? 0 : 1;
+}
+
+static void print_source_line(char* filename, long address){
+	debug_map map;
+	char *map_filename, *file_name;
+	long length = strlen(filename), line_number;
+
+	/* the map of file.ob is file.dbg */
+	map_filename = (char *) malloc_with_check(length + 5);
+	strcpy(map_filename, filename);
+	if (length > 3 && strcmp(filename + length - 3, ".ob") == 0) {
+		map_filename[length - 3] = '\0';
+	}
+	strcat(map_filename, ".dbg");
+	if (load_debug_map(map_filename, &map)) {
+		if (find_source_line(&map, address, &file_name, &line_number)) {
+			printf("Source of the error: %s:%ld\n", file_name, line_number);
+		}
+		free_debug_map(&map);
+	}
+	free(map_filename);
+}
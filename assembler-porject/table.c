@@ -6,6 +6,9 @@
 #include "table.h"
 #include "utils.h"
 
+/* Compares two indexed entries by key, then by position, for qsort */
+static int compare_indexed_entries(const void* first, const void* second);
+
 void add_value_to_type(table tab, long to_add, symbol_type type) {
 	table curr_entry;
 	/* for each entry, add value to_add if same type */
@@ -110,4 +113,67 @@ void free_table(table tab) {
 		free(prev_entry->key); 
 		free(prev_entry);
 	}
-}
\ No newline at end of file
+}
+
+void build_table_index(table tab, table_index* index, int symbol_count, ...){
+	int i;
+	long position, count = 0;
+	symbol_type valid_symbol_types[ENTRY_SYMBOL + 1];
+	bool is_valid[ENTRY_SYMBOL + 1] = {FALSE};
+	table curr_entry;
+	va_list arglist;
+
+	va_start(arglist, symbol_count);
+	for (i = 0; i < symbol_count; i++) {
+		valid_symbol_types[i] = va_arg(arglist, symbol_type);
+		is_valid[valid_symbol_types[i]] = TRUE;
+	}
+	va_end(arglist);
+
+	for (curr_entry = tab; curr_entry != NULL; curr_entry = curr_entry->next) {
+		count += is_valid[curr_entry->type];
+	}
+	index->entries = (indexed_entry *) malloc_with_check((count + 1) * sizeof(indexed_entry));
+	index->count = count;
+	for (curr_entry = tab, position = 0, count = 0; curr_entry != NULL; curr_entry = curr_entry->next, position++) {
+		if (is_valid[curr_entry->type]) {
+			index->entries[count].entry = curr_entry;
+			index->entries[count++].position = position;
+		}
+	}
+	qsort(index->entries, index->count, sizeof(indexed_entry), compare_indexed_entries);
+}
+
+table_entry* find_in_index(table_index* index, char* key){
+	long low = 0, high = index->count, middle;
+	/* the first entry of the key, which is the first of it in the table */
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (strcmp(index->entries[middle].entry->key, key) < 0) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	if (low < index->count && strcmp(index->entries[low].entry->key, key) == 0) {
+		return index->entries[low].entry;
+	}
+	return NULL;
+}
+
+void free_table_index(table_index* index){
+	free(index->entries);
+	index->entries = NULL;
+	index->count = 0;
+}
+
+static int compare_indexed_entries(const void* first, const void* second){
+	indexed_entry* entry1 = (indexed_entry *) first;
+	indexed_entry* entry2 = (indexed_entry *) second;
+	int result = strcmp(entry1->entry->key, entry2->entry->key);
+	if (result != 0) {
+		return result;
+	}
+	return entry1->position < entry2->position ? -1 : entry1->position > entry2->position;
+}
@@ -8,6 +8,7 @@ typedef enum symbol_type {
 	DATA_SYMBOL,
 	EXTERNAL_SYMBOL,
 	EXTERNAL_REFERENCE, 	/* address that contains a reference to the external symbol */
+	RELOCATION_REFERENCE, 	/* address that contains the absolute address of the symbol */
 	ENTRY_SYMBOL
 } symbol_type;
 
@@ -22,6 +23,18 @@ typedef struct entry {
 	symbol_type type; /* the symbol type */
 } table_entry;
 
+/* An entry of a table index, with it's position in the table */
+typedef struct indexed_entry {
+	table_entry* entry;
+	long position;
+} indexed_entry;
+
+/* A read-only index of some of the table entries, sorted by key, for many lookups by name */
+typedef struct table_index {
+	indexed_entry* entries;
+	long count;
+} table_index;
+
 /**
  * Adds the value of the entry
  * @param tab The table, containing the entries
@@ -65,6 +78,29 @@ long find_by_name(table tab, char* key);
  */
 table filter_table_by_type(table tab, symbol_type type);
 
+/**
+ * Builds a sorted index of the entries of the specified types. The table must not change while the index is used.
+ * @param tab The table
+ * @param index The destination index
+ * @param symbol_count The count of given types
+ * @param ... The types to index
+ */
+void build_table_index(table tab, table_index* index, int symbol_count, ...);
+
+/**
+ * Finds an entry in a table index by binary search. Like find_by_types, the first matching entry of the table is returned.
+ * @param index The table index
+ * @param key The key of the entry to find
+ * @return The entry if found, NULL if not found
+ */
+table_entry* find_in_index(table_index* index, char* key);
+
+/**
+ * Deallocates all the memory required by a table index (but not the table itself).
+ * @param index The table index
+ */
+void free_table_index(table_index* index);
+
 /**
  * Deallocates all the memory required by the table.
  * @param tab The table to deallocate
@@ -3,12 +3,23 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
-#include <math.h>
 #include "utils.h"
 #include "code.h"
+#include "diagnostics.h"
 
  #define ERR_OUTPUT stdout 
 
+/**
+ * Reports an error: adds it to the diagnostics of the line, or prints it if the line has none
+ * @param line The source line
+ * @param column The 0 based index of the error in the line content
+ * @param code The error code
+ * @param message The error message
+ * @param args The arguments to format into the message
+ * @return print result of the message
+ */
+static int report_error(line_info line, int column, error_code code, char* message, va_list args);
+
 
 char* strconcat(char* str1, char* str2){
   char* str = (char *)malloc_with_check(strlen(str1) + strlen(str2) + 1);
@@ -17,6 +28,24 @@ char* strconcat(char* str1, char* str2){
 	return str;
 }
 
+char* copy_string(char* string){
+	char* copy = (char *) malloc_with_check(strlen(string) + 1);
+	strcpy(copy, string);
+	return copy;
+}
+
+unsigned long hash_char(unsigned long hash, char c){
+	return ((hash ^ (unsigned char) c) * 16777619UL) & 0xFFFFFFFFUL;
+}
+
+unsigned long hash_string(char* string){
+	unsigned long hash = EMPTY_STRING_HASH;
+	for ( ; *string; string++) {
+		hash = hash_char(hash, *string);
+	}
+	return hash;
+}
+
 void* malloc_with_check(long size) {
 	void *ptr = malloc(size);
 	if (ptr == NULL) {
@@ -26,6 +55,15 @@ void* malloc_with_check(long size) {
 	return ptr;
 }
 
+void* realloc_with_check(void* ptr, long size) {
+	void *new_ptr = realloc(ptr, size);
+	if (new_ptr == NULL) {
+		printf("Error: Fatal: Memory allocation failed.\n");
+		exit(1);
+	}
+	return new_ptr;
+}
+
 bool find_label(line_info line, char* symbol_dest) {
 	int j, i;
 	i = j = 0;
@@ -42,7 +80,7 @@ bool find_label(line_info line, char* symbol_dest) {
 	/* if it was a try to define label, print errors if needed. */
 	if (line.content[i] == ':') {
 		if (!is_valid_label_name(symbol_dest)) {
-			print_error(line,"Invalid label name - cannot be longer than 32 chars, may only start with letter be alphanumeric.");
+			print_error(line, LABEL_NAME_ERR, "Invalid label name - cannot be longer than 32 chars, may only start with letter be alphanumeric.");
 			symbol_dest[0] = '\0';
 			return FALSE; /* no valid symbol, and no try to define one */
 		}
@@ -52,6 +90,18 @@ bool find_label(line_info line, char* symbol_dest) {
 	return TRUE; /* there was no error */
 }
 
+void get_defined_label(char* content, char* dest) {
+	int i = 0, j = 0;
+	SKIP_TO_NOT_WHITE(content, i)
+	for ( ; content[i] && content[i] != ':' && content[i] != ' ' && content[i] != '\t' && j <= MAX_LABEL_LENGTH; i++, j++) {
+		dest[j] = content[i];
+	}
+	dest[j] = '\0';
+	if (content[i] != ':' || !is_valid_label_name(dest)) {
+		dest[0] = '\0';
+	}
+}
+
 bool is_valid_label_name(char* name) {
 
 	/* check length, first char is alpha and all the others are alphanumeric, and not reserved word */
@@ -71,9 +121,10 @@ bool is_alphanumeric(char* string) {
 
 bool is_reserved_word(char* name) {
 	int func, opc;
-	/* check if register or command or instruction */
+	/* check if register or command or instruction or macro definition word */
 	get_opcode_and_funct(name, &opc, (funct *) &func);
-	if (opc != NONE_OP || get_register_by_name(name) != NONE_REG || find_instruction_by_name(name) != NONE_INST){
+	if (opc != NONE_OP || get_register_by_name(name) != NONE_REG || find_instruction_by_name(name) != NONE_INST ||
+	    strcmp(name, "mcro") == 0 || strcmp(name, "endmcro") == 0){
     return TRUE;
   } 
 	return FALSE;
@@ -92,6 +143,10 @@ static struct instruction_lookup_item
     {"db",   DB_INST},
 		{"entry",  ENTRY_INST},
 		{"extern", EXTERN_INST},
+		{"space", SPACE_INST},
+		{"fill", FILL_INST},
+		{"incbin", INCBIN_INST},
+		{"align", ALIGN_INST},
 		{NULL, NONE_INST}
 };
 
@@ -118,72 +173,137 @@ bool is_int(char* string) {
 }
 
 
-bool is_num_in_range(long num, instruction inst){
-	int bits = 0;
-	long min, max;
-
-	switch (inst){
-		case DB_INST:
-			bits = BYTE-1;
-			break;
+number_status parse_number(char* string, int bytes, long* value){
+	/* the bounds of each width, by the bytes count */
+	static const unsigned long signed_max[] = {0, 0x7FUL, 0x7FFFUL, 0, 0x7FFFFFFFUL};
+	static const unsigned long unsigned_max[] = {0, 0xFFUL, 0xFFFFUL, 0, 0xFFFFFFFFUL};
+	unsigned long magnitude = 0, limit;
+	int base = 10, digit;
+	bool is_negative = FALSE, is_pattern = FALSE, is_in_range = TRUE;
+	char* digits;
 
-		case DH_INST:
-			bits = 2*BYTE-1;
-			break;
-
-		case DW_INST:
-			bits = 4*BYTE-1;
-			break;
+	if (*string == '-' || *string == '+') {
+		is_negative = *string == '-';
+		string++;
+	}
+	if (string[0] == '\'') {
+		/* a single character, which is always in the range of a byte */
+		if (string[1] == '\0' || string[2] != '\'' || string[3] != '\0') {
+			return NUMBER_SYNTAX_ERROR;
+		}
+		magnitude = (unsigned char) string[1];
+		is_pattern = TRUE;
+	}
+	else {
+		if (string[0] == '0' && (string[1] == 'x' || string[1] == 'X' || string[1] == 'b' || string[1] == 'B')) {
+			base = string[1] == 'x' || string[1] == 'X' ? 16 : 2;
+			is_pattern = TRUE;
+			string += 2;
+		}
+		/* the magnitude of the minimum is larger by 1 than the maximum */
+		limit = is_negative ? signed_max[bytes] + 1 : is_pattern ? unsigned_max[bytes] : signed_max[bytes];
+		for (digits = string; *string; string++) {
+			digit = isdigit(*string) ? *string - '0' : isxdigit(*string) ? tolower(*string) - 'a' + 10 : base;
+			if (digit >= base) {
+				return NUMBER_SYNTAX_ERROR;
+			}
+			/* the rest of the digits are still checked for the syntax */
+			if (magnitude > (limit - digit) / base) {
+				is_in_range = FALSE;
+			}
+			else {
+				magnitude = magnitude * base + digit;
+			}
+		}
+		if (string == digits) {
+			return NUMBER_SYNTAX_ERROR;
+		}
+		if (!is_in_range) {
+			return NUMBER_RANGE_ERROR;
+		}
+	}
 
-		default:
-			break;
+	if (is_negative) {
+		*value = magnitude == 0 ? 0 : -(long) (magnitude - 1) - 1;
 	}
-	min = pow(2, bits) * (-1);
-	max = pow(2,bits)-1;
-	if(num > max || num < min){
-		return FALSE;
+	else if (magnitude > signed_max[bytes]) {
+		/* an unsigned pattern - as the negative value with the same bits */
+		*value = -(long) (unsigned_max[bytes] - magnitude) - 1;
 	}
-	return TRUE;
+	else {
+		*value = (long) magnitude;
+	}
+	return NUMBER_OK;
+}
+
+int print_error(line_info line, error_code code, char* message, ...) {
+	int result, column = 0;
+	va_list args; /* for formatting */
+	/* the whole line is wrong - point at the start of the statement */
+	if (line.content != NULL) {
+		SKIP_TO_NOT_WHITE(line.content, column)
+	}
+	va_start(args, message);
+	result = report_error(line, column, code, message, args);
+	va_end(args);
+	return result;
 }
 
-int print_error(line_info line, char* message, ...) {
+int print_error_at(line_info line, int column, error_code code, char* message, ...) {
 	int result;
 	va_list args; /* for formatting */
+	va_start(args, message);
+	result = report_error(line, column, code, message, args);
+	va_end(args);
+	return result;
+}
+
+static int report_error(line_info line, int column, error_code code, char* message, va_list args) {
+	int result;
+	if (line.diag != NULL) {
+		add_diagnostic(line.diag, ERROR_SEVERITY, code, line, column, message, args);
+		return 0;
+	}
 	/* print file+line */
 	fprintf(ERR_OUTPUT,"Error In %s:%ld: ", line.file_name, line.line_number);
 
 	/* use vprintf to call printf from variable argument function with message + format */
-	va_start(args, message);
 	result = vfprintf(ERR_OUTPUT, message, args);
-	va_end(args);
 	fprintf(ERR_OUTPUT, "\n");
 	return result;
 }
 
+void free_code_word(machine_word* word){
+  /* free code/data word */
+	if (word->length > 0) {
+		if(word->word.code->command == 'r'){
+			free(word->word.code->commad_type.r);
+		}
+		else if(word->word.code->command == 'i'){
+			free(word->word.code->commad_type.i);
+		}
+		else{
+			free(word->word.code->commad_type.j);
+		}
+		free(word->word.code);
+	} 
+	else {
+		free(word->word.data);
+	}
+	/* free the pointer to the union */
+	free(word);
+}
+
 void free_code_image(machine_word** code_image, long icf){
   long i;
+  if (code_image == NULL) {
+    return;
+  }
   /* for each not-null cell (we might have some "holes", so we won't stop on first null) */
   for(i = 0; i < icf; i++){
     machine_word* word = code_image[i];
     if(word != NULL){
-      /* free code/data word */
-			if (word->length > 0) {
-				if(word->word.code->command == 'r'){
-					free(word->word.code->commad_type.r);
-				}
-				else if(word->word.code->command == 'i'){
-					free(word->word.code->commad_type.i);
-				}
-				else{
-					free(word->word.code->commad_type.j);
-				}
-				free(word->word.code);
-			} 
-			else {
-				free(word->word.data);
-			}
-			/* free the pointer to the union */
-			free(word);
+			free_code_word(word);
 			code_image[i] = NULL;
     }
   }
@@ -191,30 +311,28 @@ void free_code_image(machine_word** code_image, long icf){
 	*code_image = NULL;
 }
 
-void free_data_word(data_word** data, long dcf){
-  long i;
-
-  for(i = 0; i < dcf; ){
-    data_word* curr_data = data[i];
-
-		switch(curr_data->ins){
-			case ASCIZ_INST:
-			case DB_INST:
-				i++;
-				break;
-
-			case DH_INST:
-				i+=2;
-				break;
-
-			case DW_INST:
-				i+=4;
-				break;
-			
-			default:
-				break;
-		}
-    free(curr_data);
+void add_label_ref(label_ref_list* list, long ic, bool is_entry, char* label, line_info line){
+	label_ref* ref;
+	/* grow the list by doubling it's capacity */
+	if (list->count == list->capacity) {
+		list->capacity = list->capacity == 0 ? 16 : list->capacity * 2;
+		list->refs = (label_ref *) realloc_with_check(list->refs, list->capacity * sizeof(label_ref));
 	}
+	ref = &list->refs[list->count++];
+	ref->ic = ic;
+	ref->is_entry = is_entry;
+	ref->label = (char *) malloc_with_check(strlen(label) + 1);
+	strcpy(ref->label, label);
+	ref->line = line;
+	ref->line.content = NULL; /* the line buffer is reused for the next lines */
+}
 
+void free_label_refs(label_ref_list* list){
+	long i;
+	for (i = 0; i < list->count; i++) {
+		free(list->refs[i].label);
+	}
+	free(list->refs);
+	list->refs = NULL;
+	list->count = list->capacity = 0;
 }
@@ -17,6 +17,31 @@
  */
 char* strconcat(char* str1, char* str2);
 
+/**
+ * Copies a string to a new allocated memory
+ * @param string The string
+ * @return A pointer to the new, allocated copy
+ */
+char* copy_string(char* string);
+
+/** The hash of an empty string, to add the characters to by hash_char */
+#define EMPTY_STRING_HASH 2166136261UL
+
+/**
+ * Adds a character to a string hash (FNV-1a, of 32 bits)
+ * @param hash The hash of the characters before it
+ * @param c The character
+ * @return The hash with the character
+ */
+unsigned long hash_char(unsigned long hash, char c);
+
+/**
+ * Hashes a string (FNV-1a, of 32 bits)
+ * @param string The string
+ * @return The hash
+ */
+unsigned long hash_string(char* string);
+
 /**
  * Allocates memory in the required size. Exits the program if failed.
  * @param size The size to allocate in bytes
@@ -24,6 +49,14 @@ char* strconcat(char* str1, char* str2);
  */
 void* malloc_with_check(long size);
 
+/**
+ * Reallocates memory to the required size. Exits the program if failed.
+ * @param ptr The pointer to reallocate, may be NULL
+ * @param size The size to allocate in bytes
+ * @return A generic pointer to the reallocated memory if succeeded
+ */
+void* realloc_with_check(void* ptr, long size);
+
 /**
  * Finds the defined label in the code if exists, and saves it into the buffer.
  * @param line The source line to find in
@@ -32,6 +65,13 @@ void* malloc_with_check(long size);
  */
 bool find_label(line_info line, char* symbol_dest);
 
+/**
+ * Gets the label defined by a source line, without printing errors and without checking the rest of the line
+ * @param content The line content
+ * @param dest The destination of the label, empty if the line doesn't define a valid label
+ */
+void get_defined_label(char* content, char* dest);
+
 /**
  * Returns whether a label can be defined with the specified name.
  * @param name The label name
@@ -68,33 +108,65 @@ instruction find_instruction_by_name(char* name);
 bool is_int(char* string);
 
 /**
- * Prints a detailed error message, including file name and line number by the specified message
+ * Reports an error of a whole source line. It's collected by the diagnostics of the line if it has,
+ * and otherwise printed right away, including file name and line number.
+ * @param line The source line
+ * @param code The error code
  * @param message The error message
  * @param ... The arguments to format into the message
  * @return print result of the message
  */
-int print_error(line_info line, char *message, ...);
+int print_error(line_info line, error_code code, char *message, ...);
+
+/**
+ * Reports an error at a specific column of a source line, like print_error
+ * @param line The source line
+ * @param column The 0 based index of the error in the line content
+ * @param code The error code
+ * @param message The error message
+ * @param ... The arguments to format into the message
+ * @return print result of the message
+ */
+int print_error_at(line_info line, int column, error_code code, char *message, ...);
+
+/**
+ * Frees a single code word of the code image.
+ * @param word The code word
+ */
+void free_code_word(machine_word* word);
 
 /**
  * Frees all the dynamically-allocated memory for the code image.
- * @param code_image A pointer to the code images buffer
+ * @param code_image A pointer to the code images buffer, NULL if the code words were only counted
  * @param icf The final code counter value
  */
 void free_code_image(machine_word** code_image, long icf);
 
 /**
- * Frees all the dynamically-allocated memory for the data image.
- * @param data A pointer to the data images buffer
- * @param dcf The final data counter value
+ * Parses a numeric literal and checks it's range, in a single scan: a decimal number with an optional sign,
+ * 0x hexadecimal, 0b binary or a 'c' character. The decimal numbers are signed, and the other literals are bit
+ * patterns, so they may also fill the whole width unsigned (0xFF for a byte).
+ * @param string The literal
+ * @param bytes The width of the value - 1, 2 or 4 bytes
+ * @param value The destination of the value, in two's complement of the width
+ * @return NUMBER_OK, NUMBER_SYNTAX_ERROR if it's not a number, NUMBER_RANGE_ERROR if it doesn't fit the width
+ */
+number_status parse_number(char* string, int bytes, long* value);
+
+/**
+ * Adds a label reference to the end of the list
+ * @param list The label references list
+ * @param ic The address of the code word that uses the label
+ * @param is_entry Whether it's the label of an .entry instruction
+ * @param label The label name
+ * @param line The current source line info
  */
-void free_data_word(data_word** data, long dcf);
+void add_label_ref(label_ref_list* list, long ic, bool is_entry, char* label, line_info line);
 
 /**
- * Checks if the number is in the range for the specific data instruction 
- * @param num The number to check
- * @param ins The current instruction
- * @return Whether the number is in the range or not
+ * Frees all the dynamically-allocated memory for the label references.
+ * @param list The label references list
  */
-bool is_num_in_range(long num, instruction inst);
+void free_label_refs(label_ref_list* list);
 
 #endif 
\ No newline at end of file
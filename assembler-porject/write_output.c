@@ -3,17 +3,51 @@
 #include <stdlib.h>
 #include "utils.h"
 #include "table.h"
+#include "code.h"
 #include "write_output.h"
+#include "batch_io.h"
+
+/** Bytes of the data image expanded at a time by the object writer, a multiple of the row */
+#define OB_WRITE_CHUNK 4096
+
+/** Maximum length of a formatted row of the object: a line break, the address, and 4 bytes */
+#define MAX_OB_ROW_LENGTH 32
 
 
 /**
  * Writes a symbol table to a file. Each symbol and it's address in line, separated by a single space.
  * @param tab The symbol table
+ * @param format The format of the lines
  * @param filename The filename without the extension
  * @param file_extension The extension of the file, including dot before
  * @return Whether succeeded
  */
-static bool write_table_to_file(table tab, char* filename, char* file_extension);
+static bool write_table_to_file(table tab, table_format format, char* filename, char* file_extension);
+
+/**
+ * Writes the lines of a symbol table to an opened stream. Each symbol and it's address in line, separated by a single space.
+ * @param tab The symbol table, not empty
+ * @param format The format of the lines
+ * @param file_desc The stream
+ */
+static void write_table_to_stream(table tab, table_format format, FILE* file_desc);
+
+/**
+ * Writes the lines of a symbol table grouped by the symbol name: each name once, in the order of the names,
+ * followed by the sorted addresses of it's entries, separated by a single space
+ * @param tab The symbol table, not empty
+ * @param is_delta Whether each address after the first one of a name is written as the distance from the one before
+ * @param file_desc The stream
+ */
+static void write_grouped_table_to_stream(table tab, bool is_delta, FILE* file_desc);
+
+/**
+ * Compares two symbols by their name, then by their address, for sorting
+ * @param first A pointer to the first symbol
+ * @param second A pointer to the second symbol
+ * @return Negative, zero or positive, as the first symbol is before, equal or after the second
+ */
+static int compare_symbols(const void* first, const void* second);
 
 /**
  * Writes the code and data image into an .ob file, with lengths on top
@@ -24,53 +58,140 @@ static bool write_table_to_file(table tab, char* filename, char* file_extension)
  * @param data The data image
  * @return Whether succeeded
  */
-static bool write_ob_file(machine_word** code_img, long icf, long dcf, char* filename, data_word** data);
+static bool write_ob_file(machine_word** code_img, long icf, long dcf, char* filename, data_image* data);
+
+/**
+ * Writes the code and data image to an opened stream, in the format of the .ob file
+ * @param code_img The code image
+ * @param icf The final code counter
+ * @param dcf The final data counter
+ * @param data The data image
+ * @param file_desc The stream
+ * @return Whether succeeded
+ */
+static bool write_ob_to_stream(machine_word** code_img, long icf, long dcf, data_image* data, FILE* file_desc);
+
+/**
+ * Formats a single row of the object, starting with it's line break: the address (at least 4 digits) and the bytes,
+ * separated by spaces. the bytes of a row shorter than 4 bytes are each followed by a space.
+ * @param dest The destination, of at least MAX_OB_ROW_LENGTH characters
+ * @param address The address of the row
+ * @param bytes The bytes
+ * @param count The bytes count, up to 4
+ * @return The length of the row
+ */
+static int format_ob_row(char* dest, long address, unsigned char* bytes, int count);
 
+/**
+ * Builds the relocations table: the code words whose address field holds the address of a code or data symbol,
+ * in the order of the code. The branches hold a distance, and the external references hold no address.
+ * @param code_img The code image
+ * @param symbol_table The symbol table
+ * @param refs The label references
+ * @return The relocations, by the symbol name and the address of the code word
+ */
+static table build_relocations(machine_word** code_img, table symbol_table, label_ref_list* refs);
 
 /**
- * convert the value of a number to hexa value
- * @param num The number to convert
- * @param array The destination of the convert number
- * @param length The length of the number in bits
- * @param data_index The index to put in the array
- * @return 
- */ 
-static void convert_to_hexa(int num, char* array, int length, int data_index);
+ * Writes the outputs to opened streams
+ * @param code_img The code image
+ * @param icf The final code counter
+ * @param dcf The final data counter
+ * @param externals The external references
+ * @param entries The entries
+ * @param relocations The relocations, NULL if none or not written
+ * @param ext_format The format of the external references
+ * @param data The data image
+ * @param streams The streams
+ * @return Whether succeeded
+ */
+static bool write_output_streams(machine_word** code_img, long icf, long dcf, table externals, table entries, table relocations,
+		table_format ext_format, data_image* data, output_streams* streams);
 
 
-int write_output_files(machine_word** code_img, long icf, long dcf, char* filename, table symbol_table, data_word** data){
+int write_output_files(machine_word** code_img, long icf, long dcf, char* filename, table symbol_table, data_image* data,
+		label_ref_list* refs, listing* lst, bool with_relocations, table_format ext_format, output_streams* streams){
   bool result;
 	table externals = filter_table_by_type(symbol_table, EXTERNAL_REFERENCE);
 	table entries = filter_table_by_type(symbol_table, ENTRY_SYMBOL);
+	table relocations = with_relocations ? build_relocations(code_img, symbol_table, refs) : NULL;
+
+  if (streams != NULL) {
+    result = write_output_streams(code_img, icf, dcf, externals, entries, relocations, ext_format, data, streams) &&
+             (lst == NULL || write_listing_file(lst, code_img, icf, data, symbol_table, refs, filename));
+    free_table(externals);
+    free_table(entries);
+    free_table(relocations);
+    return result;
+  }
 
   result = write_ob_file(code_img, icf, dcf, filename, data) && 
-           write_table_to_file(externals, filename, ".ext") && 
-					 write_table_to_file(entries, filename, ".ent");
+           write_table_to_file(externals, ext_format, filename, ".ext") && 
+					 write_table_to_file(entries, TABLE_LINES, filename, ".ent") &&
+					 write_table_to_file(relocations, TABLE_LINES, filename, ".rel") &&
+					 (lst == NULL || write_listing_file(lst, code_img, icf, data, symbol_table, refs, filename));
 
   free_table(externals);
   free_table(entries);
+  free_table(relocations);
   return result;
 }
 
-static bool write_table_to_file(table tab, char* filename, char* file_extension){
+static table build_relocations(machine_word** code_img, table symbol_table, label_ref_list* refs){
+	table relocations = NULL, *last = &relocations;
+	table_index index;
+	long i;
+
+	build_table_index(symbol_table, &index, 2, CODE_SYMBOL, DATA_SYMBOL);
+	/* the references are in the order of the code, so the table is built from it's end, without searching */
+	for (i = 0; i < refs->count; i++) {
+		if (refs->refs[i].is_entry || get_label_field(code_img[refs->refs[i].ic - IC_INIT_VALUE]->word.code) != ADDRESS_FIELD ||
+		    find_in_index(&index, refs->refs[i].label) == NULL) {
+			continue;
+		}
+		*last = (table) malloc_with_check(sizeof(table_entry));
+		(*last)->key = (char *) malloc_with_check(strlen(refs->refs[i].label) + 1);
+		strcpy((*last)->key, refs->refs[i].label);
+		(*last)->value = refs->refs[i].ic;
+		(*last)->type = RELOCATION_REFERENCE;
+		(*last)->next = NULL;
+		last = &(*last)->next;
+	}
+	free_table_index(&index);
+	return relocations;
+}
+
+static bool write_table_to_file(table tab, table_format format, char* filename, char* file_extension){
   FILE* file_desc;
 	/* concatenate filename & extension, and open the file for writing */
 	char* full_filename = strconcat(filename, file_extension);
 
   /* if table is null, nothing to write */
   if(tab == NULL){
+    free(full_filename);
     return TRUE;
   }
 	
-	file_desc = fopen(full_filename, "w");
-	free(full_filename);
+	file_desc = open_output_file(full_filename);
 
   /* if failed, print error and exit */
 	if (file_desc == NULL) {
 		printf("Can't create or rewrite to file %s\n", full_filename);
+		free(full_filename);
 		return FALSE;
 	}
+	free(full_filename);
 
+  write_table_to_stream(tab, format, file_desc);
+  close_output_file(file_desc);
+	return TRUE;
+}
+
+static void write_table_to_stream(table tab, table_format format, FILE* file_desc){
+	if (format != TABLE_LINES) {
+		write_grouped_table_to_stream(tab, format == TABLE_GROUPED_DELTA, file_desc);
+		return;
+	}
   /* write first line without \n to avoid extraneous line breaks */
 	fprintf(file_desc, "%s %.4ld", tab->key, tab->value);
 
@@ -78,154 +199,147 @@ static bool write_table_to_file(table tab, char* filename, char* file_extension)
   while ((tab = tab->next) != NULL) {
 		fprintf(file_desc, "\n%s %.4ld", tab->key, tab->value);
 	}
-  fclose(file_desc);
-	return TRUE;
 }
 
+static void write_grouped_table_to_stream(table tab, bool is_delta, FILE* file_desc){
+	table_entry** entries;
+	table entry;
+	long i, count = 0;
 
-static void convert_to_hexa(int num, char* array, int length, int data_index){
-	int i;
-	unsigned char lower; /* use binary 'and' to mask the lower byte */
-	unsigned char upper; /* use binary 'and' to mask upper byte */
-	unsigned char space = ' ';
-	int index = 0; /* used for storing into array*/
-
-	for(i=0; i<length; i+=8){ /* mask and compare 8 times*/
-		int shift = num>>i; /* right shift*/
-		lower = shift & 0xF; /* use binary 'and' to mask the lower byte */
-		upper = (shift & 0xF0) >> 4; /* use binary 'and' to mask upper byte */
-		if(lower >= 10){ /* if lower is in range [10-15], than add a value [0-5] on 'a'. */
-			lower = 'A' + (lower - 10);
-		}
-		else{
-			lower = lower + '0'; /* it's in range [0-9], so we have to add it to '0'. */
-		}
+	for (entry = tab; entry != NULL; entry = entry->next) {
+		count++;
+	}
+	entries = (table_entry **) malloc_with_check(count * sizeof(table_entry *));
+	for (entry = tab, i = 0; entry != NULL; entry = entry->next) {
+		entries[i++] = entry;
+	}
+	qsort(entries, count, sizeof(table_entry *), compare_symbols);
 
-		if(upper >= 10){ /* same as lower */
-			upper = 'A' + (upper - 10);
+	for (i = 0; i < count; i++) {
+		if (i == 0 || strcmp(entries[i]->key, entries[i - 1]->key) != 0) {
+			/* the name once, on a new line */
+			fprintf(file_desc, i == 0 ? "%s %.4ld" : "\n%s %.4ld", entries[i]->key, entries[i]->value);
 		}
-		else{
-			upper = upper + '0';
-		}
-	
-		if(data_index == -1){
-			/* code - puts the hexas values in the corrcet index */
-			array[index] = upper;
-			array[index+1] = lower;
-			array[index+2] = space;
-			index += 3;
+		else if (is_delta) {
+			fprintf(file_desc, " +%ld", entries[i]->value - entries[i - 1]->value);
 		}
-		else{
-			/* data - puts the hexas values in the corrcet index */
-			array[data_index] = upper;
-			array[data_index+1] = lower;
-			array[data_index+2] = space;
-			data_index += 3;
+		else {
+			fprintf(file_desc, " %.4ld", entries[i]->value);
 		}
 	}
-	if(index == -1){
-		array[index] = '\0'; 
+	free(entries);
+}
+
+static int compare_symbols(const void* first, const void* second){
+	table_entry *a = *(table_entry **) first, *b = *(table_entry **) second;
+	int result = strcmp(a->key, b->key);
+	return result != 0 ? result : (a->value < b->value ? -1 : a->value > b->value);
+}
+
+static bool write_output_streams(machine_word** code_img, long icf, long dcf, table externals, table entries, table relocations,
+		table_format ext_format, data_image* data, output_streams* streams){
+	if (!write_ob_to_stream(code_img, icf, dcf, data, streams->ob)) {
+		return FALSE;
 	}
-	else{
-		array[data_index] = '\0'; 
+	/* the sections follow the object, each after a header line. empty tables are not written, as their files */
+	if (streams->sections && entries != NULL) {
+		fprintf(streams->ob, "\n.ent\n");
+		write_table_to_stream(entries, TABLE_LINES, streams->ob);
 	}
-    return;
+	if (streams->sections && externals != NULL) {
+		fprintf(streams->ob, "\n.ext\n");
+		write_table_to_stream(externals, ext_format, streams->ob);
+	}
+	if (streams->sections && relocations != NULL) {
+		fprintf(streams->ob, "\n.rel\n");
+		write_table_to_stream(relocations, TABLE_LINES, streams->ob);
+	}
+	fprintf(streams->ob, "\n");
+	if (streams->ent != NULL && entries != NULL) {
+		write_table_to_stream(entries, TABLE_LINES, streams->ent);
+		fprintf(streams->ent, "\n");
+	}
+	if (streams->ext != NULL && externals != NULL) {
+		write_table_to_stream(externals, ext_format, streams->ext);
+		fprintf(streams->ext, "\n");
+	}
+	/* the streams are kept open for the next outputs, but a reader of a pipe gets them now */
+	return fflush(streams->ob) == 0 && (streams->ent == NULL || fflush(streams->ent) == 0) &&
+			(streams->ext == NULL || fflush(streams->ext) == 0);
 }
 
 
  
-static bool write_ob_file(machine_word** code_img, long icf, long dcf, char* filename, data_word** data){
-  int i;
+static bool write_ob_file(machine_word** code_img, long icf, long dcf, char* filename, data_image* data){
 	FILE* file_desc;
-	int index = 0;
-	int val;
-	char* hex_arr;
-	char temp[12] = {0};
+	bool result;
 	char* output_filename = strconcat(filename, ".ob"); 	/* add extension of file to open */
 
-	file_desc = fopen(output_filename, "w"); 	/* try to open the file for writing */
-	free(output_filename);
+	file_desc = open_output_file(output_filename); 	/* try to open the file for writing */
 
   if(file_desc == NULL){
     printf("Can't create or rewrite to file %s.", output_filename);
+		free(output_filename);
 		return FALSE;
   }
+	free(output_filename);
 
-	hex_arr = (char *) malloc(sizeof(char)*dcf*3); 
-	if(!hex_arr){
-		printf("Error: Fatal: Memory allocation failed.\n");
-		return FALSE; 
-	}
+	result = write_ob_to_stream(code_img, icf, dcf, data, file_desc);
+  /* close the file */
+	close_output_file(file_desc);
+	return result;
+}
+
+static bool write_ob_to_stream(machine_word** code_img, long icf, long dcf, data_image* data, FILE* file_desc){
+	long i, j, count, length;
+	unsigned long word;
+	unsigned char bytes[OB_WRITE_CHUNK];
+	char text[OB_WRITE_CHUNK / 4 * MAX_OB_ROW_LENGTH];
 
   /* print data and code word count on top */
 	fprintf(file_desc, "\t\t%ld %ld", icf - IC_INIT_VALUE, dcf);
 
 	/* starting from index 0, not IC_INIT_VALUE as icf, so we have to subtract it. */
-	for (i = 0; i < icf - IC_INIT_VALUE; i+=4) {
-		if (code_img[i]->length > 0) {
-
-			if(code_img[i]->word.code->opcode >= 0 && code_img[i]->word.code->opcode <= MVLO_OP){ /* R command */	
-				val = (code_img[i]->word.code->opcode << 26 | code_img[i]->word.code->commad_type.r->rs << 21 | 
-						 code_img[i]->word.code->commad_type.r->rt << 16 | code_img[i]->word.code->commad_type.r->rd << 11 |
-						code_img[i]->word.code->commad_type.r->funct << 6 | code_img[i]->word.code->commad_type.r->NONE);
-				convert_to_hexa(val, hex_arr, 32, -1);
-				strncpy(temp, hex_arr, 11);
-			}
-			
-			else if(code_img[i]->word.code->opcode >= ADDI_OP && code_img[i]->word.code->opcode<= SH_OP ){ /* I command */
-				val = (code_img[i]->word.code->opcode << 26 | code_img[i]->word.code->commad_type.i->rs << 21 | 
-						code_img[i]->word.code->commad_type.i->rt << 16 | code_img[i]->word.code->commad_type.i->immed);
-				convert_to_hexa(val, hex_arr, 32, -1);
-				strncpy(temp, hex_arr, 11);
-			}
-			else if(code_img[i]->word.code->opcode >= JMP_OP && code_img[i]->word.code->opcode <= STOP_OP){ /* J command */
-				val = (code_img[i]->word.code->opcode << 26 | code_img[i]->word.code->commad_type.j->reg << 25 | 
-						code_img[i]->word.code->commad_type.j->address);
-				convert_to_hexa(val, hex_arr, 32, -1);
-				strncpy(temp, hex_arr, 11);
-			}
-		}
-	
-		/* write the value to the file - first */
-		fprintf(file_desc, "\n%.4d %s", i + 100, temp);
+	for (i = 0; i < icf - IC_INIT_VALUE; i += 4) {
+		word = encode_code_word(code_img[i]->word.code);
+		fprintf(file_desc, "\n%.4ld %02lX %02lX %02lX %02lX", i + IC_INIT_VALUE,
+				word & 0xFF, (word >> 8) & 0xFF, (word >> 16) & 0xFF, (word >> 24) & 0xFF);
 	}
 
-	/* write data image. dcf starts at 0 so it's fine */
-	for (i = 0; i < dcf; ) {
-
-		switch(data[i]->ins){
-			case ASCIZ_INST:
-			case DB_INST:
-			convert_to_hexa(data[i]->data, hex_arr, BYTE, index); 
-			index += 3;
-				i++;
-				break;
-
-			case DH_INST:
-			convert_to_hexa(data[i]->data, hex_arr, 2*BYTE, index); 
-			index += 6;
-				i += 2;
-				break;
-
-			case DW_INST:
-			convert_to_hexa(data[i]->data, hex_arr, 4*BYTE, index);
-			index += 12;
-				i += 4;
-				break;
-
-			default:
-				break;
-		}	
+	/* the data image is expanded a chunk at a time, so reserved buffers are never held in memory whole,
+	 * and the rows of a chunk are written at once */
+	for (i = 0; i < dcf; i += count) {
+		count = dcf - i < OB_WRITE_CHUNK ? dcf - i : OB_WRITE_CHUNK;
+		get_data_bytes(data, i, i + count, bytes);
+		for (j = 0, length = 0; j < count; j += 4) {
+			length += format_ob_row(text + length, icf + i + j, bytes + j, count - j < 4 ? (int) (count - j) : 4);
+		}
+		fwrite(text, 1, length, file_desc);
 	}
+	return ferror(file_desc) == 0;
+}
 
-	for(i = 0; i<strlen(hex_arr); i+=12){
-		strncpy(temp, hex_arr+i, 11);
-		fprintf(file_desc, "\n%.4ld %s", icf, temp);
-		icf += 4;
+static int format_ob_row(char* dest, long address, unsigned char* bytes, int count){
+	static const char hex_digits[] = "0123456789ABCDEF";
+	char digits[24];
+	int i, length = 0, digit_count = 0;
+
+	/* the address in decimal, from it's last digit */
+	do {
+		digits[digit_count++] = (char) ('0' + address % 10);
+		address /= 10;
+	} while (address > 0 || digit_count < 4);
+	dest[length++] = '\n';
+	while (digit_count > 0) {
+		dest[length++] = digits[--digit_count];
 	}
-
-  /* close the file */
-	fclose(file_desc);
-	free(hex_arr);
-	return TRUE;
-}
\ No newline at end of file
+	for (i = 0; i < count; i++) {
+		dest[length++] = ' ';
+		dest[length++] = hex_digits[bytes[i] >> 4];
+		dest[length++] = hex_digits[bytes[i] & 0xF];
+	}
+	if (count < 4) {
+		dest[length++] = ' ';
+	}
+	return length;
+}
@@ -1,8 +1,20 @@
 /* Output files related functions */
 #ifndef _WRITEFILES_H
 #define _WRITEFILES_H
+#include <stdio.h>
 #include "globals.h"
 #include "table.h"
+#include "data_image.h"
+#include "listing.h"
+
+/* Opened streams to write the outputs to, instead of the files named after the source */
+typedef struct output_streams {
+	FILE* ob; /* the object */
+	FILE* ent; /* the entries, NULL if not written */
+	FILE* ext; /* the external references, NULL if not written */
+	bool sections; /* whether the entries, the externals and the relocations follow the object in it's stream,
+	                * each after a header line */
+} output_streams;
 
 /**
  * Writes the output files of a single assembly file
@@ -12,9 +24,16 @@
  * @param filename The filename (without the extension)
  * @param symbol_table The symbol table
  * @param data The data image
+ * @param refs The label references, for the listing
+ * @param lst The listing, NULL if no .lst file is needed
+ * @param with_relocations Whether to write the relocations (.rel) too: each code word that holds the absolute address
+ * of a symbol - the J-type address field - by the symbol name and the address of the word, as the externals
+ * @param ext_format The format of the external references
+ * @param streams Where to write the object, the entries and the externals, NULL for the files named after the source
  * @return Whether succeeded
  */
-int write_output_files(machine_word** code_img, long icf, long dcf, char* filename, table symbol_table, data_word** data);
+int write_output_files(machine_word** code_img, long icf, long dcf, char* filename, table symbol_table, data_image* data,
+		label_ref_list* refs, listing* lst, bool with_relocations, table_format ext_format, output_streams* streams);
 
 
 #endif
\ No newline at end of file